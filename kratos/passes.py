@@ -38,9 +38,12 @@ def verilog(generator: Generator, optimize_if: bool = True,
             debug_db_filename: str = "",
             use_parallel: bool = True,
             track_generated_definition: bool = False,
-            compile_to_verilog: bool = False):
+            compile_to_verilog: bool = False,
+            pass_trace_filename: str = ""):
     code_gen = _kratos.VerilogModule(generator.internal_generator)
     pass_manager = code_gen.pass_manager()
+    if pass_trace_filename:
+        pass_manager.instrumented = True
     if additional_passes is not None:
         for name, fn in additional_passes.items():
             pass_manager.register_pass(name, fn)
@@ -107,6 +110,8 @@ def verilog(generator: Generator, optimize_if: bool = True,
         pass_manager.add_pass("sort_stmts")
 
     code_gen.run_passes()
+    if pass_trace_filename:
+        pass_manager.save_trace(pass_trace_filename)
 
     if compile_to_verilog:
         assert output_dir is None and filename is not None,\
@@ -1,11 +1,19 @@
 from _kratos import Simulator as _Simulator
+from _kratos import CompiledSimulator as _CompiledSimulator
 from .generator import Generator, PortType
 
 
 # Python wrapper for the simulator
 class Simulator:
-    def __init__(self, generator: Generator):
-        self._sim = _Simulator(generator.internal_generator)
+    def __init__(self, generator: Generator, compiled=False, parallel=False):
+        # the compiled simulator levelizes the design ahead of time, which
+        # is much faster for large designs. parallel mode implies compiled and
+        # uses as many threads as set by set_num_cpus
+        if compiled or parallel:
+            self._sim = _CompiledSimulator(generator.internal_generator)
+            self._sim.parallel = parallel
+        else:
+            self._sim = _Simulator(generator.internal_generator)
         # get the clock and reset
         clks = generator.internal_generator.get_ports(PortType.Clock.value)
         if len(clks) == 1:
@@ -19,11 +27,20 @@ class Simulator:
             self._reset = None
 
     def set(self, var, value):
+        if isinstance(value, int) and var.width > 64:
+            # wide values are passed in as 64-bit words
+            mask = (1 << 64) - 1
+            value = [(value >> (64 * i)) & mask for i in range((var.width + 63) // 64)]
         self._sim.set(var, value)
 
     def get(self, var):
         if len(var.size) > 1 or var.size[0] > 1:
             return self._sim.get_array(var)
+        elif var.width > 64:
+            words = self._sim.get_array(var)
+            if words is None:
+                return None
+            return sum(word << (64 * i) for i, word in enumerate(words))
         else:
             return self._sim.get(var)
 
@@ -11,13 +11,15 @@ void init_code_gen(py::module &m) {
     using namespace kratos;
     py::class_<VerilogModule>(m, "VerilogModule")
         .def(py::init<Generator *>())
-        .def("verilog_src", &VerilogModule::verilog_src)
-        .def("run_passes", &VerilogModule::run_passes)
+        .def("verilog_src", &VerilogModule::verilog_src, py::call_guard<py::gil_scoped_release>())
+        .def("run_passes", &VerilogModule::run_passes, py::call_guard<py::gil_scoped_release>())
         .def("pass_manager", &VerilogModule::pass_manager, py::return_value_policy::reference);
 
     m.def("create_wrapper_flatten", &create_wrapper_flatten, py::return_value_policy::reference)
         .def("generate_sv_package_header",
-             py::overload_cast<Generator *, const std::string &, bool>(&generate_sv_package_header))
-        .def("generate_sv_package_header", &generate_sv_package_header)
+             py::overload_cast<Generator *, const std::string &, bool>(&generate_sv_package_header),
+             py::call_guard<py::gil_scoped_release>())
+        .def("generate_sv_package_header", &generate_sv_package_header,
+             py::call_guard<py::gil_scoped_release>())
         .def("fix_verilog_ln", &fix_verilog_ln);
 }
\ No newline at end of file
@@ -29,5 +29,17 @@ void init_context(py::module &m) {
         .def("enum", &Context::enum_, py::arg("enum_name"), py::arg("definition"),
              py::arg("width"), py::return_value_policy::reference)
         .def("has_enum", &Context::has_enum)
-        .def_property("track_generated", &Context::track_generated, &Context::set_track_generated);
+        .def_property("track_generated", &Context::track_generated, &Context::set_track_generated)
+        .def("memory_report", &Context::memory_report,
+             py::call_guard<py::gil_scoped_release>());
+
+    py::class_<MemoryUsage>(m, "MemoryUsage")
+        .def_readonly("num_generators", &MemoryUsage::num_generators)
+        .def_readonly("vars", &MemoryUsage::vars)
+        .def_readonly("exprs", &MemoryUsage::exprs)
+        .def_readonly("slices", &MemoryUsage::slices)
+        .def_readonly("stmts", &MemoryUsage::stmts)
+        .def_readonly("debug_info", &MemoryUsage::debug_info)
+        .def_readonly("connections", &MemoryUsage::connections)
+        .def("total", &MemoryUsage::total);
 }
\ No newline at end of file
@@ -43,7 +43,9 @@ void init_debug(py::module &m) {
         // dump the database file
         .def("save_database",
              py::overload_cast<const std::string &, bool>(&DebugDatabase::save_database),
-             py::arg("filename"), py::arg("override"))
+             py::arg("filename"), py::arg("override"), py::call_guard<py::gil_scoped_release>())
         .def("save_database", py::overload_cast<const std::string &>(&DebugDatabase::save_database),
-             py::arg("filename"));
+             py::arg("filename"), py::call_guard<py::gil_scoped_release>())
+        .def("save_symbol_file", &DebugDatabase::save_symbol_file, py::arg("filename"),
+             py::call_guard<py::gil_scoped_release>());
 }
\ No newline at end of file
@@ -380,8 +380,16 @@ void init_common_expr(py::class_<kratos::Var, ::shared_ptr<kratos::Var>> &class_
             [](Var &v, bool s) { v.is_signed() = s; })
         .def_property_readonly("size", [](const Var &var) { return var.size(); })
         .def_property("explicit_array", &Var::explicit_array, &Var::set_explicit_array)
-        .def("sources", &Var::sources, py::return_value_policy::reference)
-        .def("sinks", &Var::sinks, py::return_value_policy::reference)
+        .def("sources",
+             [](const Var &var) {
+                 return std::unordered_set<std::shared_ptr<AssignStmt>>(var.sources().begin(),
+                                                                         var.sources().end());
+             })
+        .def("sinks",
+             [](const Var &var) {
+                 return std::unordered_set<std::shared_ptr<AssignStmt>>(var.sinks().begin(),
+                                                                         var.sinks().end());
+             })
         .def("cast", &Var::cast)
         .def_property("is_packed", &Var::is_packed, &Var::set_is_packed)
         .def_property_readonly(
@@ -23,7 +23,8 @@ void init_fault(py::module &main_m) {
     fault.def(py::init<Generator *>())
         .def("add_simulation_run", &FaultAnalyzer::add_simulation_run)
         .def_property_readonly("num_runs", &FaultAnalyzer::num_runs)
-        .def("compute_coverage", &FaultAnalyzer::compute_coverage)
+        .def("compute_coverage", &FaultAnalyzer::compute_coverage,
+             py::call_guard<py::gil_scoped_release>())
         .def("compute_fault_stmts_from_coverage", &FaultAnalyzer::compute_fault_stmts_from_coverage)
         .def("output_coverage_xml",
              py::overload_cast<const std::string &>(&FaultAnalyzer::output_coverage_xml));
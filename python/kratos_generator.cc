@@ -247,6 +247,7 @@ void init_generator(py::module &m) {
                 m.context()->change_generator_name(&m, name);
             })
         .def_readwrite("debug", &Generator::debug)
+        .def_readwrite("share_exprs", &Generator::share_exprs)
         .def("clone", &Generator::clone)
         .def_property("is_cloned", &Generator::is_cloned, &Generator::set_is_cloned)
         .def("__contains__",
@@ -307,12 +308,18 @@ void init_generator(py::module &m) {
         .def("handle_name", [](const Generator &generator) { return generator.handle_name(); })
         .def("handle_name", [](const Generator &generator,
                                bool ignore_top) { return generator.handle_name(ignore_top); })
+        // the names are built on demand, so the iterators run over a python-owned copy
         .def("ports_iter",
              [](const Generator &generator) {
-                 return py::make_iterator(generator.get_port_names());
+                 auto const names = generator.get_port_names();
+                 return py::iter(py::cast(std::vector<std::string>(names.begin(), names.end())));
              })
         .def("vars_iter",
-             [](const Generator &generator) { return py::make_iterator(generator.vars()); })
+             [](const Generator &generator) {
+                 auto const vars = generator.vars();
+                 return py::iter(py::cast(std::vector<std::pair<std::string, std::shared_ptr<Var>>>(
+                     vars.begin(), vars.end())));
+             })
         .def(
             "param_iter",
             [](const Generator &generator) { return py::make_iterator(generator.get_params()); },
@@ -17,54 +17,57 @@ using namespace kratos;
 // pass submodule
 void init_pass(py::module &m) {
     auto pass_m = m.def_submodule("passes");
-
-    pass_m.def("fix_assignment_type", &fix_assignment_type)
-        .def("remove_unused_vars", &remove_unused_vars)
-        .def("verify_generator_connectivity", &verify_generator_connectivity)
-        .def("create_module_instantiation", &create_module_instantiation)
-        .def("hash_generators", &hash_generators)
-        .def("hash_generators_parallel", &hash_generators_parallel)
-        .def("hash_generators_sequential", &hash_generators_sequential)
-        .def("decouple_generator_ports", &decouple_generator_ports)
-        .def("uniquify_generators", &uniquify_generators)
-        .def("generate_verilog", py::overload_cast<Generator *>(&generate_verilog))
+    // passes are pure C++, so they run without the GIL. python passes registered through the
+    // pass manager re-acquire the GIL when they are called
+    using release_gil = py::call_guard<py::gil_scoped_release>;
+
+    pass_m.def("fix_assignment_type", &fix_assignment_type, release_gil())
+        .def("remove_unused_vars", &remove_unused_vars, release_gil())
+        .def("verify_generator_connectivity", &verify_generator_connectivity, release_gil())
+        .def("create_module_instantiation", &create_module_instantiation, release_gil())
+        .def("hash_generators", &hash_generators, release_gil())
+        .def("hash_generators_parallel", &hash_generators_parallel, release_gil())
+        .def("hash_generators_sequential", &hash_generators_sequential, release_gil())
+        .def("decouple_generator_ports", &decouple_generator_ports, release_gil())
+        .def("uniquify_generators", &uniquify_generators, release_gil())
+        .def("generate_verilog", py::overload_cast<Generator *>(&generate_verilog), release_gil())
         .def("generate_verilog",
              py::overload_cast<Generator *, const std::string &, const std::string &, bool>(
-                 &generate_verilog))
-        .def("generate_verilog", py::overload_cast<Generator *>(&generate_verilog))
-        .def("transform_if_to_case", &transform_if_to_case)
-        .def("remove_fanout_one_wires", &remove_fanout_one_wires)
-        .def("remove_pass_through_modules", &remove_pass_through_modules)
-        .def("extract_debug_info", &extract_debug_info)
-        .def("extract_struct_info", &extract_struct_info)
-        .def("extract_enum_info", &extract_enum_info)
-        .def("merge_wire_assignments", merge_wire_assignments)
-        .def("zero_out_stubs", &zero_out_stubs)
-        .def("remove_unused_stmts", &remove_unused_stmts)
-        .def("check_mixed_assignment", &check_mixed_assignment)
-        .def("zero_generator_inputs", &zero_generator_inputs)
-        .def("insert_pipeline_stages", &insert_pipeline_stages)
-        .def("change_port_bundle_struct", &change_port_bundle_struct)
-        .def("realize_fsm", &realize_fsm)
-        .def("check_function_return", &check_function_return)
-        .def("sort_stmts", &sort_stmts)
-        .def("check_active_high", &check_active_high)
-        .def("extract_dpi_function", &extract_dpi_function)
-        .def("extract_interface_info", &extract_interface_info)
-        .def("extract_debug_break_points", &extract_debug_break_points)
-        .def("insert_verilator_public", &insert_verilator_public)
-        .def("remove_assertion", &remove_assertion)
-        .def("check_inferred_latch", &check_inferred_latch)
-        .def("check_multiple_driver", &check_multiple_driver)
-        .def("check_flip_flop_always_ff", &check_flip_flop_always_ff)
-        .def("check_combinational_loop", &check_combinational_loop)
-        .def("merge_if_block", &merge_if_block)
-        .def("find_driver_signal", &find_driver_signal)
-        .def("extract_register_names", &extract_register_names)
-        .def("extract_var_names", &extract_var_names)
-        .def("auto_insert_clock_enable", &auto_insert_clock_enable)
-        .def("auto_insert_sync_reset", &auto_insert_sync_reset)
-        .def("change_property_into_stmt", &change_property_into_stmt);
+                 &generate_verilog), release_gil())
+        .def("generate_verilog", py::overload_cast<Generator *>(&generate_verilog), release_gil())
+        .def("transform_if_to_case", &transform_if_to_case, release_gil())
+        .def("remove_fanout_one_wires", &remove_fanout_one_wires, release_gil())
+        .def("remove_pass_through_modules", &remove_pass_through_modules, release_gil())
+        .def("extract_debug_info", &extract_debug_info, release_gil())
+        .def("extract_struct_info", &extract_struct_info, release_gil())
+        .def("extract_enum_info", &extract_enum_info, release_gil())
+        .def("merge_wire_assignments", merge_wire_assignments, release_gil())
+        .def("zero_out_stubs", &zero_out_stubs, release_gil())
+        .def("remove_unused_stmts", &remove_unused_stmts, release_gil())
+        .def("check_mixed_assignment", &check_mixed_assignment, release_gil())
+        .def("zero_generator_inputs", &zero_generator_inputs, release_gil())
+        .def("insert_pipeline_stages", &insert_pipeline_stages, release_gil())
+        .def("change_port_bundle_struct", &change_port_bundle_struct, release_gil())
+        .def("realize_fsm", &realize_fsm, release_gil())
+        .def("check_function_return", &check_function_return, release_gil())
+        .def("sort_stmts", &sort_stmts, release_gil())
+        .def("check_active_high", &check_active_high, release_gil())
+        .def("extract_dpi_function", &extract_dpi_function, release_gil())
+        .def("extract_interface_info", &extract_interface_info, release_gil())
+        .def("extract_debug_break_points", &extract_debug_break_points, release_gil())
+        .def("insert_verilator_public", &insert_verilator_public, release_gil())
+        .def("remove_assertion", &remove_assertion, release_gil())
+        .def("check_inferred_latch", &check_inferred_latch, release_gil())
+        .def("check_multiple_driver", &check_multiple_driver, release_gil())
+        .def("check_flip_flop_always_ff", &check_flip_flop_always_ff, release_gil())
+        .def("check_combinational_loop", &check_combinational_loop, release_gil())
+        .def("merge_if_block", &merge_if_block, release_gil())
+        .def("find_driver_signal", &find_driver_signal, release_gil())
+        .def("extract_register_names", &extract_register_names, release_gil())
+        .def("extract_var_names", &extract_var_names, release_gil())
+        .def("auto_insert_clock_enable", &auto_insert_clock_enable, release_gil())
+        .def("auto_insert_sync_reset", &auto_insert_sync_reset, release_gil())
+        .def("change_property_into_stmt", &change_property_into_stmt, release_gil());
 
     auto manager = py::class_<PassManager>(pass_m, "PassManager", R"pbdoc(
 This class gives you the fined control over which pass to run and in which order.
@@ -75,9 +78,30 @@ by yourself to obtain the verilog code.)pbdoc");
         .def("register_pass",
              py::overload_cast<const std::string &, std::function<void(Generator *)>>(
                  &PassManager::register_pass))
-        .def("run_passes", &PassManager::run_passes)
+        .def("run_passes", &PassManager::run_passes, release_gil())
         .def("add_pass", &PassManager::add_pass)
-        .def("has_pass", &PassManager::has_pass);
+        .def("has_pass", &PassManager::has_pass)
+        .def_property("instrumented", &PassManager::instrumented, &PassManager::set_instrumented)
+        .def_property("fuse_analysis_passes", &PassManager::fuse_analysis_passes,
+                      &PassManager::set_fuse_analysis_passes)
+        .def("pass_stats", &PassManager::pass_stats, py::return_value_policy::copy)
+        .def("save_trace", &PassManager::save_trace);
+
+    py::class_<IRStats>(pass_m, "IRStats")
+        .def_readonly("num_generators", &IRStats::num_generators)
+        .def_readonly("num_stmts", &IRStats::num_stmts)
+        .def_readonly("num_vars", &IRStats::num_vars);
+    pass_m.def("compute_ir_stats", &compute_ir_stats, release_gil());
+    pass_m.def("compute_memory_usage", &compute_memory_usage, release_gil());
+
+    py::class_<PassStats>(pass_m, "PassStats")
+        .def_readonly("name", &PassStats::name)
+        .def_readonly("start_time", &PassStats::start_time)
+        .def_readonly("wall_time", &PassStats::wall_time)
+        .def_readonly("cpu_time", &PassStats::cpu_time)
+        .def_readonly("before", &PassStats::before)
+        .def_readonly("after", &PassStats::after)
+        .def_readonly("peak_rss_delta", &PassStats::peak_rss_delta);
 
     // trampoline class for ast visitor
     class PyIRVisitor : public IRVisitor {
@@ -142,6 +166,12 @@ by yourself to obtain the verilog code.)pbdoc");
             return r;
         }
 
+        ~PyAttribute() override {
+            // IR nodes can be released by passes running without the GIL
+            py::gil_scoped_acquire acquire;
+            target_ = py::object();
+        }
+
     private:
         py::object target_ = py::none();
     };
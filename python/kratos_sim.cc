@@ -6,24 +6,46 @@
 
 namespace py = pybind11;
 
-// simulator module
-void init_simulator(py::module &m) {
+// both simulators share the same public facing API
+template <class T>
+py::class_<T> bind_simulator(py::module &m, const char *name) {
     using namespace kratos;
-    py::class_<Simulator>(m, "Simulator")
+    return py::class_<T>(m, name)
         .def(py::init<Generator *>())
-        .def("set", py::overload_cast<Var *, std::optional<uint64_t>, bool>(&Simulator::set))
+        .def("set", py::overload_cast<Var *, std::optional<uint64_t>, bool>(&T::set))
         .def("set", py::overload_cast<Var *, const std::optional<std::vector<uint64_t>> &, bool>(
-                        &Simulator::set))
-        .def("set", py::overload_cast<const Var *, std::optional<int64_t>, bool>(&Simulator::set_i))
+                        &T::set))
+        .def("set", py::overload_cast<const Var *, std::optional<int64_t>, bool>(&T::set_i))
         .def("set",
              py::overload_cast<const Var *, const std::optional<std::vector<int64_t>> &, bool>(
-                 &Simulator::set_i))
-        .def("set", [](Simulator &sim, Var *var, std::optional<uint64_t> v) { sim.set(var, v); })
-        .def("set", [](Simulator &sim, Var *var,
+                 &T::set_i))
+        .def("set", [](T &sim, Var *var, std::optional<uint64_t> v) { sim.set(var, v); })
+        .def("set", [](T &sim, Var *var,
                        const std::optional<std::vector<uint64_t>> &v) { sim.set(var, v); })
-        .def("set", [](Simulator &sim, Var *var, std::optional<int64_t> v) { sim.set_i(var, v); })
-        .def("set", [](Simulator &sim, Var *var,
+        .def("set", [](T &sim, Var *var, std::optional<int64_t> v) { sim.set_i(var, v); })
+        .def("set", [](T &sim, Var *var,
                        const std::optional<std::vector<int64_t>> &v) { sim.set_i(var, v); })
-        .def("get", &Simulator::get)
-        .def("get_array", &Simulator::get_array);
-}
\ No newline at end of file
+        .def("get", &T::get)
+        .def("get_array", &T::get_array)
+        .def("eval", &T::eval, py::call_guard<py::gil_scoped_release>());
+}
+
+// simulator module
+void init_simulator(py::module &m) {
+    using namespace kratos;
+    bind_simulator<Simulator>(m, "Simulator");
+    bind_simulator<CompiledSimulator>(m, "CompiledSimulator")
+        .def_property("parallel", &CompiledSimulator::parallel, &CompiledSimulator::set_parallel);
+
+    py::class_<BatchSimulator>(m, "BatchSimulator")
+        .def(py::init<Generator *, uint32_t>())
+        .def("set", py::overload_cast<Var *, uint32_t, std::optional<uint64_t>>(
+                        &BatchSimulator::set))
+        .def("set",
+             py::overload_cast<Var *, const std::vector<uint64_t> &>(&BatchSimulator::set))
+        .def("get", py::overload_cast<Var *, uint32_t>(&BatchSimulator::get))
+        .def("get", py::overload_cast<Var *>(&BatchSimulator::get))
+        .def("eval", &BatchSimulator::eval, py::call_guard<py::gil_scoped_release>())
+        .def("reset", &BatchSimulator::reset)
+        .def_property_readonly("num_lanes", &BatchSimulator::num_lanes);
+}
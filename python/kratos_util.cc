@@ -3,6 +3,7 @@
 #include <pybind11/stl.h>
 #include "../src/util.hh"
 #include "../src/except.hh"
+#include "../src/syntax.hh"
 
 namespace py = pybind11;
 using std::shared_ptr;
@@ -22,6 +23,13 @@ void init_util(py::module &m) {
              "have to have either verilator or iverilog in your $PATH to use this function")
         .def("set_num_cpus", &set_num_cpus)
         .def("get_num_cpus", &get_num_cpus)
+        .def("set_library_index",
+             [](const std::string &filename) {
+                 VerilogLibraryIndex::global().set_filename(filename);
+             },
+             "Store the port definitions of imported verilog files in filename, so that "
+             "later runs skip unchanged files. Empty filename disables it")
+        .def("save_library_index", []() { VerilogLibraryIndex::global().save(); })
         .def("print_stmts", [](const std::vector<std::shared_ptr<Stmt>> &stmts) {
             for (auto const &stmt: stmts)
                 print_ast_node(stmt.get());
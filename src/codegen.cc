@@ -9,6 +9,7 @@
 #include "expr.hh"
 #include "generator.hh"
 #include "graph.hh"
+#include "hash.hh"
 #include "interface.hh"
 #include "pass.hh"
 #include "tb.hh"
@@ -20,8 +21,71 @@ namespace kratos {
 
 std::string get_var_size_str(Var* var);
 
+StreamBuffer::StreamBuffer(uint64_t chunk_size)
+    : current_(std::make_unique<char[]>(chunk_size)),
+      chunk_size_(chunk_size),
+      hash_(hash_64_fnv1a(nullptr, 0)) {
+    setp(current_.get(), current_.get() + chunk_size_);
+}
+
+void StreamBuffer::set_sink(std::ostream* sink) {
+    sink_ = sink;
+    if (!sink_) return;
+    // flush out whatever is buffered already
+    for (auto const& chunk : chunks_) sink_->write(chunk.get(), chunk_size_);
+    chunks_.clear();
+    commit();
+}
+
+void StreamBuffer::commit() {
+    auto const n = static_cast<uint64_t>(pptr() - pbase());
+    hash_ = hash_64_fnv1a(pbase(), n, hash_);
+    size_ += n;
+    if (sink_) {
+        sink_->write(pbase(), static_cast<std::streamsize>(n));
+    } else {
+        // only full chunks are kept
+        chunks_.emplace_back(std::move(current_));
+        current_ = std::make_unique<char[]>(chunk_size_);
+    }
+    setp(current_.get(), current_.get() + chunk_size_);
+}
+
+StreamBuffer::int_type StreamBuffer::overflow(int_type c) {
+    commit();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int StreamBuffer::sync() {
+    if (sink_) {
+        commit();
+        sink_->flush();
+    }
+    return 0;
+}
+
+std::string StreamBuffer::str() const {
+    std::string result;
+    result.reserve(size());
+    for (auto const& chunk : chunks_) result.append(chunk.get(), chunk_size_);
+    result.append(pbase(), pptr() - pbase());
+    return result;
+}
+
+uint64_t StreamBuffer::size() const { return size_ + static_cast<uint64_t>(pptr() - pbase()); }
+
+uint64_t StreamBuffer::hash() const {
+    return hash_64_fnv1a(pbase(), static_cast<uint64_t>(pptr() - pbase()), hash_);
+}
+
 Stream::Stream(Generator* generator, SystemVerilogCodeGen* codegen)
-    : generator_(generator), codegen_(codegen), line_no_(1) {}
+    : std::ostream(nullptr), generator_(generator), codegen_(codegen), line_no_(1) {
+    rdbuf(&buffer_);
+}
 
 Stream& Stream::operator<<(AssignStmt* stmt) {
     const auto& left = stmt->left()->to_string();
@@ -718,7 +782,10 @@ void SystemVerilogCodeGen::stmt_code(RawStringStmt* stmt) {
 void SystemVerilogCodeGen::stmt_code(IfStmt* stmt) {
     if (generator_->debug) {
         stmt->verilog_ln = stream_.line_no();
-        if (stmt->predicate()->verilog_ln == 0) stmt->predicate()->verilog_ln = stream_.line_no();
+        // consts are shared among modules generated in parallel, so leave them alone
+        auto predicate = stmt->predicate();
+        if (predicate->verilog_ln == 0 && predicate->type() != VarType::ConstValue)
+            predicate->verilog_ln = stream_.line_no();
     }
     stream_ << indent() << ::format("if ({0}) ", stmt->predicate()->to_string());
     auto const& then_body = stmt->then_body();
@@ -1,6 +1,7 @@
 #ifndef KRATOS_CODEGEN_HH
 #define KRATOS_CODEGEN_HH
 
+#include <memory>
 #include <sstream>
 
 #include "context.hh"
@@ -30,7 +31,36 @@ private:
     PassManager manager_;
 };
 
-class Stream : public std::stringstream {
+// chunked output buffer. when a chunk is full it's either handed to the sink, or kept as is so
+// that growing the buffer never copies the existing content. the size and hash of the content
+// are tracked as it's written
+class StreamBuffer : public std::streambuf {
+public:
+    explicit StreamBuffer(uint64_t chunk_size = 1u << 16u);
+
+    // everything written so far and later goes to the sink
+    void set_sink(std::ostream* sink);
+
+    [[nodiscard]] std::string str() const;
+    [[nodiscard]] uint64_t size() const;
+    [[nodiscard]] uint64_t hash() const;
+
+protected:
+    int_type overflow(int_type c) override;
+    int sync() override;
+
+private:
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    std::unique_ptr<char[]> current_;
+    uint64_t chunk_size_;
+    std::ostream* sink_ = nullptr;
+    uint64_t size_ = 0;
+    uint64_t hash_;
+
+    void commit();
+};
+
+class Stream : public std::ostream {
 public:
     explicit Stream(Generator* generator, SystemVerilogCodeGen* codegen);
     Stream& operator<<(AssignStmt* stmt);
@@ -46,7 +76,13 @@ public:
 
     inline uint32_t line_no() const { return line_no_; }
 
+    void set_sink(std::ostream* sink) { buffer_.set_sink(sink); }
+    [[nodiscard]] std::string str() const { return buffer_.str(); }
+    [[nodiscard]] uint64_t size() const { return buffer_.size(); }
+    [[nodiscard]] uint64_t hash() const { return buffer_.hash(); }
+
 private:
+    StreamBuffer buffer_;
     Generator* generator_;
     SystemVerilogCodeGen* codegen_;
     uint64_t line_no_;
@@ -61,6 +97,15 @@ public:
         output_module_def(generator_);
         return stream_.str();
     }
+    // streams the module into out without holding the whole module in memory
+    void write(std::ostream& out) {
+        stream_.set_sink(&out);
+        output_module_def(generator_);
+        stream_.flush();
+    }
+    // size and fnv hash of the generated content
+    [[nodiscard]] uint64_t content_size() const { return stream_.size(); }
+    [[nodiscard]] uint64_t content_hash() const { return stream_.hash(); }
 
     uint32_t indent_size = 2;
 
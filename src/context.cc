@@ -3,6 +3,7 @@
 #include "except.hh"
 #include "fmt/format.h"
 #include "generator.hh"
+#include "pass.hh"
 
 using fmt::format;
 using std::runtime_error;
@@ -12,7 +13,7 @@ namespace kratos {
 
 Generator &Context::generator(const std::string &name) {
     auto const &p = std::make_shared<Generator>(this, name);
-    modules_[name].emplace(p);
+    modules_[symbols_.intern(name)].emplace(p);
     return *p;
 }
 
@@ -23,12 +24,13 @@ Generator &Context::empty_generator() {
 }
 
 void Context::add(Generator *generator) {
-    modules_[generator->name].emplace(generator->shared_from_this());
+    modules_[symbols_.intern(generator->name)].emplace(generator->shared_from_this());
 }
 
 void Context::remove(Generator *generator) {
-    if (modules_.find(generator->name) == modules_.end()) return;
-    auto &module_set = modules_.at(generator->name);
+    auto iter = modules_.find(symbols_.find(generator->name));
+    if (iter == modules_.end()) return;
+    auto &module_set = iter->second;
     // TODO:
     //  Write a complete pass to remove the generator
     //  1. remove any connections/assignments
@@ -43,6 +45,13 @@ void Context::add_hash(const Generator *generator, uint64_t hash) {
     generator_hash_[generator] = hash;
 }
 
+void Context::set_hash(const Generator *generator, uint64_t hash) {
+    auto iter = generator_hash_.find(generator);
+    if (iter == generator_hash_.end())
+        throw InternalException(::format("{0}'s hash entry does not exist", generator->name));
+    iter->second = hash;
+}
+
 bool Context::has_hash(const Generator *generator) const {
     return generator_hash_.find(generator) != generator_hash_.end();
 }
@@ -57,6 +66,7 @@ void Context::change_generator_name(Generator *generator, const std::string &new
     if (new_name.empty() || generator->name.empty()) {
         // don't care names
         generator->name = new_name;
+        generator->mark_dirty();
         return;
     }
     // first we need to make sure that the generator is within the context
@@ -65,9 +75,10 @@ void Context::change_generator_name(Generator *generator, const std::string &new
         throw UserException(::format("{0}'s context is different", old_name));
     // remove it from the list
     auto shared_ptr = generator->shared_from_this();
-    if (modules_.find(generator->name) == modules_.end())
+    auto iter = modules_.find(symbols_.find(generator->name));
+    if (iter == modules_.end())
         throw UserException(::format("cannot find generator {0} in context", old_name));
-    auto &list = modules_.at(generator->name);
+    auto &list = iter->second;
     auto pos = std::find(list.begin(), list.end(), shared_ptr);
     if (pos == list.end())
         throw UserException(::format("unable to find generator {0} in context", old_name));
@@ -75,27 +86,50 @@ void Context::change_generator_name(Generator *generator, const std::string &new
     list.erase(pos);
     // change it's name and put it to a new list
     generator->name = new_name;
-    modules_[new_name].emplace(shared_ptr);
+    generator->mark_dirty();
+    modules_[symbols_.intern(new_name)].emplace(shared_ptr);
     // change the cloned names as well
     for (const auto &g : generator->get_clones()) {
         g->name = new_name;
+        g->mark_dirty();
     }
 }
 
 bool Context::generator_name_exists(const std::string &name) const {
-    return modules_.find(name) != modules_.end();
+    return modules_.find(symbols_.find(name)) != modules_.end();
 }
 
 std::set<std::shared_ptr<Generator>> Context::get_generators_by_name(
     const std::string &name) const {
-    if (!generator_name_exists(name)) return {};
-    return modules_.at(name);
+    auto iter = modules_.find(symbols_.find(name));
+    if (iter == modules_.end()) return {};
+    return iter->second;
 }
 
 std::unordered_set<std::string> Context::get_generator_names() const {
     std::unordered_set<std::string> result;
     for (auto const &iter : modules_) {
-        result.emplace(iter.first);
+        result.emplace(symbols_.str(iter.first));
+    }
+    return result;
+}
+
+MemoryUsage &MemoryUsage::operator+=(const MemoryUsage &usage) {
+    num_generators += usage.num_generators;
+    vars += usage.vars;
+    exprs += usage.exprs;
+    slices += usage.slices;
+    stmts += usage.stmts;
+    debug_info += usage.debug_info;
+    connections += usage.connections;
+    return *this;
+}
+
+std::map<std::string, MemoryUsage> Context::memory_report() const {
+    std::map<std::string, MemoryUsage> result;
+    for (auto const &[symbol, generators] : modules_) {
+        auto &usage = result[std::string(symbols_.str(symbol))];
+        for (auto const &generator : generators) usage += compute_memory_usage(generator.get());
     }
     return result;
 }
@@ -8,6 +8,8 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "symbol.hh"
+
 namespace kratos {
 
 struct IRNode;
@@ -62,9 +64,29 @@ struct InterfaceRef;
 class Property;
 class Sequence;
 
+// estimated memory used by the ir nodes of one or more generators, in bytes
+struct MemoryUsage {
+    uint64_t num_generators = 0;
+    // variables and ports, excluding their sink and source sets
+    uint64_t vars = 0;
+    uint64_t exprs = 0;
+    uint64_t slices = 0;
+    uint64_t stmts = 0;
+    // fn_name_ln, comments and attributes of all the nodes above
+    uint64_t debug_info = 0;
+    // sink and source sets of the variables
+    uint64_t connections = 0;
+
+    [[nodiscard]] uint64_t total() const {
+        return vars + exprs + slices + stmts + debug_info + connections;
+    }
+    MemoryUsage& operator+=(const MemoryUsage& usage);
+};
+
 class Context {
 private:
-    std::unordered_map<std::string, std::set<std::shared_ptr<Generator>>> modules_;
+    // generators keyed by their interned names
+    std::unordered_map<Symbol, std::set<std::shared_ptr<Generator>>> modules_;
     std::unordered_map<const Generator*, uint64_t> generator_hash_;
     int max_instance_id_ = 0;
     int max_stmt_id_ = 0;
@@ -81,6 +103,9 @@ private:
     bool track_generated_ = false;
     std::unordered_set<Generator*> tracked_generators_;
 
+    // names of the generators and vars within this context
+    SymbolTable symbols_;
+
 public:
     Context() = default;
 
@@ -91,9 +116,12 @@ public:
     void add(Generator* generator);
 
     void add_hash(const Generator* generator, uint64_t hash);
+    // only updates an existing entry, safe to call from multiple threads on different generators
+    void set_hash(const Generator* generator, uint64_t hash);
     bool has_hash(const Generator* generator) const;
     uint64_t get_hash(const Generator* generator) const;
     void inline clear_hash() { generator_hash_.clear(); }
+    void inline remove_hash(const Generator* generator) { generator_hash_.erase(generator); }
 
     // managing the id for multiple invocation of dump database
     int& max_instance_id() { return max_instance_id_; }
@@ -121,6 +149,11 @@ public:
     inline void add_tracked_generator(Generator* gen) { tracked_generators_.emplace(gen); }
     bool is_generated_tracked(Generator *gen) const;
 
+    // memory usage of every generator in the context. generators with the same name, i.e.
+    // instances of the same module, are summed up
+    std::map<std::string, MemoryUsage> memory_report() const;
+    SymbolTable& symbols() { return symbols_; }
+
     void clear();
 };
 
@@ -0,0 +1,166 @@
+#include "db.hh"
+
+#include "except.hh"
+#include "fmt/format.h"
+
+using fmt::format;
+
+namespace kratos {
+
+DebugDatabaseWriter::DebugDatabaseWriter(const std::string &filename) {
+    if (sqlite3_open(filename.c_str(), &db_) != SQLITE_OK) {
+        std::string error = db_ ? sqlite3_errmsg(db_) : "out of memory";
+        sqlite3_close(db_);
+        throw UserException(::format("unable to open {0}: {1}", filename, error));
+    }
+    try {
+        // the database is written once at build time. if it fails half way, it is rebuilt
+        // anyway
+        execute("PRAGMA journal_mode = MEMORY");
+        execute("PRAGMA synchronous = OFF");
+        execute("PRAGMA temp_store = MEMORY");
+        execute("BEGIN TRANSACTION");
+    } catch (...) {
+        sqlite3_close(db_);
+        throw;
+    }
+}
+
+DebugDatabaseWriter::~DebugDatabaseWriter() {
+    for (auto *table : tables()) {
+        sqlite3_finalize(table->single);
+        sqlite3_finalize(table->batch);
+    }
+    if (!committed_) sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+    sqlite3_close(db_);
+}
+
+void DebugDatabaseWriter::insert(const MetaData &row) {
+    add_row(metadata_, {row.name, row.value});
+}
+
+void DebugDatabaseWriter::replace(const BreakPoint &row) {
+    add_row(breakpoint_, {row.id, row.filename, row.line_num});
+}
+
+// nullable columns
+template <typename T>
+static std::variant<std::nullptr_t, int64_t, std::string> to_value(const std::unique_ptr<T> &ptr) {
+    if (ptr) return static_cast<int64_t>(*ptr);
+    return nullptr;
+}
+
+void DebugDatabaseWriter::replace(const Variable &row) {
+    add_row(variable_, {row.id, to_value(row.handle), row.value, row.name, row.is_var,
+                        row.is_context});
+}
+
+void DebugDatabaseWriter::replace(const Connection &row) {
+    add_row(connection_,
+            {to_value(row.handle_from), row.var_from, to_value(row.handle_to), row.var_to});
+}
+
+void DebugDatabaseWriter::replace(const Hierarchy &row) {
+    add_row(hierarchy_, {to_value(row.parent_handle), row.child, to_value(row.child_handle)});
+}
+
+void DebugDatabaseWriter::replace(const ContextVariable &row) {
+    add_row(context_, {to_value(row.variable_id), to_value(row.breakpoint_id), row.name});
+}
+
+void DebugDatabaseWriter::replace(const Instance &row) {
+    add_row(instance_, {row.id, row.handle_name});
+}
+
+void DebugDatabaseWriter::replace(const InstanceSetEntry &row) {
+    add_row(instance_set_, {to_value(row.instance_id), to_value(row.breakpoint_id)});
+}
+
+void DebugDatabaseWriter::commit() {
+    for (auto *table : tables()) flush(*table, true);
+    // building the indices once is cheaper than updating them for every row
+    execute("CREATE INDEX IF NOT EXISTS variable_handle ON variable(handle)");
+    execute("CREATE INDEX IF NOT EXISTS context_breakpoint ON context(breakpoint_id)");
+    execute("CREATE INDEX IF NOT EXISTS instance_set_breakpoint ON instance_set(breakpoint_id)");
+    execute("COMMIT");
+    committed_ = true;
+}
+
+std::vector<DebugDatabaseWriter::Table *> DebugDatabaseWriter::tables() {
+    return {&metadata_, &breakpoint_, &variable_,  &connection_,
+            &hierarchy_, &context_,   &instance_, &instance_set_};
+}
+
+void DebugDatabaseWriter::add_row(Table &table, std::initializer_list<Value> values) {
+    table.values.insert(table.values.end(), values.begin(), values.end());
+    num_rows_++;
+    if (table.values.size() == batch_size * table.columns.size()) flush(table, false);
+}
+
+void DebugDatabaseWriter::flush(Table &table, bool all) {
+    auto const num_columns = table.columns.size();
+    auto const num_rows = table.values.size() / num_columns;
+    uint64_t row = 0;
+    auto write = [&](sqlite3_stmt *stmt, uint64_t rows) {
+        int index = 1;
+        for (uint64_t i = row * num_columns; i < (row + rows) * num_columns; i++) {
+            auto const &value = table.values[i];
+            if (auto const *integer = std::get_if<int64_t>(&value)) {
+                sqlite3_bind_int64(stmt, index++, *integer);
+            } else if (auto const *str = std::get_if<std::string>(&value)) {
+                // the buffer is alive until the statement is executed
+                sqlite3_bind_text(stmt, index++, str->c_str(), static_cast<int>(str->size()),
+                                  SQLITE_STATIC);
+            } else {
+                sqlite3_bind_null(stmt, index++);
+            }
+        }
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            throw InternalException(
+                ::format("unable to write to {0}: {1}", table.name, sqlite3_errmsg(db_)));
+        }
+        sqlite3_reset(stmt);
+        row += rows;
+    };
+    if (num_rows >= batch_size && !table.batch) table.batch = prepare(table, batch_size);
+    while (num_rows - row >= batch_size) write(table.batch, batch_size);
+    if (all) {
+        if (row < num_rows && !table.single) table.single = prepare(table, 1);
+        while (row < num_rows) write(table.single, 1);
+    }
+    table.values.erase(table.values.begin(),
+                       table.values.begin() + static_cast<int64_t>(row * num_columns));
+}
+
+sqlite3_stmt *DebugDatabaseWriter::prepare(const Table &table, uint32_t num_rows) {
+    std::string columns = table.columns.front();
+    std::string row = "(?";
+    for (uint64_t i = 1; i < table.columns.size(); i++) {
+        columns.append(", ").append(table.columns[i]);
+        row.append(", ?");
+    }
+    row.append(")");
+    std::string sql = ::format("{0} INTO {1} ({2}) VALUES ",
+                               table.replace ? "INSERT OR REPLACE" : "INSERT", table.name, columns);
+    for (uint32_t i = 0; i < num_rows; i++) {
+        if (i) sql.append(", ");
+        sql.append(row);
+    }
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql.c_str(), static_cast<int>(sql.size()), &stmt, nullptr) !=
+        SQLITE_OK) {
+        throw InternalException(::format("unable to prepare {0}: {1}", sql, sqlite3_errmsg(db_)));
+    }
+    return stmt;
+}
+
+void DebugDatabaseWriter::execute(const std::string &sql) {
+    char *error = nullptr;
+    if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+        std::string message = error ? error : "";
+        sqlite3_free(error);
+        throw InternalException(::format("unable to execute {0}: {1}", sql, message));
+    }
+}
+
+}  // namespace kratos
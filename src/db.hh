@@ -1,6 +1,8 @@
 #ifndef KRATOS_DB_HH
 #define KRATOS_DB_HH
 
+#include <variant>
+
 #include "sqlite_orm/sqlite_orm.h"
 
 namespace kratos {
@@ -95,6 +97,73 @@ auto inline init_storage(const std::string &filename) {
     return storage;
 }
 
+// bulk writer for the tables above. rows are buffered and written with prepared multi-row
+// inserts inside a single transaction, which is much faster than inserting them one by one
+// through sqlite_orm. the schema itself is still created by init_storage().
+// indices used by the debugger are created after all the rows are written
+class DebugDatabaseWriter {
+public:
+    explicit DebugDatabaseWriter(const std::string &filename);
+    DebugDatabaseWriter(const DebugDatabaseWriter &) = delete;
+    DebugDatabaseWriter &operator=(const DebugDatabaseWriter &) = delete;
+    // rolls back if commit() is not called
+    ~DebugDatabaseWriter();
+
+    // same semantics as sqlite_orm, i.e. replace overrides rows with the same primary key
+    void insert(const MetaData &row);
+    void replace(const BreakPoint &row);
+    void replace(const Variable &row);
+    void replace(const Connection &row);
+    void replace(const Hierarchy &row);
+    void replace(const ContextVariable &row);
+    void replace(const Instance &row);
+    void replace(const InstanceSetEntry &row);
+
+    void commit();
+
+    [[nodiscard]] uint64_t num_rows() const { return num_rows_; }
+
+    // rows per insert statement
+    static constexpr uint32_t batch_size = 128;
+
+private:
+    using Value = std::variant<std::nullptr_t, int64_t, std::string>;
+
+    struct Table {
+        Table(std::string name, std::vector<std::string> columns, bool replace)
+            : name(std::move(name)), columns(std::move(columns)), replace(replace) {}
+
+        std::string name;
+        std::vector<std::string> columns;
+        bool replace;
+        std::vector<Value> values;
+        // single-row and batch_size-row statements
+        sqlite3_stmt *single = nullptr;
+        sqlite3_stmt *batch = nullptr;
+    };
+
+    sqlite3 *db_ = nullptr;
+    Table metadata_{"metadata", {"name", "value"}, false};
+    Table breakpoint_{"breakpoint", {"id", "filename", "line_num"}, true};
+    Table variable_{"variable",
+                    {"id", "handle", "value", "name", "is_verilog_var", "is_context"},
+                    true};
+    Table connection_{"connection", {"handle_from", "var_from", "handle_to", "var_to"}, false};
+    Table hierarchy_{"hierarchy", {"parent_handle", "name", "handle"}, false};
+    Table context_{"context", {"variable_id", "breakpoint_id", "name"}, false};
+    Table instance_{"instance", {"id", "handle_name"}, true};
+    Table instance_set_{"instance_set", {"instance_id", "breakpoint_id"}, false};
+    uint64_t num_rows_ = 0;
+    bool committed_ = false;
+
+    std::vector<Table *> tables();
+    void add_row(Table &table, std::initializer_list<Value> values);
+    // writes full batches. the remaining rows are written as well if all is true
+    void flush(Table &table, bool all);
+    sqlite3_stmt *prepare(const Table &table, uint32_t num_rows);
+    void execute(const std::string &sql);
+};
+
 }  // namespace kratos
 
 #endif  // KRATOS_DB_HH
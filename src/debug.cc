@@ -3,10 +3,13 @@
 #include <mutex>
 
 #include "db.hh"
+#include "debug_symbols.hh"
 #include "except.hh"
 #include "fmt/format.h"
 #include "generator.hh"
+#include "graph.hh"
 #include "pass.hh"
+#include "scheduler.hh"
 #include "tb.hh"
 #include "util.hh"
 
@@ -151,9 +154,14 @@ private:
 };
 
 std::map<Stmt *, uint32_t> extract_debug_break_points(Generator *top) {
-    ExtractDebugVisitor visitor;
-    visitor.visit_root(top);
-    return visitor.map();
+    // every chunk of statements is visited on its own, and the results are merged at the end
+    auto const entries = parallel_collect_stmts<std::pair<Stmt *, uint32_t>>(
+        top, [](Stmt *stmt, std::vector<std::pair<Stmt *, uint32_t>> &buffer) {
+            ExtractDebugVisitor visitor;
+            visitor.visit_root(stmt);
+            buffer.insert(buffer.end(), visitor.map().begin(), visitor.map().end());
+        });
+    return std::map<Stmt *, uint32_t>(entries.begin(), entries.end());
 }
 
 class InsertVerilatorPublic : public IRVisitor {
@@ -281,15 +289,13 @@ void DebugDatabase::set_break_points(Generator *top, const std::string &ext) {
 
     // index all the front-end code
     // we are only interested in the files that has the extension
+    // the per breakpoint work is a few string compares, too little to be worth a task
     for (auto const &[stmt, id] : break_points_) {
-        auto fn_ln = stmt->fn_name_ln;
-        for (auto const &[fn, ln] : fn_ln) {
-            auto fn_ext = fs::get_ext(fn);
-            if (fn_ext == ext) {
+        for (auto const &fn_ln : stmt->fn_name_ln) {
+            if (fs::get_ext(fn_ln.first) == ext) {
                 // this is the one we need
-                stmt_mapping_.emplace(stmt, std::make_pair(fn, ln));
-                auto *gen = stmt->generator_parent();
-                generator_break_points_[gen].emplace(id);
+                stmt_mapping_.emplace(stmt, fn_ln);
+                generator_break_points_[stmt->generator_parent()].emplace(id);
                 break;
             }
         }
@@ -337,133 +343,174 @@ void DebugDatabase::set_generator_variable(
 
 class StmtContextVisitor : public IRVisitor {
 public:
+    using StmtContext = std::pair<Stmt *, std::map<std::string, std::pair<bool, std::string>>>;
+
+    explicit StmtContextVisitor(std::vector<StmtContext> &stmt_context)
+        : stmt_context_(stmt_context) {}
+
     void visit(IfStmt *stmt) override { add_content(stmt); }
 
     void visit(AssignStmt *stmt) override { add_content(stmt); }
 
-    const std::map<Stmt *, std::map<std::string, std::pair<bool, std::string>>> &stmt_context()
-        const {
-        return stmt_context_;
-    }
-
 private:
     void add_content(Stmt *stmt) {
         if (!stmt->scope_context().empty()) {
-            stmt_context_.emplace(stmt, stmt->scope_context());
+            stmt_context_.emplace_back(stmt, stmt->scope_context());
         }
     }
-    std::map<Stmt *, std::map<std::string, std::pair<bool, std::string>>> stmt_context_;
+    std::vector<StmtContext> &stmt_context_;
 };
 
 void DebugDatabase::set_stmt_context(kratos::Generator *top) {
-    StmtContextVisitor visitor;
-    visitor.visit_root(top);
-    stmt_context_ = visitor.stmt_context();
+    using StmtContext = StmtContextVisitor::StmtContext;
+    auto entries = parallel_collect_stmts<StmtContext>(
+        top, [](Stmt *stmt, std::vector<StmtContext> &buffer) {
+            StmtContextVisitor visitor(buffer);
+            visitor.visit_root(stmt);
+        });
+    stmt_context_.clear();
+    for (auto &[stmt, context] : entries) stmt_context_.emplace(stmt, std::move(context));
 }
 
-class ConnectionVisitor : public IRVisitor {
-public:
-    void visit(Generator *generator) override {
-        lock_.lock();
-        generators_.emplace(generator);
-        lock_.unlock();
-        // loop through the module instance statement, where it holds the connection
-        // information
-        uint64_t child_count = generator->stmts_count();
-        for (uint64_t i = 0; i < child_count; i++) {
-            auto const stmt = generator->get_stmt(i);
-            if (stmt->type() == StatementType::ModuleInstantiation) {
-                auto mod = stmt->as<ModuleInstantiationStmt>();
-                const auto *target = mod->target();
-                auto target_handle_name = target->handle_name();
-                auto mapping = mod->port_mapping();
-                for (auto [target_port, parent_var] : mapping) {
-                    // we ignore the constant connection
-                    if (parent_var->type() != VarType::PortIO) {
-                        if (target_port->port_direction() == PortDirection::In) {
-                            auto source = parent_var->sources();
-                            if (source.size() == 1) {
-                                parent_var = (*source.begin())->right();
-                            }
-                        } else {
-                            auto sink = parent_var->sinks();
-                            if (sink.size() == 1) {
-                                parent_var = (*sink.begin())->left();
-                            }
-                        }
-                    }
-                    if (parent_var->type() != VarType::PortIO) {
-                        continue;
-                    }
-                    auto *gen = parent_var->generator();
-                    auto gen_handle = gen->handle_name();
-                    // the direction is var -> var
-                    lock_.lock();
+// connections made by the module instantiations of a single generator
+void collect_generator_connections(
+    Generator *generator,
+    std::vector<std::pair<DebugDatabase::ConnectionMap::key_type,
+                          DebugDatabase::ConnectionMap::mapped_type>> &connections) {
+    // loop through the module instance statement, where it holds the connection
+    // information
+    uint64_t child_count = generator->stmts_count();
+    for (uint64_t i = 0; i < child_count; i++) {
+        auto const stmt = generator->get_stmt(i);
+        if (stmt->type() == StatementType::ModuleInstantiation) {
+            auto mod = stmt->as<ModuleInstantiationStmt>();
+            const auto *target = mod->target();
+            auto target_handle_name = target->handle_name();
+            auto mapping = mod->port_mapping();
+            for (auto [target_port, parent_var] : mapping) {
+                // we ignore the constant connection
+                if (parent_var->type() != VarType::PortIO) {
                     if (target_port->port_direction() == PortDirection::In) {
-                        connections_.emplace(
-                            std::make_pair(gen_handle, parent_var->to_string()),
-                            std::make_pair(target_handle_name, target_port->to_string()));
+                        auto source = parent_var->sources();
+                        if (source.size() == 1) {
+                            parent_var = (*source.begin())->right();
+                        }
                     } else {
-                        connections_.emplace(
-                            std::make_pair(target_handle_name, target_port->to_string()),
-                            std::make_pair(gen_handle, parent_var->to_string()));
+                        auto sink = parent_var->sinks();
+                        if (sink.size() == 1) {
+                            parent_var = (*sink.begin())->left();
+                        }
                     }
-                    lock_.unlock();
+                }
+                if (parent_var->type() != VarType::PortIO) {
+                    continue;
+                }
+                auto *gen = parent_var->generator();
+                auto gen_handle = gen->handle_name();
+                // the direction is var -> var
+                if (target_port->port_direction() == PortDirection::In) {
+                    connections.emplace_back(
+                        std::make_pair(gen_handle, parent_var->to_string()),
+                        std::make_pair(target_handle_name, target_port->to_string()));
+                } else {
+                    connections.emplace_back(
+                        std::make_pair(target_handle_name, target_port->to_string()),
+                        std::make_pair(gen_handle, parent_var->to_string()));
                 }
             }
         }
     }
-
-    const DebugDatabase::ConnectionMap &connections() const { return connections_; }
-    const std::unordered_set<Generator *> &generators() const { return generators_; }
-
-private:
-    DebugDatabase::ConnectionMap connections_;
-    std::unordered_set<Generator *> generators_;
-    std::mutex lock_;
-};
+}
 
 void DebugDatabase::set_generator_connection(kratos::Generator *top) {
-    // we create a IR visitor to visit the generators
-    ConnectionVisitor visitor;
-    // this can be parallelized
-    visitor.visit_generator_root_p(top);
-    connection_map_ = visitor.connections();
-    generators_ = visitor.generators();
+    // every generator is processed on its own with its own buffer. buffers are merged in the
+    // generator order afterwards, so no lock is needed
+    GeneratorGraph graph(top);
+    auto const generators = graph.get_sorted_generators();
+    std::vector<std::vector<std::pair<ConnectionMap::key_type, ConnectionMap::mapped_type>>>
+        buffers(generators.size());
+    parallel_for_chunks(generators.size(),
+                        [&](uint64_t i) { collect_generator_connections(generators[i], buffers[i]); });
+    connection_map_.clear();
+    for (auto const &buffer : buffers) connection_map_.insert(buffer.begin(), buffer.end());
+    generators_ = std::unordered_set<Generator *>(generators.begin(), generators.end());
 }
 
-class HierarchyVisitor : public IRVisitor {
-public:
-    void visit(Generator *generator) override {
+void DebugDatabase::set_generator_hierarchy(kratos::Generator *top) {
+    // pre-order, so that the parents are listed first
+    std::vector<Generator *> generators;
+    std::vector<Generator *> working_set = {top};
+    while (!working_set.empty()) {
+        auto *generator = working_set.back();
+        working_set.pop_back();
+        generators.emplace_back(generator);
+        auto const children = generator->get_child_generators();
+        for (auto it = children.rbegin(); it != children.rend(); it++) {
+            working_set.emplace_back(it->get());
+        }
+    }
+    hierarchy_.clear();
+    for (auto *generator : generators) {
         auto handle_name = generator->handle_name();
         for (auto const &gen : generator->get_child_generators()) {
-            hierarchy_.emplace_back(std::make_pair(handle_name, gen.get()));
+            hierarchy_.emplace_back(handle_name, gen.get());
         }
     }
-    const std::vector<std::pair<std::string, Generator *>> &hierarchy() const { return hierarchy_; }
+}
 
-private:
-    std::vector<std::pair<std::string, Generator *>> hierarchy_;
+struct VariableRow {
+    std::string name;
+    std::string value;
+    bool is_var;
 };
 
-void DebugDatabase::set_generator_hierarchy(kratos::Generator *top) {
-    HierarchyVisitor visitor;
-    // no parallel to make it in order
-    visitor.visit_generator_root(top);
-    hierarchy_ = visitor.hierarchy();
-}
-
-void DebugDatabase::save_database(const std::string &filename, bool override) {
-    if (override) {
-        if (fs::exists(filename)) {
-            fs::remove(filename);
+// arrays and packed structs are flattened into one row per element
+void flatten_variable(Var *var, const std::string &name, const std::string &value,
+                      std::vector<VariableRow> &rows) {
+    if (!var) {
+        // directly store it
+        if (name.empty()) {
+            throw UserException(::format("Non-variable cannot have empty name in database"));
+        }
+        rows.push_back({name, value, false});
+        return;
+    }
+    if (var->size().size() > 1 || var->size().front() > 1) {
+        // it's an array. need to flatten it
+        auto slices = get_flatten_slices(var);
+        for (auto const &slice : slices) {
+            std::string new_name;
+            if (!name.empty()) {
+                new_name = name;
+                for (auto const &s : slice) new_name = ::format("{0}.{1}", new_name, s);
+            }
+            std::string new_value = var->name;
+            for (auto const &s : slice) new_value = ::format("{0}[{1}]", new_value, s);
+            rows.push_back({new_name, new_value, true});
+        }
+    } else if (var->is_struct()) {
+        // it's an packed array
+        const PackedStruct *def = nullptr;
+        if (var->type() == VarType::PortIO) {
+            def = &reinterpret_cast<PortPackedStruct *>(var)->packed_struct();
+        } else if (var->type() == VarType::Base) {
+            def = &reinterpret_cast<VarPackedStruct *>(var)->packed_struct();
+        }
+        if (!def) return;
+        for (auto const &iter : def->attributes) {
+            auto const &attr_name = std::get<0>(iter);
+            // we need to store lots of them
+            auto new_name = name.empty() ? "" : ::format("{0}.{1}", name, attr_name);
+            rows.push_back({new_name, ::format("{0}.{1}", var->name, attr_name), true});
         }
+    } else {
+        // the normal one
+        rows.push_back({name, var->name, true});
     }
-    auto storage = init_storage(filename);
-    storage.sync_schema();
-    // insert tables
-    // use transaction to speed up
-    auto guard = storage.transaction_guard();
+}
+
+template <typename Writer>
+void DebugDatabase::write_rows(Writer &storage) {
     // metadata
     MetaData top_name{"top_name", top_name_};
     storage.insert(top_name);
@@ -492,125 +539,94 @@ void DebugDatabase::save_database(const std::string &filename, bool override) {
         }
     }
 
-    // variables
-    int variable_count = 0;
-    std::unordered_set<Var *> var_id_set;
-    // function to create variable and flatten the hierarchy
-    auto create_variable = [&](Var *var_, const int handle_id_, const std::string& name_,
-                               const std::string &value_, bool is_context_,
-                               uint32_t breakpoint_id_ = 0) {
-        Variable v;
-        v.is_var = var_ != nullptr;
-        v.is_context = is_context_;
-        v.handle = std::make_unique<int>(handle_id_);
-        v.name = "";
-
-        auto add_context = [&]() {
-            if (is_context_) {
-                // create context mapping as well
-                ContextVariable c_v{std::make_unique<uint32_t>(breakpoint_id_),
-                                    std::make_unique<int>(v.id), v.name};
-                storage.replace(c_v);
-            }
-        };
-
-        if (var_) {
-            // it is an variable
-            if (var_->size().size() > 1 || var_->size().front() > 1) {
-                // it's an array. need to flatten it
-                auto slices = get_flatten_slices(var_);
-                for (auto const &slice : slices) {
-                    std::string new_name;
-                    if (!name_.empty()) {
-                        new_name = name_;
-                        for (auto const &s: slice)
-                            new_name = ::format("{0}.{1}", new_name, s);
-                    }
-                    std::string value = var_->name;
-                    for (auto const &s: slice)
-                        value = ::format("{0}[{1}]", value, s);
-                    v.name = new_name;
-                    v.value = value;
-                    v.id = variable_count++;
-                    storage.replace(v);
-                    add_context();
-                }
-            } else if (var_->is_struct()) {
-                // it's an packed array
-                if (var_->type() == VarType::PortIO) {
-                    auto *p = reinterpret_cast<PortPackedStruct *>(var_);
-                    auto const &def = p->packed_struct();
-                    for (auto const &iter : def.attributes) {
-                        auto const &attr_name = std::get<0>(iter);
-                        // we need to store lots of them
-                        if (!name_.empty()) v.name = ::format("{0}.{1}", name_, attr_name);
-                        v.value = ::format("{0}.{1}", var_->name, attr_name);
-                        v.id = variable_count++;
-                        storage.replace(v);
-                        add_context();
-                    }
-                } else if (var_->type() == VarType::Base) {
-                    auto *p = reinterpret_cast<VarPackedStruct *>(var_);
-                    auto const &def = p->packed_struct();
-                    for (auto const &iter : def.attributes) {
-                        auto const &attr_name = std::get<0>(iter);
-                        // we need to store lots of them
-                        if (!name_.empty()) v.name = ::format("{0}.{1}", name_, attr_name);
-                        v.value = ::format("{0}.{1}", var_->name, attr_name);
-                        v.id = variable_count++;
-                        storage.replace(v);
-                        add_context();
-                    }
-                }
-            } else {
-                // the normal one
-                v.name = name_;
-                v.value = var_->name;
-                v.id = variable_count++;
-                storage.replace(v);
-                add_context();
-            }
-            var_id_set.emplace(var_);
-        } else {
-            // directly store it
-            if (name_.empty()) {
-                throw UserException(::format("Non-variable cannot have empty name in database"));
-            }
-            v.name = name_;
-            v.value = value_;
-            v.id = variable_count++;
-            storage.replace(v);
-            add_context();
-        }
+    // variables are flattened in parallel, one work item per generator or breakpoint. ids are
+    // assigned afterwards in item order
+    struct VariableTask {
+        uint32_t handle;
+        bool is_context;
+        uint32_t breakpoint_id;
+        std::function<void(std::vector<VariableRow> &)> fn;
     };
+    std::vector<VariableTask> tasks;
     for (auto const &[handle_name, gen_map] : variable_mapping_) {
         auto const &[gen, vars] = gen_map;
         if (gen_id_map.find(gen) == gen_id_map.end())
             throw InternalException(::format("Unable to find generator {0}", gen->handle_name()));
         auto id = gen_id_map.at(gen);
-        for (auto const &[front_var, var] : vars) {
-            auto gen_var = gen->get_var(var);
-            if (!gen_var) throw InternalException(::format("Unable to get variable {0}", var));
-            create_variable(gen_var.get(), id, front_var, "", false);
-        }
-        auto all_vars = gen->get_all_var_names();
-        for (auto const &var_name : all_vars) {
-            auto var = gen->get_var(var_name);
-            // continue because we already have that variable stored
-            if (var_id_set.find(var.get()) != var_id_set.end()) continue;
-            if (var && (var->type() == VarType::Base || var->type() == VarType::PortIO)) {
-                create_variable(var.get(), id, "", "", false);
+        auto fn = [gen = gen, &vars = vars](std::vector<VariableRow> &rows) {
+            std::unordered_set<Var *> var_id_set;
+            for (auto const &[front_var, var] : vars) {
+                auto gen_var = gen->get_var(var);
+                if (!gen_var) throw InternalException(::format("Unable to get variable {0}", var));
+                flatten_variable(gen_var.get(), front_var, "", rows);
+                var_id_set.emplace(gen_var.get());
             }
-        }
+            auto all_vars = gen->get_all_var_names();
+            for (auto const &var_name : all_vars) {
+                auto var = gen->get_var(var_name);
+                // continue because we already have that variable stored
+                if (var_id_set.find(var.get()) != var_id_set.end()) continue;
+                if (var && (var->type() == VarType::Base || var->type() == VarType::PortIO)) {
+                    flatten_variable(var.get(), "", "", rows);
+                }
+            }
+        };
+        tasks.push_back({id, false, 0, fn});
     }
     for (auto const &[gen, map] : generator_values_) {
         auto const handle_name = gen->handle_name();
         if (handle_id_map.find(handle_name) == handle_id_map.end())
             throw InternalException(::format("Unable to find id for {0}", handle_name));
         auto id = handle_id_map.at(handle_name);
-        for (auto const &[name, value] : map) {
-            auto var = gen->get_var(name);
-            create_variable(var.get(), id, name, value, false);
+        auto fn = [gen = gen, &map = map](std::vector<VariableRow> &rows) {
+            for (auto const &[name, value] : map) {
+                auto var = gen->get_var(name);
+                flatten_variable(var.get(), name, value, rows);
+            }
+        };
+        tasks.push_back({id, false, 0, fn});
+    }
+    // local context variables
+    for (auto const &[stmt, id] : break_points_) {
+        // use breakpoint as an index since we can only get context as we hit potential breakpoints
+        auto *gen = stmt->generator_parent();
+        auto handle_name = gen->handle_name();
+        if (stmt_context_.find(stmt) == stmt_context_.end()) continue;
+        if (handle_id_map.find(handle_name) == handle_id_map.end())
+            throw InternalException(::format("Unable to find {0} in handle id map", handle_name));
+
+        auto instance_id = handle_id_map.at(handle_name);
+        auto const &values = stmt_context_.at(stmt);
+        auto fn = [gen, &values](std::vector<VariableRow> &rows) {
+            for (auto const &[key, entry] : values) {
+                auto const &[is_var, value] = entry;
+                auto *gen_var = is_var ? gen->get_var(value).get() : nullptr;
+                flatten_variable(gen_var, key, value, rows);
+            }
+        };
+        tasks.push_back({instance_id, true, id, fn});
+    }
+    std::vector<std::vector<VariableRow>> variable_rows(tasks.size());
+    parallel_for_chunks(tasks.size(), [&](uint64_t i) { tasks[i].fn(variable_rows[i]); });
+
+    int variable_count = 0;
+    for (uint64_t i = 0; i < tasks.size(); i++) {
+        auto const &task = tasks[i];
+        for (auto &row : variable_rows[i]) {
+            Variable v;
+            v.id = variable_count++;
+            v.handle = std::make_unique<int>(static_cast<int>(task.handle));
+            v.value = std::move(row.value);
+            v.name = std::move(row.name);
+            v.is_var = row.is_var;
+            v.is_context = task.is_context;
+            storage.replace(v);
+            if (task.is_context) {
+                // create context mapping as well
+                ContextVariable c_v{std::make_unique<uint32_t>(task.breakpoint_id),
+                                    std::make_unique<int>(v.id), v.name};
+                storage.replace(c_v);
+            }
         }
     }
 
@@ -642,33 +658,34 @@ void DebugDatabase::save_database(const std::string &filename, bool override) {
         storage.replace(h);
     }
 
-    // local context variables
-    for (auto const &[stmt, id] : break_points_) {
-        // use breakpoint as an index since we can only get context as we hit potential breakpoints
-        auto const &gen = stmt->generator_parent();
-        auto handle_name = gen->handle_name();
-        if (stmt_context_.find(stmt) == stmt_context_.end()) continue;
-        if (handle_id_map.find(handle_name) == handle_id_map.end())
-            throw InternalException(::format("Unable to find {0} in handle id map", handle_name));
-
-        auto instance_id = handle_id_map.at(handle_name);
-        auto values = stmt_context_.at(stmt);
-
-        for (auto const &[key, entry] : values) {
-            auto const &[is_var, value] = entry;
-            auto *gen_var = is_var ? gen->get_var(value).get() : nullptr;
-            create_variable(gen_var, instance_id, key, value, true, id);
-        }
-    }
-
     // instance id set
     for (auto const &[stmt, id] : break_points_) {
         auto gen_id = stmt->generator_parent()->generator_id;
         InstanceSetEntry entry{std::make_unique<int>(gen_id), std::make_unique<int>(id)};
         storage.replace(entry);
     }
+}
+
+void DebugDatabase::save_database(const std::string &filename, bool override) {
+    if (override) {
+        if (fs::exists(filename)) {
+            fs::remove(filename);
+        }
+    }
+    {
+        // only the schema is created through sqlite_orm
+        auto storage = init_storage(filename);
+        storage.sync_schema();
+    }
+    DebugDatabaseWriter storage(filename);
+    write_rows(storage);
+    storage.commit();
+}
 
-    guard.commit();
+void DebugDatabase::save_symbol_file(const std::string &filename) {
+    DebugSymbolWriter writer;
+    write_rows(writer);
+    writer.save(filename);
 }
 
 void inject_clock_break_points(Generator *top) {
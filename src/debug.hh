@@ -54,6 +54,8 @@ public:
 
     void save_database(const std::string &filename, bool override);
     void save_database(const std::string &filename) { save_database(filename, true); }
+    // compact binary alternative to the database, see debug_symbols.hh
+    void save_symbol_file(const std::string &filename);
 
 private:
     std::map<Stmt *, uint32_t> break_points_;
@@ -70,6 +72,10 @@ private:
 
     std::string top_name_ = "TOP";
     Context *context_ = nullptr;
+
+    // writes every row to either the database or the symbol file
+    template <typename Writer>
+    void write_rows(Writer &storage);
 };
 
 }  // namespace kratos
@@ -0,0 +1,262 @@
+#include "debug_symbols.hh"
+
+#include <cstring>
+#include <fstream>
+
+#include "db.hh"
+#include "except.hh"
+#include "fmt/format.h"
+#include "util.hh"
+
+using fmt::format;
+
+namespace kratos {
+
+using namespace debug_symbols;
+
+template <typename T>
+static int32_t to_id(const std::unique_ptr<T> &ptr) {
+    return ptr ? static_cast<int32_t>(*ptr) : null_id;
+}
+
+void DebugSymbolWriter::insert(const MetaData &row) {
+    metadata_.push_back({add_string(row.name), add_string(row.value)});
+}
+
+void DebugSymbolWriter::replace(const BreakPoint &row) {
+    breakpoints_[row.id] = {row.id, row.line_num, add_string(row.filename), 0, 0, 0, 0};
+}
+
+void DebugSymbolWriter::replace(const Variable &row) {
+    variables_[row.id] = {row.id,
+                          to_id(row.handle),
+                          add_string(row.value),
+                          add_string(row.name),
+                          row.is_var,
+                          row.is_context,
+                          {0, 0}};
+}
+
+void DebugSymbolWriter::replace(const Connection &row) {
+    connections_.push_back({to_id(row.handle_from), to_id(row.handle_to), add_string(row.var_from),
+                            add_string(row.var_to)});
+}
+
+void DebugSymbolWriter::replace(const Hierarchy &row) {
+    hierarchy_.push_back({to_id(row.parent_handle), to_id(row.child_handle), add_string(row.child)});
+}
+
+void DebugSymbolWriter::replace(const ContextVariable &row) {
+    contexts_.push_back({to_id(row.breakpoint_id), to_id(row.variable_id), add_string(row.name)});
+}
+
+void DebugSymbolWriter::replace(const Instance &row) {
+    instances_[row.id] = {row.id, add_string(row.handle_name)};
+}
+
+void DebugSymbolWriter::replace(const InstanceSetEntry &row) {
+    instance_sets_.push_back({to_id(row.breakpoint_id), to_id(row.instance_id)});
+}
+
+StringRef DebugSymbolWriter::add_string(const std::string &str) {
+    // names repeat a lot, e.g. file names and flattened array elements
+    auto it = string_index_.find(str);
+    if (it != string_index_.end()) return it->second;
+    StringRef ref{static_cast<uint32_t>(strings_.size()), static_cast<uint32_t>(str.size())};
+    strings_.append(str);
+    string_index_.emplace(str, ref);
+    return ref;
+}
+
+template <typename Iter>
+static Section append_section(std::string &buffer, Iter begin, Iter end) {
+    // every section is 8-byte aligned so that the records can be used in place
+    buffer.resize((buffer.size() + 7) / 8 * 8);
+    Section section{buffer.size(), 0};
+    for (auto it = begin; it != end; it++) {
+        buffer.append(reinterpret_cast<const char *>(&*it), sizeof(*it));
+        section.count++;
+    }
+    return section;
+}
+
+void DebugSymbolWriter::save(const std::string &filename) {
+    // group the contexts and instance ids by breakpoint
+    auto by_breakpoint = [](const auto &a, const auto &b) {
+        return a.breakpoint_id < b.breakpoint_id;
+    };
+    std::stable_sort(contexts_.begin(), contexts_.end(), by_breakpoint);
+    std::stable_sort(instance_sets_.begin(), instance_sets_.end(), by_breakpoint);
+    for (auto &[id, breakpoint] : breakpoints_) {
+        auto const key = static_cast<int32_t>(id);
+        auto [context_begin, context_end] = std::equal_range(
+            contexts_.begin(), contexts_.end(), ContextRecord{key, 0, {}}, by_breakpoint);
+        breakpoint.context_begin = static_cast<uint32_t>(context_begin - contexts_.begin());
+        breakpoint.context_count = static_cast<uint32_t>(context_end - context_begin);
+        auto [set_begin, set_end] =
+            std::equal_range(instance_sets_.begin(), instance_sets_.end(),
+                             InstanceSetRecord{key, 0}, by_breakpoint);
+        breakpoint.instance_set_begin = static_cast<uint32_t>(set_begin - instance_sets_.begin());
+        breakpoint.instance_set_count = static_cast<uint32_t>(set_end - set_begin);
+    }
+    // breakpoint ids are statement ids, which are dense
+    std::vector<int32_t> breakpoint_index(breakpoints_.empty() ? 0
+                                                               : breakpoints_.rbegin()->first + 1,
+                                          null_id);
+    int32_t index = 0;
+    for (auto const &iter : breakpoints_) breakpoint_index[iter.first] = index++;
+
+    auto values = [](const auto &map) {
+        std::vector<typename std::decay_t<decltype(map)>::mapped_type> result;
+        result.reserve(map.size());
+        for (auto const &iter : map) result.emplace_back(iter.second);
+        return result;
+    };
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byte_order_mark = byte_order_mark;
+    std::string buffer(sizeof(Header), '\0');
+    header.strings = append_section(buffer, strings_.begin(), strings_.end());
+    header.metadata = append_section(buffer, metadata_.begin(), metadata_.end());
+    auto const instances = values(instances_);
+    header.instances = append_section(buffer, instances.begin(), instances.end());
+    auto const breakpoints = values(breakpoints_);
+    header.breakpoints = append_section(buffer, breakpoints.begin(), breakpoints.end());
+    header.breakpoint_index =
+        append_section(buffer, breakpoint_index.begin(), breakpoint_index.end());
+    auto const variables = values(variables_);
+    header.variables = append_section(buffer, variables.begin(), variables.end());
+    header.contexts = append_section(buffer, contexts_.begin(), contexts_.end());
+    header.instance_sets = append_section(buffer, instance_sets_.begin(), instance_sets_.end());
+    header.connections = append_section(buffer, connections_.begin(), connections_.end());
+    header.hierarchy = append_section(buffer, hierarchy_.begin(), hierarchy_.end());
+    std::memcpy(buffer.data(), &header, sizeof(header));
+
+    // written to a temporary file first, so that a failed write never leaves a truncated file
+    auto const temp_filename = filename + ".tmp";
+    {
+        std::ofstream stream(temp_filename, std::ios::binary | std::ios::trunc);
+        if (!stream) throw UserException(::format("unable to write {0}", temp_filename));
+        stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        stream.close();
+        if (!stream) {
+            fs::remove(temp_filename);
+            throw UserException(::format("unable to write {0}", temp_filename));
+        }
+    }
+    if (!fs::rename(temp_filename, filename)) {
+        fs::remove(temp_filename);
+        throw UserException(::format("unable to write {0}", filename));
+    }
+}
+
+template <typename T>
+static void check_section(const Section &section, uint64_t file_size, const std::string &filename) {
+    if (section.offset % alignof(T) != 0 || section.offset > file_size ||
+        section.count > (file_size - section.offset) / sizeof(T)) {
+        throw UserException(::format("{0} is corrupted", filename));
+    }
+}
+
+DebugSymbolFile::DebugSymbolFile(const std::string &filename)
+    : file_(std::make_unique<fs::MappedFile>(filename)) {
+    auto const content = file_->data();
+    data_ = content.data();
+    header_ = reinterpret_cast<const Header *>(data_);
+    if (content.size() < sizeof(Header) || std::memcmp(header_->magic, magic, sizeof(magic)) != 0)
+        throw UserException(::format("{0} is not a debug symbol file", filename));
+    if (header_->version != version || header_->byte_order_mark != byte_order_mark)
+        throw UserException(::format("{0} is written by an incompatible version", filename));
+    auto const size = content.size();
+    check_section<char>(header_->strings, size, filename);
+    check_section<MetadataRecord>(header_->metadata, size, filename);
+    check_section<InstanceRecord>(header_->instances, size, filename);
+    check_section<BreakPointRecord>(header_->breakpoints, size, filename);
+    check_section<int32_t>(header_->breakpoint_index, size, filename);
+    check_section<VariableRecord>(header_->variables, size, filename);
+    check_section<ContextRecord>(header_->contexts, size, filename);
+    check_section<InstanceSetRecord>(header_->instance_sets, size, filename);
+    check_section<ConnectionRecord>(header_->connections, size, filename);
+    check_section<HierarchyRecord>(header_->hierarchy, size, filename);
+}
+
+DebugSymbolFile::~DebugSymbolFile() = default;
+
+std::string_view DebugSymbolFile::str(const StringRef &ref) const {
+    auto const &strings = header_->strings;
+    if (ref.offset > strings.count || ref.size > strings.count - ref.offset)
+        throw UserException("invalid string in debug symbol file");
+    return {data_ + strings.offset + ref.offset, ref.size};
+}
+
+std::string_view DebugSymbolFile::metadata(std::string_view name) const {
+    for (auto const &entry : section<MetadataRecord>(header_->metadata)) {
+        if (str(entry.name) == name) return str(entry.value);
+    }
+    return {};
+}
+
+const BreakPointRecord *DebugSymbolFile::breakpoint(uint32_t id) const {
+    auto const index = section<int32_t>(header_->breakpoint_index);
+    if (id >= index.size() || index[id] == null_id) return nullptr;
+    auto const breakpoints = this->breakpoints();
+    auto const i = static_cast<uint64_t>(index[id]);
+    return i < breakpoints.size() ? &breakpoints[i] : nullptr;
+}
+
+const VariableRecord *DebugSymbolFile::variable(int32_t id) const {
+    auto const variables = section<VariableRecord>(header_->variables);
+    // ids are assigned sequentially, so the id is usually the index
+    if (id >= 0 && static_cast<uint64_t>(id) < variables.size() && variables[id].id == id)
+        return &variables[id];
+    auto it = std::lower_bound(variables.begin(), variables.end(), id,
+                               [](const VariableRecord &v, int32_t value) { return v.id < value; });
+    return it != variables.end() && it->id == id ? it : nullptr;
+}
+
+const InstanceRecord *DebugSymbolFile::instance(int32_t id) const {
+    auto const instances = section<InstanceRecord>(header_->instances);
+    auto it = std::lower_bound(instances.begin(), instances.end(), id,
+                               [](const InstanceRecord &i, int32_t value) { return i.id < value; });
+    return it != instances.end() && it->id == id ? it : nullptr;
+}
+
+DebugSymbolFile::Range<ContextRecord> DebugSymbolFile::contexts(
+    const BreakPointRecord &breakpoint) const {
+    auto const contexts = section<ContextRecord>(header_->contexts);
+    auto const begin = std::min<uint64_t>(breakpoint.context_begin, contexts.size());
+    auto const end = std::min<uint64_t>(begin + breakpoint.context_count, contexts.size());
+    return {contexts.begin() + begin, contexts.begin() + end};
+}
+
+DebugSymbolFile::Range<InstanceSetRecord> DebugSymbolFile::instance_sets(
+    const BreakPointRecord &breakpoint) const {
+    auto const sets = section<InstanceSetRecord>(header_->instance_sets);
+    auto const begin = std::min<uint64_t>(breakpoint.instance_set_begin, sets.size());
+    auto const end = std::min<uint64_t>(begin + breakpoint.instance_set_count, sets.size());
+    return {sets.begin() + begin, sets.begin() + end};
+}
+
+DebugSymbolFile::Range<InstanceRecord> DebugSymbolFile::instances() const {
+    return section<InstanceRecord>(header_->instances);
+}
+
+DebugSymbolFile::Range<BreakPointRecord> DebugSymbolFile::breakpoints() const {
+    return section<BreakPointRecord>(header_->breakpoints);
+}
+
+DebugSymbolFile::Range<VariableRecord> DebugSymbolFile::variables() const {
+    return section<VariableRecord>(header_->variables);
+}
+
+DebugSymbolFile::Range<ConnectionRecord> DebugSymbolFile::connections() const {
+    return section<ConnectionRecord>(header_->connections);
+}
+
+DebugSymbolFile::Range<HierarchyRecord> DebugSymbolFile::hierarchy() const {
+    return section<HierarchyRecord>(header_->hierarchy);
+}
+
+}  // namespace kratos
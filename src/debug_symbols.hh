@@ -0,0 +1,214 @@
+#ifndef KRATOS_DEBUG_SYMBOLS_HH
+#define KRATOS_DEBUG_SYMBOLS_HH
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace kratos {
+
+namespace fs {
+class MappedFile;
+}
+
+// compact binary alternative to the debug database. the file is a header followed by a string
+// table and arrays of fixed-size records, so it can be memory-mapped and used in place without
+// SQLite. all the integers are stored in the native byte order, which is checked on load.
+// ids that are null in the database are stored as -1
+namespace debug_symbols {
+
+constexpr char magic[8] = {'K', 'R', 'A', 'T', 'O', 'S', 'D', 'B'};
+constexpr uint32_t version = 1;
+constexpr uint32_t byte_order_mark = 0x01020304;
+constexpr int32_t null_id = -1;
+
+// a string in the string table
+struct StringRef {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct Section {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    // raw bytes
+    Section strings;
+    Section metadata;
+    // sorted by id
+    Section instances;
+    // sorted by id
+    Section breakpoints;
+    // indexed by breakpoint id. holds the index into breakpoints, or -1 if there is no such
+    // breakpoint
+    Section breakpoint_index;
+    // sorted by id
+    Section variables;
+    // sorted by breakpoint id
+    Section contexts;
+    // sorted by breakpoint id
+    Section instance_sets;
+    Section connections;
+    Section hierarchy;
+};
+
+struct MetadataRecord {
+    StringRef name;
+    StringRef value;
+};
+
+struct InstanceRecord {
+    int32_t id;
+    StringRef handle_name;
+};
+
+struct BreakPointRecord {
+    uint32_t id;
+    uint32_t line_num;
+    StringRef filename;
+    // range in contexts and instance_sets
+    uint32_t context_begin;
+    uint32_t context_count;
+    uint32_t instance_set_begin;
+    uint32_t instance_set_count;
+};
+
+struct VariableRecord {
+    int32_t id;
+    int32_t handle;
+    StringRef value;
+    StringRef name;
+    uint8_t is_var;
+    uint8_t is_context;
+    uint8_t padding[2];
+};
+
+struct ContextRecord {
+    int32_t breakpoint_id;
+    int32_t variable_id;
+    StringRef name;
+};
+
+struct InstanceSetRecord {
+    int32_t breakpoint_id;
+    int32_t instance_id;
+};
+
+struct ConnectionRecord {
+    int32_t handle_from;
+    int32_t handle_to;
+    StringRef var_from;
+    StringRef var_to;
+};
+
+struct HierarchyRecord {
+    int32_t parent_handle;
+    int32_t child_handle;
+    StringRef name;
+};
+
+}  // namespace debug_symbols
+
+// rows are defined in db.hh
+struct MetaData;
+struct BreakPoint;
+struct Variable;
+struct Connection;
+struct Hierarchy;
+struct ContextVariable;
+struct Instance;
+struct InstanceSetEntry;
+
+// same interface as DebugDatabaseWriter
+class DebugSymbolWriter {
+public:
+    void insert(const MetaData &row);
+    void replace(const BreakPoint &row);
+    void replace(const Variable &row);
+    void replace(const Connection &row);
+    void replace(const Hierarchy &row);
+    void replace(const ContextVariable &row);
+    void replace(const Instance &row);
+    void replace(const InstanceSetEntry &row);
+
+    void save(const std::string &filename);
+
+private:
+    std::string strings_;
+    std::unordered_map<std::string, debug_symbols::StringRef> string_index_;
+
+    std::vector<debug_symbols::MetadataRecord> metadata_;
+    std::map<int32_t, debug_symbols::InstanceRecord> instances_;
+    std::map<uint32_t, debug_symbols::BreakPointRecord> breakpoints_;
+    std::map<int32_t, debug_symbols::VariableRecord> variables_;
+    std::vector<debug_symbols::ContextRecord> contexts_;
+    std::vector<debug_symbols::InstanceSetRecord> instance_sets_;
+    std::vector<debug_symbols::ConnectionRecord> connections_;
+    std::vector<debug_symbols::HierarchyRecord> hierarchy_;
+
+    debug_symbols::StringRef add_string(const std::string &str);
+};
+
+// read-only view of a symbol file. lookups by breakpoint and variable id are O(1), lookups by
+// instance id are a binary search
+class DebugSymbolFile {
+public:
+    template <typename T>
+    struct Range {
+        const T *begin_;
+        const T *end_;
+
+        [[nodiscard]] const T *begin() const { return begin_; }
+        [[nodiscard]] const T *end() const { return end_; }
+        [[nodiscard]] uint64_t size() const { return end_ - begin_; }
+        const T &operator[](uint64_t index) const { return begin_[index]; }
+    };
+
+    explicit DebugSymbolFile(const std::string &filename);
+    ~DebugSymbolFile();
+
+    [[nodiscard]] std::string_view str(const debug_symbols::StringRef &ref) const;
+    // empty if not found
+    [[nodiscard]] std::string_view metadata(std::string_view name) const;
+
+    // nullptr if not found
+    [[nodiscard]] const debug_symbols::BreakPointRecord *breakpoint(uint32_t id) const;
+    [[nodiscard]] const debug_symbols::VariableRecord *variable(int32_t id) const;
+    [[nodiscard]] const debug_symbols::InstanceRecord *instance(int32_t id) const;
+
+    // context variables and instance ids of a breakpoint
+    [[nodiscard]] Range<debug_symbols::ContextRecord> contexts(
+        const debug_symbols::BreakPointRecord &breakpoint) const;
+    [[nodiscard]] Range<debug_symbols::InstanceSetRecord> instance_sets(
+        const debug_symbols::BreakPointRecord &breakpoint) const;
+
+    [[nodiscard]] Range<debug_symbols::InstanceRecord> instances() const;
+    [[nodiscard]] Range<debug_symbols::BreakPointRecord> breakpoints() const;
+    [[nodiscard]] Range<debug_symbols::VariableRecord> variables() const;
+    [[nodiscard]] Range<debug_symbols::ConnectionRecord> connections() const;
+    [[nodiscard]] Range<debug_symbols::HierarchyRecord> hierarchy() const;
+
+private:
+    std::unique_ptr<fs::MappedFile> file_;
+    const char *data_ = nullptr;
+    const debug_symbols::Header *header_ = nullptr;
+
+    template <typename T>
+    Range<T> section(const debug_symbols::Section &section) const {
+        auto const *begin = reinterpret_cast<const T *>(data_ + section.offset);
+        return {begin, begin + section.count};
+    }
+};
+
+}  // namespace kratos
+
+#endif  // KRATOS_DEBUG_SYMBOLS_HH
@@ -1,4 +1,5 @@
 #include "eval.hh"
+#include <algorithm>
 #include <cmath>
 
 namespace kratos {
@@ -7,6 +8,7 @@ auto constexpr UINT64_WIDTH_ = 64;
 
 uint64_t invert(uint64_t value, uint32_t width) {
     auto v = ~value;
+    if (width >= UINT64_WIDTH_) return v;
     v ^= UINT64_MASK << width;
     return v;
 }
@@ -25,7 +27,7 @@ uint64_t eval_unary_op(uint64_t value, ExprOp op, uint32_t width) {
         case ExprOp::UMinus:
             return two_complement(value, width);
         case ExprOp::UAnd:
-            return static_cast<uint32_t>(__builtin_popcount(value)) == width;
+            return static_cast<uint32_t>(__builtin_popcountll(value)) == width;
         case ExprOp::UInvert:
             return invert(value, width);
         case ExprOp::UNot:
@@ -35,7 +37,7 @@ uint64_t eval_unary_op(uint64_t value, ExprOp op, uint32_t width) {
         case ExprOp::UPlus:
             return value;
         case ExprOp::UXor: {
-            return __builtin_popcount(value) % 2;
+            return __builtin_popcountll(value) % 2;
         }
         default: throw std::runtime_error("Not implemented");
     }
@@ -74,9 +76,22 @@ uint64_t eval_bin_op(uint64_t left_value, uint64_t right_value, ExprOp op, uint3
         case ExprOp::Xor:
             result = left_value ^ right_value;
             break;
+        case ExprOp::Mod:
+            result = left_abs_value % right_abs_value;
+            if (left_negative) result = two_complement(result, width);
+            break;
+        case ExprOp::LAnd:
+            result = left_value && right_value;
+            break;
+        case ExprOp::LOr:
+            result = left_value || right_value;
+            break;
         case ExprOp::Eq:
             result = left_value == right_value;
             break;
+        case ExprOp::Neq:
+            result = left_value != right_value;
+            break;
         case ExprOp::Power:
             result = static_cast<uint64_t>(std::pow(left_value, right_value));
             break;
@@ -109,7 +124,10 @@ uint64_t eval_bin_op(uint64_t left_value, uint64_t right_value, ExprOp op, uint3
             if (left_negative) result |= UINT64_MASK << (width - 1 - right_value);
             break;
         case ExprOp::LogicalShiftRight:
-            result = left_value >> right_value;
+            result = right_value >= UINT64_WIDTH_ ? 0 : left_value >> right_value;
+            break;
+        case ExprOp::ShiftLeft:
+            result = right_value >= UINT64_WIDTH_ ? 0 : left_value << right_value;
             break;
         default: {
             throw std::runtime_error("Not implemented");
@@ -126,4 +144,377 @@ uint64_t eval_ternary_op(bool predicate, uint64_t left_value, uint64_t right_val
     return result;
 }
 
+void bv_truncate(uint64_t *value, uint32_t width) {
+    auto n = num_words(width);
+    if (width % UINT64_WIDTH_) value[n - 1] &= UINT64_MASK >> (UINT64_WIDTH_ - width % UINT64_WIDTH_);
+}
+
+bool bv_is_zero(const uint64_t *value, uint32_t num_words) {
+    uint64_t result = 0;
+    for (uint32_t i = 0; i < num_words; i++) result |= value[i];
+    return result == 0;
+}
+
+uint32_t bv_popcount(const uint64_t *value, uint32_t num_words) {
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < num_words; i++) result += __builtin_popcountll(value[i]);
+    return result;
+}
+
+uint64_t bv_extract(const uint64_t *value, uint32_t low, uint32_t width) {
+    auto word = low / UINT64_WIDTH_;
+    auto offset = low % UINT64_WIDTH_;
+    uint64_t result = value[word] >> offset;
+    if (offset + width > UINT64_WIDTH_) result |= value[word + 1] << (UINT64_WIDTH_ - offset);
+    return width >= UINT64_WIDTH_ ? result : result & ~(UINT64_MASK << width);
+}
+
+void bv_deposit(uint64_t *value, uint32_t low, uint32_t width, uint64_t bits) {
+    auto word = low / UINT64_WIDTH_;
+    auto offset = low % UINT64_WIDTH_;
+    auto mask = width >= UINT64_WIDTH_ ? UINT64_MASK : ~(UINT64_MASK << width);
+    bits &= mask;
+    value[word] = (value[word] & ~(mask << offset)) | (bits << offset);
+    if (offset + width > UINT64_WIDTH_) {
+        auto high_mask = mask >> (UINT64_WIDTH_ - offset);
+        value[word + 1] = (value[word + 1] & ~high_mask) | (bits >> (UINT64_WIDTH_ - offset));
+    }
+}
+
+void bv_copy(uint64_t *dst, uint32_t dst_low, const uint64_t *src, uint32_t src_low,
+             uint32_t width) {
+    for (uint32_t i = 0; i < width; i += UINT64_WIDTH_) {
+        auto w = std::min<uint32_t>(UINT64_WIDTH_, width - i);
+        bv_deposit(dst, dst_low + i, w, bv_extract(src, src_low + i, w));
+    }
+}
+
+void bv_and(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t num_words) {
+    for (uint32_t i = 0; i < num_words; i++) result[i] = left[i] & right[i];
+}
+
+void bv_or(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t num_words) {
+    for (uint32_t i = 0; i < num_words; i++) result[i] = left[i] | right[i];
+}
+
+void bv_xor(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t num_words) {
+    for (uint32_t i = 0; i < num_words; i++) result[i] = left[i] ^ right[i];
+}
+
+void bv_invert(uint64_t *result, const uint64_t *value, uint32_t width) {
+    auto n = num_words(width);
+    for (uint32_t i = 0; i < n; i++) result[i] = ~value[i];
+    bv_truncate(result, width);
+}
+
+uint64_t bv_add(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t num_words) {
+    uint64_t carry = 0;
+    for (uint32_t i = 0; i < num_words; i++) {
+        auto sum = left[i] + right[i];
+        auto c = static_cast<uint64_t>(sum < left[i]);
+        result[i] = sum + carry;
+        carry = c | static_cast<uint64_t>(result[i] < sum);
+    }
+    return carry;
+}
+
+uint64_t bv_sub(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t num_words) {
+    uint64_t borrow = 0;
+    for (uint32_t i = 0; i < num_words; i++) {
+        auto diff = left[i] - right[i];
+        auto b = static_cast<uint64_t>(left[i] < right[i]);
+        result[i] = diff - borrow;
+        borrow = b | static_cast<uint64_t>(diff < borrow);
+    }
+    return borrow;
+}
+
+void bv_negate(uint64_t *result, const uint64_t *value, uint32_t width) {
+    auto n = num_words(width);
+    uint64_t carry = 1;
+    for (uint32_t i = 0; i < n; i++) {
+        result[i] = ~value[i] + carry;
+        carry = carry && result[i] == 0;
+    }
+    bv_truncate(result, width);
+}
+
+// 64 x 64 -> 128 bits multiplication without relying on compiler extensions
+static void mul_64(uint64_t a, uint64_t b, uint64_t &low, uint64_t &high) {
+    auto constexpr half_mask = 0xFFFFFFFFull;
+    uint64_t a_lo = a & half_mask, a_hi = a >> 32u;
+    uint64_t b_lo = b & half_mask, b_hi = b >> 32u;
+    uint64_t p0 = a_lo * b_lo;
+    uint64_t p1 = a_lo * b_hi;
+    uint64_t p2 = a_hi * b_lo;
+    uint64_t p3 = a_hi * b_hi;
+    uint64_t middle = (p0 >> 32u) + (p1 & half_mask) + (p2 & half_mask);
+    low = (middle << 32u) | (p0 & half_mask);
+    high = p3 + (p1 >> 32u) + (p2 >> 32u) + (middle >> 32u);
+}
+
+void bv_mul(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t width) {
+    auto n = num_words(width);
+    for (uint32_t i = 0; i < n; i++) result[i] = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (!left[i]) continue;
+        uint64_t carry = 0;
+        // only the lower n words are kept
+        for (uint32_t j = 0; i + j < n; j++) {
+            uint64_t low, high;
+            mul_64(left[i], right[j], low, high);
+            low += carry;
+            high += low < carry;
+            result[i + j] += low;
+            high += result[i + j] < low;
+            carry = high;
+        }
+    }
+    bv_truncate(result, width);
+}
+
+void bv_divmod(uint64_t *quotient, uint64_t *remainder, const uint64_t *left,
+               const uint64_t *right, uint32_t width) {
+    auto n = num_words(width);
+    if (bv_is_zero(right, n)) {
+        for (uint32_t i = 0; i < n; i++) {
+            quotient[i] = UINT64_MASK;
+            remainder[i] = left[i];
+        }
+        bv_truncate(quotient, width);
+        return;
+    }
+    // shift-subtract long division. the remainder needs one extra bit
+    std::vector<uint64_t> rem(n + 1, 0);
+    std::vector<uint64_t> divisor(right, right + n);
+    divisor.emplace_back(0);
+    for (uint32_t i = 0; i < n; i++) quotient[i] = 0;
+    for (uint32_t bit = width; bit-- > 0;) {
+        for (uint32_t i = n; i > 0; i--) rem[i] = (rem[i] << 1u) | (rem[i - 1] >> 63u);
+        rem[0] = (rem[0] << 1u) | ((left[bit / UINT64_WIDTH_] >> (bit % UINT64_WIDTH_)) & 1u);
+        if (bv_compare(rem.data(), divisor.data(), n + 1) >= 0) {
+            bv_sub(rem.data(), rem.data(), divisor.data(), n + 1);
+            quotient[bit / UINT64_WIDTH_] |= 1ull << (bit % UINT64_WIDTH_);
+        }
+    }
+    for (uint32_t i = 0; i < n; i++) remainder[i] = rem[i];
+}
+
+void bv_shl(uint64_t *result, const uint64_t *value, uint64_t amount, uint32_t width) {
+    auto n = num_words(width);
+    auto word_shift = amount / UINT64_WIDTH_;
+    auto bit_shift = amount % UINT64_WIDTH_;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t v = 0;
+        if (i >= word_shift) {
+            v = value[i - word_shift] << bit_shift;
+            if (bit_shift && i > word_shift)
+                v |= value[i - word_shift - 1] >> (UINT64_WIDTH_ - bit_shift);
+        }
+        result[i] = v;
+    }
+    bv_truncate(result, width);
+}
+
+void bv_lshr(uint64_t *result, const uint64_t *value, uint64_t amount, uint32_t width) {
+    auto n = num_words(width);
+    auto word_shift = amount / UINT64_WIDTH_;
+    auto bit_shift = amount % UINT64_WIDTH_;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t v = 0;
+        if (i + word_shift < n) {
+            v = value[i + word_shift] >> bit_shift;
+            if (bit_shift && i + word_shift + 1 < n)
+                v |= value[i + word_shift + 1] << (UINT64_WIDTH_ - bit_shift);
+        }
+        result[i] = v;
+    }
+}
+
+void bv_ashr(uint64_t *result, const uint64_t *value, uint64_t amount, uint32_t width) {
+    bool negative = (value[(width - 1) / UINT64_WIDTH_] >> ((width - 1) % UINT64_WIDTH_)) & 1u;
+    if (!negative) {
+        bv_lshr(result, value, amount, width);
+        return;
+    }
+    // shift in ones: ~(~value >> amount)
+    auto n = num_words(width);
+    std::vector<uint64_t> inverted(n);
+    bv_invert(inverted.data(), value, width);
+    bv_lshr(result, inverted.data(), amount, width);
+    bv_invert(result, result, width);
+}
+
+int bv_compare(const uint64_t *left, const uint64_t *right, uint32_t num_words) {
+    for (uint32_t i = num_words; i > 0; i--) {
+        if (left[i - 1] != right[i - 1]) return left[i - 1] > right[i - 1] ? 1 : -1;
+    }
+    return 0;
+}
+
+int bv_compare_signed(const uint64_t *left, const uint64_t *right, uint32_t width) {
+    auto top = (width - 1) / UINT64_WIDTH_;
+    auto sign_bit = (width - 1) % UINT64_WIDTH_;
+    bool left_negative = (left[top] >> sign_bit) & 1u;
+    bool right_negative = (right[top] >> sign_bit) & 1u;
+    if (left_negative != right_negative) return left_negative ? -1 : 1;
+    // same sign, two's complement preserves the order
+    return bv_compare(left, right, num_words(width));
+}
+
+void bv_extend(uint64_t *result, const uint64_t *value, uint32_t width, uint32_t new_width,
+               bool signed_) {
+    auto n = num_words(new_width);
+    bool negative =
+        signed_ && (value[(width - 1) / UINT64_WIDTH_] >> ((width - 1) % UINT64_WIDTH_)) & 1u;
+    auto fill = negative ? UINT64_MASK : 0;
+    for (uint32_t i = 0; i < n; i++) result[i] = fill;
+    bv_copy(result, 0, value, 0, std::min(width, new_width));
+    bv_truncate(result, new_width);
+}
+
+std::vector<uint64_t> eval_unary_op(const std::vector<uint64_t> &value, ExprOp op,
+                                    uint32_t width) {
+    auto n = num_words(width);
+    auto v = value;
+    v.resize(n, 0);
+    bv_truncate(v.data(), width);
+    std::vector<uint64_t> result(n, 0);
+    switch (op) {
+        case ExprOp::UMinus:
+            bv_negate(result.data(), v.data(), width);
+            return result;
+        case ExprOp::UInvert:
+            bv_invert(result.data(), v.data(), width);
+            return result;
+        case ExprOp::UPlus:
+            return v;
+        case ExprOp::UNot:
+            return {bv_is_zero(v.data(), n)};
+        case ExprOp::UOr:
+            return {!bv_is_zero(v.data(), n)};
+        case ExprOp::UAnd:
+            return {bv_popcount(v.data(), n) == width};
+        case ExprOp::UXor:
+            return {bv_popcount(v.data(), n) % 2u};
+        default:
+            throw std::runtime_error("Not implemented");
+    }
+}
+
+std::vector<uint64_t> eval_bin_op(const std::vector<uint64_t> &left_value,
+                                  const std::vector<uint64_t> &right_value, ExprOp op,
+                                  uint32_t width, bool signed_) {
+    auto n = num_words(width);
+    auto left = left_value;
+    auto right = right_value;
+    left.resize(n, 0);
+    right.resize(n, 0);
+    bv_truncate(left.data(), width);
+    bv_truncate(right.data(), width);
+    auto const sign_word = (width - 1) / UINT64_WIDTH_;
+    auto const sign_bit = (width - 1) % UINT64_WIDTH_;
+    bool left_negative = signed_ && (left[sign_word] >> sign_bit) & 1u;
+    bool right_negative = signed_ && (right[sign_word] >> sign_bit) & 1u;
+    // shift amount may come from a wider operand and saturates at the width
+    uint64_t amount = 0;
+    if (!right_value.empty()) {
+        auto size = static_cast<uint32_t>(right_value.size());
+        amount = bv_is_zero(right_value.data() + 1, size - 1) ? right_value[0] : width;
+    }
+    std::vector<uint64_t> result(n, 0);
+    auto abs_value = [width](std::vector<uint64_t> &value, bool negative) {
+        if (!negative) return value;
+        std::vector<uint64_t> v(value.size());
+        bv_negate(v.data(), value.data(), width);
+        return v;
+    };
+    switch (op) {
+        case ExprOp::Add:
+            bv_add(result.data(), left.data(), right.data(), n);
+            break;
+        case ExprOp::Minus:
+            bv_sub(result.data(), left.data(), right.data(), n);
+            break;
+        case ExprOp::Multiply:
+            bv_mul(result.data(), left.data(), right.data(), width);
+            break;
+        case ExprOp::Divide:
+        case ExprOp::Mod: {
+            auto left_abs = abs_value(left, left_negative);
+            auto right_abs = abs_value(right, right_negative);
+            std::vector<uint64_t> remainder(n);
+            bv_divmod(result.data(), remainder.data(), left_abs.data(), right_abs.data(), width);
+            if (op == ExprOp::Mod) {
+                result = remainder;
+                if (left_negative) bv_negate(result.data(), remainder.data(), width);
+            } else if (left_negative ^ right_negative) {
+                bv_negate(result.data(), result.data(), width);
+            }
+            break;
+        }
+        case ExprOp::Power: {
+            // square and multiply, truncated to the width
+            std::vector<uint64_t> base = left;
+            std::vector<uint64_t> temp(n);
+            result[0] = 1;
+            for (uint32_t bit = 0; bit < n * UINT64_WIDTH_; bit++) {
+                if ((right[bit / UINT64_WIDTH_] >> (bit % UINT64_WIDTH_)) & 1u) {
+                    bv_mul(temp.data(), result.data(), base.data(), width);
+                    result.swap(temp);
+                }
+                bv_mul(temp.data(), base.data(), base.data(), width);
+                base.swap(temp);
+            }
+            break;
+        }
+        case ExprOp::And:
+            bv_and(result.data(), left.data(), right.data(), n);
+            break;
+        case ExprOp::Or:
+            bv_or(result.data(), left.data(), right.data(), n);
+            break;
+        case ExprOp::Xor:
+            bv_xor(result.data(), left.data(), right.data(), n);
+            break;
+        case ExprOp::LAnd:
+            return {!bv_is_zero(left.data(), n) && !bv_is_zero(right.data(), n)};
+        case ExprOp::LOr:
+            return {!bv_is_zero(left.data(), n) || !bv_is_zero(right.data(), n)};
+        case ExprOp::Eq:
+            return {bv_compare(left.data(), right.data(), n) == 0};
+        case ExprOp::Neq:
+            return {bv_compare(left.data(), right.data(), n) != 0};
+        case ExprOp::GreaterEqThan:
+        case ExprOp::LessEqThan:
+        case ExprOp::LessThan:
+        case ExprOp::GreaterThan: {
+            auto c = signed_ ? bv_compare_signed(left.data(), right.data(), width)
+                             : bv_compare(left.data(), right.data(), n);
+            bool r = op == ExprOp::GreaterEqThan ? c >= 0
+                     : op == ExprOp::LessEqThan  ? c <= 0
+                     : op == ExprOp::LessThan    ? c < 0
+                                                 : c > 0;
+            return {r};
+        }
+        case ExprOp::ShiftLeft:
+            if (amount < width) bv_shl(result.data(), left.data(), amount, width);
+            break;
+        case ExprOp::LogicalShiftRight:
+            if (amount < width) bv_lshr(result.data(), left.data(), amount, width);
+            break;
+        case ExprOp::SignedShiftRight:
+            if (left_negative)
+                bv_ashr(result.data(), left.data(), std::min<uint64_t>(amount, width - 1), width);
+            else if (amount < width)
+                bv_lshr(result.data(), left.data(), amount, width);
+            break;
+        default: {
+            throw std::runtime_error("Not implemented");
+        }
+    }
+    bv_truncate(result.data(), width);
+    return result;
+}
+
 }
\ No newline at end of file
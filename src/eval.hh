@@ -1,5 +1,6 @@
 #ifndef KRATOS_EVAL_HH
 #define KRATOS_EVAL_HH
+#include <vector>
 #include "expr.hh"
 
 namespace kratos {
@@ -16,6 +17,53 @@ uint64_t eval_bin_op(uint64_t left_value, uint64_t right_value, ExprOp op, uint3
 
 uint64_t eval_ternary_op(bool predicate, uint64_t left_value, uint64_t right_value, uint32_t width);
 
+// multi-word bit vectors for values wider than 64 bits. words are stored in little endian order,
+// i.e. word 0 holds bits [0, 64). kernels take raw word pointers.
+// the element-wise kernels, i.e. and, or, xor, invert, add, sub and negate, allow the result to
+// alias the operands. the others, e.g. shifts, mul, divmod, extend and copy, do not
+inline uint32_t num_words(uint32_t width) { return (width + 63) / 64; }
+
+void bv_truncate(uint64_t *value, uint32_t width);
+bool bv_is_zero(const uint64_t *value, uint32_t num_words);
+uint32_t bv_popcount(const uint64_t *value, uint32_t num_words);
+// extract or deposit at most 64 bits at an arbitrary bit offset
+uint64_t bv_extract(const uint64_t *value, uint32_t low, uint32_t width);
+void bv_deposit(uint64_t *value, uint32_t low, uint32_t width, uint64_t bits);
+// copy width bits from src[src_low] to dst[dst_low]
+void bv_copy(uint64_t *dst, uint32_t dst_low, const uint64_t *src, uint32_t src_low,
+             uint32_t width);
+
+void bv_and(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t num_words);
+void bv_or(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t num_words);
+void bv_xor(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t num_words);
+void bv_invert(uint64_t *result, const uint64_t *value, uint32_t width);
+// return the carry/borrow out
+uint64_t bv_add(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t num_words);
+uint64_t bv_sub(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t num_words);
+void bv_negate(uint64_t *result, const uint64_t *value, uint32_t width);
+void bv_mul(uint64_t *result, const uint64_t *left, const uint64_t *right, uint32_t width);
+// unsigned division. divide by zero yields all ones and the remainder is the dividend
+void bv_divmod(uint64_t *quotient, uint64_t *remainder, const uint64_t *left,
+               const uint64_t *right, uint32_t width);
+
+void bv_shl(uint64_t *result, const uint64_t *value, uint64_t amount, uint32_t width);
+void bv_lshr(uint64_t *result, const uint64_t *value, uint64_t amount, uint32_t width);
+void bv_ashr(uint64_t *result, const uint64_t *value, uint64_t amount, uint32_t width);
+
+// return -1, 0, or 1
+int bv_compare(const uint64_t *left, const uint64_t *right, uint32_t num_words);
+int bv_compare_signed(const uint64_t *left, const uint64_t *right, uint32_t width);
+
+void bv_extend(uint64_t *result, const uint64_t *value, uint32_t width, uint32_t new_width,
+               bool signed_);
+
+// same semantics as the single word version. operands are resized to the width and relational
+// or reduction operators return a single word
+std::vector<uint64_t> eval_unary_op(const std::vector<uint64_t> &value, ExprOp op, uint32_t width);
+std::vector<uint64_t> eval_bin_op(const std::vector<uint64_t> &left_value,
+                                  const std::vector<uint64_t> &right_value, ExprOp op,
+                                  uint32_t width, bool signed_);
+
 }  // namespace kratos
 
 #endif  // KRATOS_EVAL_HH
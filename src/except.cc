@@ -105,6 +105,9 @@ InternalException::InternalException(const std::string& message) noexcept
 
 UserException::UserException(const std::string& message) noexcept : std::runtime_error(message) {}
 
+UnsupportedSimulationException::UnsupportedSimulationException(const std::string& message) noexcept
+    : UserException(message) {}
+
 InvalidConversionException::InvalidConversionException(const std::string& message) noexcept
     : std::runtime_error(message) {}
 
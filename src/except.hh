@@ -40,6 +40,13 @@ public:
     explicit UserException(const std::string &message) noexcept;
 };
 
+// constructs the compiled and batch simulators can't lower, which the interpreter may still
+// support
+class UnsupportedSimulationException : public UserException {
+public:
+    explicit UnsupportedSimulationException(const std::string &message) noexcept;
+};
+
 class InvalidConversionException: public std::runtime_error {
 public:
     explicit InvalidConversionException(const std::string &message) noexcept;
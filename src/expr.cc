@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <mutex>
 #include <queue>
 #include <stdexcept>
 #include <utility>
@@ -869,14 +870,19 @@ Const::ConstantLegal Const::is_legal(int64_t value, uint32_t width, bool is_sign
     return Const::ConstantLegal::Legal;
 }
 
+// consts are shared by every design in the process, which can be elaborated concurrently
+static std::mutex const_lock;
+
 Const::Const(int64_t value, uint32_t width, bool is_signed)
     : Const(nullptr, value, width, is_signed) {
+    std::lock_guard guard(const_lock);
     if (!const_generator_) const_generator_ = std::make_shared<Generator>(nullptr, "");
     generator_ = const_generator_.get();
 }
 
 Const &Const::constant(int64_t value, uint32_t width, bool is_signed) {
     auto p = std::make_shared<Const>(value, width, is_signed);
+    std::lock_guard guard(const_lock);
     consts_.emplace(p);
     return *p;
 }
@@ -1324,6 +1330,9 @@ void change_var_expr(const std::shared_ptr<Expr> &expr, Var *target, Var *new_va
 void change_cast_parent(const std::shared_ptr<VarCasted> &var, Var *target, Var *new_var);
 
 void change_var_parent(Var *&var, Var *target, Var *new_var) {
+    // expressions are rewritten in place
+    auto *generator = var->generator();
+    if (generator) generator->mark_dirty();
     if (var->type() == VarType::Slice) {
         set_slice_var_parent(var, target, new_var, true);
     } else if (var->type() == VarType::Expression) {
@@ -1344,6 +1353,7 @@ void change_cast_parent(const std::shared_ptr<VarCasted> &var, Var *target, Var
 }
 
 void stmt_set_right(AssignStmt *stmt, Var *target, Var *new_var) {
+    mark_generator_dirty(stmt);
     auto &right = stmt->right();
     if (right->type() == VarType::Base || right->type() == VarType::PortIO ||
         right->type() == VarType::ConstValue) {
@@ -1363,6 +1373,7 @@ void stmt_set_right(AssignStmt *stmt, Var *target, Var *new_var) {
 }
 
 void stmt_set_left(AssignStmt *stmt, Var *target, Var *new_var) {
+    mark_generator_dirty(stmt);
     auto &left = stmt->left();
     if (left->type() == VarType::Base || left->type() == VarType::PortIO ||
         left->type() == VarType::ConstValue) {
@@ -10,9 +10,13 @@
 
 #include "context.hh"
 #include "ir.hh"
+#include "small_set.hh"
 
 namespace kratos {
 
+// most variables are only connected to one or two statements
+using AssignStmtSet = SmallPtrSet<AssignStmt, 2>;
+
 enum class ExprOp : uint64_t {
     // unary
     UInvert,
@@ -142,9 +146,9 @@ public:
     IRNode *parent() override;
 
     VarType type() const { return type_; }
-    virtual const std::unordered_set<std::shared_ptr<AssignStmt>> &sinks() const { return sinks_; };
+    virtual const AssignStmtSet &sinks() const { return sinks_; };
     virtual void remove_sink(const std::shared_ptr<AssignStmt> &stmt) { sinks_.erase(stmt); }
-    virtual const std::unordered_set<std::shared_ptr<AssignStmt>> &sources() const {
+    virtual const AssignStmtSet &sources() const {
         return sources_;
     };
     virtual void clear_sinks(bool remove_parent);
@@ -234,8 +238,8 @@ protected:
     std::unordered_map<uint32_t, Var *> size_param_;
     bool is_signed_;
 
-    std::unordered_set<std::shared_ptr<AssignStmt>> sinks_;
-    std::unordered_set<std::shared_ptr<AssignStmt>> sources_;
+    AssignStmtSet sinks_;
+    AssignStmtSet sources_;
 
     VarType type_ = VarType::Base;
 
@@ -296,13 +300,13 @@ public:
     // ideally this should be in another sub-class of Var and modport version as well
     // however, getting this to work with pybind with virtual inheritance is a pain
     // so just copy the code here
-    const std::unordered_set<std::shared_ptr<AssignStmt>> &sinks() const override {
+    const AssignStmtSet &sinks() const override {
         return parent_var_->sinks();
     };
     void remove_sink(const std::shared_ptr<AssignStmt> &stmt) override {
         parent_var_->remove_sink(stmt);
     }
-    const std::unordered_set<std::shared_ptr<AssignStmt>> &sources() const override {
+    const AssignStmtSet &sources() const override {
         return parent_var_->sources();
     };
     void clear_sinks(bool remove_parent) override { parent_var_->clear_sources(remove_parent); }
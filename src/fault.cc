@@ -15,10 +15,19 @@ using fmt::format;
 
 namespace kratos {
 
+// number of simulation states evaluated together when computing coverage
+constexpr uint32_t FAULT_BATCH_LANES = 64;
+
 void SimulationRun::add_simulation_state(const std::map<std::string, int64_t> &values) {
     // need to parse the inputs and outputs
-    states_.emplace_back(std::make_unique<Simulator>(top_));
-    auto state = get_state(states_.size() - 1);
+    if (!simulator_) {
+        simulator_ = std::make_unique<Simulator>(top_);
+        initial_state_ = simulator_->save_state();
+    } else {
+        simulator_->load_state(initial_state_);
+    }
+    auto *state = simulator_.get();
+    auto &inputs = inputs_.emplace_back();
     for (auto const &[name, value] : values) {
         // we need to use dot notation to select from the hierarchy
         // notice these names do not contain the "top" name, e.g. TOP for verilator
@@ -27,7 +36,10 @@ void SimulationRun::add_simulation_state(const std::map<std::string, int64_t> &v
             throw UserException(::format("Unable to parse {0}", name));
         }
         state->set(var, value, false);
+        inputs.emplace_back(var, value);
     }
+    states_.emplace_back(state->save_state());
+    loaded_state_ = states_.size() - 1;
 }
 
 void SimulationRun::mark_wrong_value(const std::string &name) {
@@ -91,7 +103,11 @@ Var *SimulationRun::select(const std::string &name) {
 
 Simulator *SimulationRun::get_state(uint32_t index) {
     if (index < states_.size()) {
-        return states_[index].get();
+        if (loaded_state_ != index) {
+            simulator_->load_state(states_[index]);
+            loaded_state_ = index;
+        }
+        return simulator_.get();
     }
     return nullptr;
 }
@@ -137,12 +153,81 @@ void compute_hit_stmts(Simulator *state, std::unordered_set<Stmt *> &result, Stm
     }
 }
 
+// same as above, but for every lane at once. lanes holds the lanes that reach the stmt
+void compute_hit_stmts(BatchSimulator *state, std::unordered_set<Stmt *> &result, Stmt *stmt,
+                       const std::vector<bool> &lanes) {
+    if (stmt->type() == StatementType::If) {
+        auto if_ = cast<IfStmt>(stmt);
+        auto cond = if_->predicate();
+        auto values = state->get(cond.get());
+        std::vector<bool> then_lanes(lanes.size(), false), else_lanes(lanes.size(), false);
+        bool has_then = false, has_else = false;
+        for (uint64_t i = 0; i < lanes.size(); i++) {
+            if (!lanes[i]) continue;
+            if (values[i] && *values[i]) {
+                then_lanes[i] = true;
+                has_then = true;
+            } else {
+                else_lanes[i] = true;
+                has_else = true;
+            }
+        }
+        if (has_then) compute_hit_stmts(state, result, if_->then_body().get(), then_lanes);
+        if (has_else) compute_hit_stmts(state, result, if_->else_body().get(), else_lanes);
+    } else if (stmt->type() == StatementType::Block) {
+        auto block = cast<StmtBlock>(stmt);
+        if (block->block_type() == StatementBlockType::Scope) result.emplace(stmt);
+        for (auto const &s : *block) {
+            compute_hit_stmts(state, result, s.get(), lanes);
+        }
+    } else if (stmt->type() == StatementType::FunctionalCall) {
+        auto *func = cast<FunctionCallStmt>(stmt);
+        if (!func->var()->func()->is_dpi() && !func->var()->func()->is_builtin()) {
+            compute_hit_stmts(state, result, func->var()->func(), lanes);
+        }
+    }
+}
+
+std::optional<std::unordered_set<Stmt *>> FaultAnalyzer::compute_coverage_batch(
+    SimulationRun *run) {
+    std::unordered_set<Stmt *> result;
+    auto num_states = run->num_states();
+    auto num_lanes = static_cast<uint32_t>(std::min<uint64_t>(num_states, FAULT_BATCH_LANES));
+    try {
+        BatchSimulator state(generator_, num_lanes);
+        GeneratorGraph g(generator_);
+        auto generators = g.get_sorted_generators();
+        for (uint64_t start = 0; start < num_states; start += num_lanes) {
+            state.reset();
+            std::vector<bool> lanes(num_lanes, false);
+            for (uint32_t lane = 0; lane < num_lanes && start + lane < num_states; lane++) {
+                lanes[lane] = true;
+                for (auto const &[var, value] : run->state_inputs(start + lane)) {
+                    state.set(var, lane, static_cast<uint64_t>(value));
+                }
+            }
+            for (auto const &gen : generators) {
+                auto stmts = gen->get_all_stmts();
+                for (auto const &stmt : stmts) {
+                    compute_hit_stmts(&state, result, stmt.get(), lanes);
+                }
+            }
+        }
+    } catch (const UnsupportedSimulationException &) {
+        // constructs the compiled program doesn't support have to go through the interpreter
+        return std::nullopt;
+    }
+    return result;
+}
+
 std::unordered_set<Stmt *> FaultAnalyzer::compute_coverage(uint32_t index) {
     auto run = runs_[index].get();
     std::unordered_set<Stmt *> result;
     if (run->has_coverage()) {
         auto const &cov = run->coverage();
         for (auto const &stmt : cov) result.emplace(stmt);
+    } else if (auto batch = compute_coverage_batch(run)) {
+        result = std::move(*batch);
     } else {
         auto num_states = run->num_states();
         for (uint64_t i = 0; i < num_states; i++) {
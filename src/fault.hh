@@ -20,16 +20,24 @@ public:
     void add_simulation_coverage(const std::unordered_map<Stmt *, uint32_t> &coverage);
     [[nodiscard]] bool has_coverage() const { return !coverage_.empty(); }
     [[nodiscard]] const std::unordered_set<Stmt *> &coverage() const { return coverage_; }
-    // use simulator's logic to handle different states
-    // FIXME: refactor out the state and the simulator
+    // use simulator's logic to handle different states. states are stored as value snapshots
+    // and share one simulator, so the returned pointer reflects the last loaded state only
     Simulator *get_state(uint32_t index);
     [[nodiscard]] uint64_t num_states() const { return states_.size(); }
+    // values set for each state, in the order they were set
+    [[nodiscard]] const std::vector<std::pair<Var *, int64_t>> &state_inputs(uint32_t index) const {
+        return inputs_[index];
+    }
 
 private:
     std::pair<Generator *, uint64_t> select_gen(const std::vector<std::string> &tokens);
     Var *select(const std::string &name);
 
-    std::vector<std::unique_ptr<Simulator>> states_;
+    std::unique_ptr<Simulator> simulator_;
+    SimValueStore::State initial_state_;
+    std::vector<SimValueStore::State> states_;
+    std::optional<uint32_t> loaded_state_;
+    std::vector<std::vector<std::pair<Var *, int64_t>>> inputs_;
     Generator *top_;
     std::map<uint32_t, std::unordered_set<Var *>> wrong_value_;
 
@@ -51,6 +59,8 @@ private:
     Generator *generator_;
     std::vector<std::shared_ptr<SimulationRun>> runs_;
     std::unordered_map<uint32_t, std::unordered_set<Stmt *>> coverage_maps_;
+
+    std::optional<std::unordered_set<Stmt *>> compute_coverage_batch(SimulationRun *run);
 };
 
 }  // namespace kratos
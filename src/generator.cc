@@ -1,8 +1,6 @@
 #include "generator.hh"
 
-#include <fstream>
 #include <iostream>
-#include <streambuf>
 #include <unordered_set>
 
 #include "except.hh"
@@ -32,20 +30,11 @@ Generator Generator::from_verilog(Context *context, const std::string &src_file,
     mod.lib_files_.reserve(1 + lib_files.size());
     mod.lib_files_.emplace_back(src_file);
 
-    std::ifstream f(src_file);
-    ::string src;
-    // pre-allocate the size
-    f.seekg(0, std::ios::end);
-    src.reserve(f.tellg());
-    f.seekg(0, std::ios::beg);
-    src.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
-
     mod.lib_files_.insert(mod.lib_files_.end(), lib_files.begin(), lib_files.end());
-    // const auto &ports = ;
-    const auto ports = get_port_from_verilog(&mod, src, top_name);
+    const auto ports = get_port_from_verilog_file(&mod, src_file, top_name);
     for (auto const &[port_name, port] : ports) {
-        mod.ports_.emplace(port_name);
-        mod.vars_.emplace(port_name, port);
+        mod.add_var_entry(port_name, port);
+        mod.add_port_entry(port_name);
     }
     // verify the existence of each lib files
     for (auto const &filename : mod.lib_files_) {
@@ -54,10 +43,10 @@ Generator Generator::from_verilog(Context *context, const std::string &src_file,
 
     // assign port types
     for (auto const &[port_name, port_type] : port_types) {
-        if (mod.ports_.find(port_name) == mod.ports_.end())
+        if (!mod.has_port(port_name))
             throw UserException(::format("unable to find port {0}", port_name));
-        std::shared_ptr<Var> &var_p = mod.vars_.at(port_name);
-        std::shared_ptr<Port> port_p = std::static_pointer_cast<Port>(var_p);
+        auto const *var_p = mod.vars_.find(mod.symbols().find(port_name));
+        std::shared_ptr<Port> port_p = std::static_pointer_cast<Port>(*var_p);
         port_p->set_port_type(port_type);
     }
 
@@ -91,21 +80,21 @@ Var &Generator::var(const std::string &var_name, uint32_t width, uint32_t size,
 
 Var &Generator::var(const std::string &var_name, uint32_t width, const std::vector<uint32_t> &size,
                     bool is_signed) {
-    if (vars_.find(var_name) != vars_.end()) {
-        auto v_p = get_var(var_name);
+    if (auto *v_p = find_var(var_name)) {
         if (v_p->width() != width || v_p->is_signed() != is_signed)
             throw VarException(::format("redefinition of {0} with different width/sign", var_name),
-                               {v_p.get()});
+                               {v_p});
         return *v_p;
     }
     auto p = std::make_shared<Var>(this, var_name, width, size, is_signed);
-    vars_.emplace(var_name, p);
+    add_var_entry(var_name, p);
+    mark_dirty();
     return *p;
 }
 
 std::shared_ptr<Var> Generator::get_var(const std::string &var_name) {
-    if (vars_.find(var_name) == vars_.end()) return nullptr;
-    return vars_.at(var_name);
+    auto *var = find_var(var_name);
+    return var ? var->shared_from_this() : nullptr;
 }
 
 Port &Generator::port(PortDirection direction, const std::string &port_name, uint32_t width,
@@ -126,12 +115,13 @@ Port &Generator::port(PortDirection direction, const std::string &port_name, uin
 
 Port &Generator::port(PortDirection direction, const std::string &port_name, uint32_t width,
                       const std::vector<uint32_t> &size, PortType type, bool is_signed) {
-    if (ports_.find(port_name) != ports_.end())
+    if (has_port(port_name))
         throw VarException(::format("{0} already exists in {1}", port_name, name),
-                           {vars_.at(port_name).get()});
+                           {find_var(port_name)});
     auto p = std::make_shared<Port>(this, direction, port_name, width, size, type, is_signed);
-    vars_.emplace(port_name, p);
-    ports_.emplace(port_name);
+    add_var_entry(port_name, p);
+    mark_dirty();
+    add_port_entry(port_name);
     return *p;
 }
 
@@ -153,13 +143,14 @@ Port &Generator::port(const PortPackedStruct &port, bool check_param) {
 
 Port &Generator::port(const PortPackedStruct &port, const std::string &port_name,
                       bool check_param) {
-    if (ports_.find(port_name) != ports_.end())
+    if (has_port(port_name))
         throw VarException(::format("{0} already exists in {1}", port_name, name),
-                           {vars_.at(port_name).get()});
+                           {find_var(port_name)});
     auto p = std::make_shared<PortPackedStruct>(this, port.port_direction(), port_name,
                                                 port.packed_struct(), port.size());
-    vars_.emplace(port_name, p);
-    ports_.emplace(port_name);
+    add_var_entry(port_name, p);
+    mark_dirty();
+    add_port_entry(port_name);
 
     port.copy_meta_data(p.get(), check_param);
 
@@ -171,14 +162,15 @@ Port &Generator::port(const EnumPort &port, bool check_param) {
 }
 
 Port &Generator::port(const EnumPort &port, const std::string &port_name, bool check_param) {
-    if (ports_.find(port_name) != ports_.end())
+    if (has_port(port_name))
         throw VarException(::format("{0} already exists in {1}", port_name, name),
-                           {vars_.at(port_name).get()});
+                           {find_var(port_name)});
     auto *enum_type = const_cast<Enum *>(port.enum_type());
     auto p = std::make_shared<EnumPort>(this, port.port_direction(), port_name,
                                         enum_type->shared_from_this());
-    vars_.emplace(port_name, p);
-    ports_.emplace(port_name);
+    add_var_entry(port_name, p);
+    mark_dirty();
+    add_port_entry(port_name);
 
     port.copy_meta_data(p.get(), check_param);
 
@@ -187,27 +179,129 @@ Port &Generator::port(const EnumPort &port, const std::string &port_name, bool c
 
 EnumPort &Generator::port(kratos::PortDirection direction, const std::string &port_name,
                           const std::shared_ptr<kratos::Enum> &def) {
-    if (ports_.find(port_name) != ports_.end())
+    if (has_port(port_name))
         throw VarException(::format("{0} already exists in {1}", port_name, name),
-                           {vars_.at(port_name).get()});
+                           {find_var(port_name)});
     // make sure the enum def is not local
     if (def->local())
         throw UserException(::format("Cannot use {0} as port type since it's local", def->name));
     auto p = std::make_shared<EnumPort>(this, direction, port_name, def);
-    vars_.emplace(port_name, p);
-    ports_.emplace(port_name);
+    add_var_entry(port_name, p);
+    mark_dirty();
+    add_port_entry(port_name);
     return *p;
 }
 
 std::shared_ptr<Port> Generator::get_port(const std::string &port_name) const {
-    if (ports_.find(port_name) == ports_.end()) return nullptr;
-    auto var_p = vars_.at(port_name);
-    return std::static_pointer_cast<Port>(var_p);
+    auto const *port = ports_.find(symbols().find(port_name));
+    return port ? (*port)->as<Port>() : nullptr;
+}
+
+bool Generator::has_port(const std::string &port_name) const {
+    return ports_.find(symbols().find(port_name)) != nullptr;
+}
+
+bool Generator::has_var(const std::string &var_name) const {
+    return find_var(var_name) != nullptr;
+}
+
+std::set<std::string> Generator::get_port_names() const {
+    std::set<std::string> result;
+    auto const &table = symbols();
+    ports_.for_each([&](Symbol symbol, Var *) { result.emplace(table.str(symbol)); });
+    return result;
+}
+
+std::map<std::string, std::shared_ptr<Var>> Generator::vars() const {
+    std::map<std::string, std::shared_ptr<Var>> result;
+    auto const &table = symbols();
+    vars_.for_each([&](Symbol symbol, const std::shared_ptr<Var> &var) {
+        result.emplace(table.str(symbol), var);
+    });
+    return result;
+}
+
+SymbolTable &Generator::symbols() const {
+    // generators created outside a context share a process-wide table
+    static SymbolTable no_context_symbols;
+    return context_ ? context_->symbols() : no_context_symbols;
+}
+
+Var *Generator::find_var(const std::string &var_name) const {
+    // unknown names are looked up as SymbolTable::none, which is never in the map
+    auto const *var = vars_.find(symbols().find(var_name));
+    return var ? var->get() : nullptr;
+}
+
+void Generator::add_var_entry(const std::string &var_name, const std::shared_ptr<Var> &var) {
+    vars_.emplace(symbols().intern(var_name), var);
+}
+
+void Generator::add_port_entry(const std::string &port_name) {
+    ports_.emplace(symbols().intern(port_name), find_var(port_name));
+}
+
+void Generator::remove_var_entry(const std::string &var_name) {
+    vars_.erase(symbols().find(var_name));
+}
+
+void Generator::remove_port_entry(const std::string &port_name) {
+    ports_.erase(symbols().find(port_name));
+}
+
+uint64_t Generator::ExprKeyHash::operator()(const ExprKey &key) const {
+    uint64_t result = static_cast<uint64_t>(key.op);
+    for (auto value : {reinterpret_cast<uint64_t>(key.left), reinterpret_cast<uint64_t>(key.right),
+                       static_cast<uint64_t>(key.left_width) << 32u | key.right_width,
+                       static_cast<uint64_t>(key.left_signed) << 1u | key.right_signed}) {
+        result ^= value + 0x9e3779b97f4a7c15 + (result << 6u) + (result >> 2u);
+    }
+    return result;
+}
+
+// ports can be used by both the parent and the child generator, and passes rewrite
+// expressions in place for one generator at a time, so expressions on ports are not shared
+bool is_generator_local(Var *var) {
+    while (var) {
+        switch (var->type()) {
+            case VarType::PortIO:
+                return false;
+            case VarType::Slice:
+                var = reinterpret_cast<VarSlice *>(var)->parent_var;
+                break;
+            case VarType::BaseCasted:
+                var = reinterpret_cast<VarCasted *>(var)->parent_var();
+                break;
+            default:
+                return true;
+        }
+    }
+    return true;
 }
 
 Expr &Generator::expr(ExprOp op, Var *left, Var *right) {
+    if (!share_exprs || debug || !is_generator_local(left) || !is_generator_local(right)) {
+        auto expr = std::make_shared<Expr>(op, left, right);
+        exprs_.emplace(expr);
+        return *expr;
+    }
+    ExprKey key{op,
+                left,
+                right,
+                left->width(),
+                right ? right->width() : 0,
+                left->is_signed(),
+                right ? right->is_signed() : false};
+    auto iter = shared_exprs_.find(key);
+    if (iter != shared_exprs_.end()) {
+        auto *expr = iter->second;
+        // passes may have changed the expression in place
+        if (expr->op == op && expr->left == left && expr->right == right) return *expr;
+    }
     auto expr = std::make_shared<Expr>(op, left, right);
     exprs_.emplace(expr);
+    // the operands may be replaced by resize casts, which are cached by the operands
+    if (expr->left == left && expr->right == right) shared_exprs_[key] = expr.get();
     return *expr;
 }
 
@@ -263,7 +357,8 @@ EnumVar &Generator::enum_var(const std::string &var_name, const std::shared_ptr<
     if (has_var(var_name))
         throw VarException(::format("{0} already exists", var_name), {get_var(var_name).get()});
     auto p = std::make_shared<EnumVar>(this, var_name, enum_def);
-    vars_.emplace(var_name, p);
+    add_var_entry(var_name, p);
+    mark_dirty();
     return *p;
 }
 
@@ -323,6 +418,7 @@ std::shared_ptr<FunctionStmtBlock> Generator::function(const std::string &func_n
     auto p = std::make_shared<FunctionStmtBlock>(this, func_name);
     func_index_.emplace(static_cast<uint32_t>(funcs_.size()), func_name);
     funcs_.emplace(func_name, p);
+    mark_dirty();
     return p;
 }
 
@@ -332,6 +428,7 @@ std::shared_ptr<DPIFunctionStmtBlock> Generator::dpi_function(const std::string
     auto p = std::make_shared<DPIFunctionStmtBlock>(this, func_name);
     func_index_.emplace(static_cast<uint32_t>(funcs_.size()), func_name);
     funcs_.emplace(func_name, p);
+    mark_dirty();
     return p;
 }
 
@@ -340,6 +437,7 @@ std::shared_ptr<BuiltInFunctionStmtBlock> Generator::builtin_function(
     auto p = std::make_shared<BuiltInFunctionStmtBlock>(this, func_name);
     func_index_.emplace(static_cast<uint32_t>(funcs_.size()), func_name);
     funcs_.emplace(func_name, p);
+    mark_dirty();
     return p;
 }
 
@@ -365,6 +463,7 @@ void Generator::add_function(const std::shared_ptr<FunctionStmtBlock> &func) {
             {func.get(), funcs_.at(func_name).get()});
     func_index_.emplace(static_cast<uint32_t>(funcs_.size()), func_name);
     funcs_.emplace(func_name, func);
+    mark_dirty();
     // change the parent
     func->set_parent(this);
 }
@@ -389,6 +488,7 @@ void Generator::add_child_generator(const std::string &instance_name_,
     child->instance_name = instance_name_;
     if (children_.find(child->instance_name) == children_.end()) {
         children_.emplace(child->instance_name, child);
+        mark_dirty();
         child->parent_generator_ = this;
         children_names_.emplace_back(child->instance_name);
     } else {
@@ -423,6 +523,7 @@ void Generator::remove_child_generator(const std::shared_ptr<Generator> &child)
     if (pos != children_names_.end()) {
         children_names_.erase(pos);
         children_.erase(child_name);
+        mark_dirty();
         children_comments_.erase(child_name);
         // need to remove every connected ports
         auto port_names = child->get_port_names();
@@ -482,6 +583,7 @@ void Generator::rename_child_generator(const std::shared_ptr<Generator> &child,
     auto child_handler = children_.extract(child_name);
     child_handler.key() = new_name;
     children_.insert(std::move(child_handler));
+    mark_dirty();
     // the commend
     if (children_comments_.find(child_name) != children_comments_.end()) {
         auto child_comment_handler = children_comments_.extract(child_name);
@@ -507,11 +609,12 @@ void Generator::rename_child_generator(const std::shared_ptr<Generator> &child,
 std::vector<std::string> Generator::get_vars() {
     std::vector<std::string> result;
     result.reserve(vars_.size());
-    for (auto const &[name, ptr] : vars_) {
-        if (ptr->type() == VarType::Base) {
-            result.emplace_back(name);
+    auto const &table = symbols();
+    vars_.for_each([&](Symbol symbol, const std::shared_ptr<Var> &var) {
+        if (var->type() == VarType::Base) {
+            result.emplace_back(table.str(symbol));
         }
-    }
+    });
     std::sort(result.begin(), result.end());
     return result;
 }
@@ -519,7 +622,10 @@ std::vector<std::string> Generator::get_vars() {
 std::vector<std::string> Generator::get_all_var_names() {
     std::vector<std::string> result;
     result.reserve(vars_.size());
-    for (auto const &[name, ptr] : vars_) result.emplace_back(name);
+    auto const &table = symbols();
+    vars_.for_each([&](Symbol symbol, const std::shared_ptr<Var> &) {
+        result.emplace_back(table.str(symbol));
+    });
     std::sort(result.begin(), result.end());
     return result;
 }
@@ -527,6 +633,7 @@ std::vector<std::string> Generator::get_all_var_names() {
 void Generator::add_stmt(std::shared_ptr<Stmt> stmt) {
     stmt->set_parent(this);
     stmts_.emplace_back(std::move(stmt));
+    mark_dirty();
 }
 
 std::string Generator::get_unique_variable_name(const std::string &prefix,
@@ -559,7 +666,7 @@ std::string Generator::get_unique_variable_name(const std::string &prefix,
 
 void Generator::remove_port(const std::string &port_name) {
     if (has_port(port_name)) {
-        ports_.erase(port_name);
+        remove_port_entry(port_name);
         remove_var(port_name);
     }
 }
@@ -567,12 +674,11 @@ void Generator::remove_port(const std::string &port_name) {
 void Generator::rename_var(const std::string &old_name, const std::string &new_name) {
     auto var = get_var(old_name);
     if (!var) return;
-    // Using C++17 to replace the key
-    auto handle = vars_.extract(old_name);
-    handle.key() = new_name;
+    remove_var_entry(old_name);
     // rename the var
     var->name = new_name;
-    vars_.insert(std::move(handle));
+    add_var_entry(new_name, var);
+    mark_dirty();
 }
 
 void Generator::add_call_var(const std::shared_ptr<FunctionCallVar> &var) {
@@ -589,6 +695,7 @@ void Generator::remove_stmt(const std::shared_ptr<Stmt> &stmt) {
     auto pos = std::find(stmts_.begin(), stmts_.end(), stmt);
     if (pos != stmts_.end()) {
         stmts_.erase(pos);
+        mark_dirty();
     }
 }
 
@@ -596,9 +703,9 @@ std::shared_ptr<InterfaceRef> Generator::interface(const std::shared_ptr<IDefini
                                                    const std::string &interface_name,
                                                    bool is_port) {
     // making sure that it doesn't have ports or vars
-    if (vars_.find(interface_name) != vars_.end()) {
+    if (has_var(interface_name)) {
         throw VarException(::format("{0} already exists in {1}", interface_name, instance_name),
-                           {vars_.at(interface_name).get()});
+                           {find_var(interface_name)});
     }
     if (interfaces_.find(interface_name) != interfaces_.end()) {
         throw UserException(::format("{0} already exists in {1}", interface_name, instance_name));
@@ -617,7 +724,8 @@ std::shared_ptr<InterfaceRef> Generator::interface(const std::shared_ptr<IDefini
         auto var_name = ::format("{0}.{1}", interface_name, n);
         auto v = std::make_shared<InterfaceVar>(ref.get(), this, n, width, size, false);
         ref->var(n, v.get());
-        vars_.emplace(var_name, v);
+        add_var_entry(var_name, v);
+        mark_dirty();
     }
     auto const &ports = def->ports();
     for (auto const &n : ports) {
@@ -626,8 +734,9 @@ std::shared_ptr<InterfaceRef> Generator::interface(const std::shared_ptr<IDefini
         auto var_name = ::format("{0}.{1}", interface_name, n);
         auto p = std::make_shared<InterfacePort>(ref.get(), this, dir, n, width, size, type, false);
         ref->port(n, p.get());
-        vars_.emplace(var_name, p);
-        if (is_port) ports_.emplace(var_name);
+        add_var_entry(var_name, p);
+        mark_dirty();
+        if (is_port) add_port_entry(var_name);
     }
     // put it in the interface
     interfaces_.emplace(interface_name, ref);
@@ -899,12 +1008,13 @@ PortPackedStruct &Generator::port_packed(PortDirection direction, const std::str
 PortPackedStruct &Generator::port_packed(PortDirection direction, const std::string &port_name,
                                          const PackedStruct &packed_struct_,
                                          const std::vector<uint32_t> &size) {
-    if (ports_.find(port_name) != ports_.end())
+    if (has_port(port_name))
         throw VarException(::format("{0} already exists in {1}", port_name, name),
-                           {vars_.at(port_name).get()});
+                           {find_var(port_name)});
     auto p = std::make_shared<PortPackedStruct>(this, direction, port_name, packed_struct_, size);
-    vars_.emplace(port_name, p);
-    ports_.emplace(port_name);
+    add_var_entry(port_name, p);
+    mark_dirty();
+    add_port_entry(port_name);
     return *p;
 }
 
@@ -921,11 +1031,12 @@ VarPackedStruct &Generator::var_packed(const std::string &var_name,
 VarPackedStruct &Generator::var_packed(const std::string &var_name,
                                        const PackedStruct &packed_struct_,
                                        const std::vector<uint32_t> &size) {
-    if (vars_.find(var_name) != vars_.end())
+    if (has_var(var_name))
         throw VarException(::format("{0} already exists in {1}", var_name, name),
-                           {vars_.at(var_name).get()});
+                           {find_var(var_name)});
     auto v = std::make_shared<VarPackedStruct>(this, var_name, packed_struct_, size);
-    vars_.emplace(var_name, v);
+    add_var_entry(var_name, v);
+    mark_dirty();
     return *v;
 }
 
@@ -1076,10 +1187,10 @@ void Generator::set_child_comment(const std::string &child_name, const std::stri
 }
 
 void Generator::remove_var(const std::string &var_name) {
-    if (vars_.find(var_name) == vars_.end()) {
+    auto *var = find_var(var_name);
+    if (!var) {
         throw UserException(::format("Cannot find {0} from {1}", var_name, name));
     }
-    auto var = vars_.at(var_name);
     if (!var->sources().empty()) {
         throw UserException(::format("{0} still has source connection(s)"));
     }
@@ -1087,7 +1198,8 @@ void Generator::remove_var(const std::string &var_name) {
         throw UserException(::format("{0} still has sink connection(s)"));
     }
 
-    vars_.erase(var_name);
+    remove_var_entry(var_name);
+    mark_dirty();
 }
 
 std::shared_ptr<StmtBlock> Generator::get_named_block(const std::string &block_name) const {
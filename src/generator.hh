@@ -99,11 +99,14 @@ public:
     // ports and vars
     std::shared_ptr<Port> get_port(const std::string &port_name) const;
     std::shared_ptr<Var> get_var(const std::string &var_name);
-    const std::set<std::string> &get_port_names() const { return ports_; }
-    const std::map<std::string, std::shared_ptr<Var>> &vars() const { return vars_; }
+    // both are built on demand, sorted by name
+    std::set<std::string> get_port_names() const;
+    std::map<std::string, std::shared_ptr<Var>> vars() const;
+    uint64_t num_vars() const { return vars_.size(); }
+    const std::unordered_set<std::shared_ptr<Expr>> &exprs() const { return exprs_; }
     void remove_var(const std::string &var_name);
-    bool has_port(const std::string &port_name) { return ports_.find(port_name) != ports_.end(); }
-    bool has_var(const std::string &var_name) { return vars_.find(var_name) != vars_.end(); }
+    bool has_port(const std::string &port_name) const;
+    bool has_var(const std::string &var_name) const;
     void remove_port(const std::string &port_name);
     void rename_var(const std::string &old_name, const std::string &new_name);
     void add_call_var(const std::shared_ptr<FunctionCallVar> &var);
@@ -133,7 +136,10 @@ public:
     }
     void remove_stmt(const std::shared_ptr<Stmt> &stmt);
     const std::vector<std::shared_ptr<Stmt>> &get_all_stmts() const { return stmts_; }
-    void set_stmts(const std::vector<std::shared_ptr<Stmt>> &stmts) { stmts_ = stmts; }
+    void set_stmts(const std::vector<std::shared_ptr<Stmt>> &stmts) {
+        stmts_ = stmts;
+        mark_dirty();
+    }
 
     // interfaces
     std::shared_ptr<InterfaceRef> interface(const std::shared_ptr<IDefinition> &def,
@@ -198,6 +204,9 @@ public:
     void unwire(Var &var1, Var &var2);
 
     bool debug = false;
+    // identical expressions created through expr() share a single node. it is always off in
+    // debug mode, since every expression needs its own debug info
+    bool share_exprs = true;
 
     const std::unordered_set<std::shared_ptr<Generator>> &get_clones() const { return clones_; }
     std::shared_ptr<Generator> clone();
@@ -263,14 +272,41 @@ public:
     // used for to find out which verilog file it generates to
     std::string verilog_fn;
 
+    // set by the mutating APIs so that only modified generators and their parents are
+    // re-hashed. cleared once the hash is computed
+    void mark_dirty() { dirty_ = true; }
+    bool is_dirty() const { return dirty_; }
+    void clear_dirty() { dirty_ = false; }
+
 private:
     std::vector<std::string> lib_files_;
     Context *context_;
 
-    std::map<std::string, std::shared_ptr<Var>> vars_;
-    std::set<std::string> ports_;
+    // keyed by the interned names
+    SymbolMap<std::shared_ptr<Var>> vars_;
+    SymbolMap<Var *> ports_;
     std::map<std::string, std::shared_ptr<Param>> params_;
     std::unordered_set<std::shared_ptr<Expr>> exprs_;
+    // hash-consing table for exprs_
+    struct ExprKey {
+        ExprOp op;
+        Var *left;
+        Var *right;
+        uint32_t left_width;
+        uint32_t right_width;
+        bool left_signed;
+        bool right_signed;
+
+        bool operator==(const ExprKey &key) const {
+            return op == key.op && left == key.left && right == key.right &&
+                   left_width == key.left_width && right_width == key.right_width &&
+                   left_signed == key.left_signed && right_signed == key.right_signed;
+        }
+    };
+    struct ExprKeyHash {
+        uint64_t operator()(const ExprKey &key) const;
+    };
+    std::unordered_map<ExprKey, Expr *, ExprKeyHash> shared_exprs_;
     std::map<std::string, std::shared_ptr<PortBundleRef>> port_bundle_mapping_;
 
     std::vector<std::shared_ptr<Stmt>> stmts_;
@@ -292,6 +328,8 @@ private:
     // used to identify whether a module instantiation is created
     bool has_instantiated_ = false;
 
+    bool dirty_ = true;
+
     // meta values
     // named blocks
     std::unordered_map<std::string, std::shared_ptr<StmtBlock>> named_blocks_;
@@ -318,6 +356,12 @@ private:
 
     // helper functions
     void check_param_name_conflict(const std::string &parameter_name);
+    SymbolTable &symbols() const;
+    Var *find_var(const std::string &var_name) const;
+    void add_var_entry(const std::string &var_name, const std::shared_ptr<Var> &var);
+    void add_port_entry(const std::string &port_name);
+    void remove_var_entry(const std::string &var_name);
+    void remove_port_entry(const std::string &port_name);
 };
 
 }  // namespace kratos
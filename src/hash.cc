@@ -1,12 +1,13 @@
 #include "hash.hh"
-#include <fstream>
-#include "cxxpool.h"
+#include <unordered_map>
 #include "debug.hh"
 #include "generator.hh"
 #include "graph.hh"
 #include "ir.hh"
 #include "pass.hh"
+#include "scheduler.hh"
 #include "stmt.hh"
+#include "syntax.hh"
 #include "util.hh"
 
 namespace kratos {
@@ -195,9 +196,9 @@ private:
 // this is slower than xxhash
 // but it's simple, so use it to hash the variables
 // based on https://gist.github.com/underscorediscovery/81308642d0325fd386237cfa3b44785c
-uint64_t hash_64_fnv1a(const void* key, uint64_t len) {
+uint64_t hash_64_fnv1a(const void* key, uint64_t len, uint64_t seed) {
     auto data = static_cast<const char*>(key);
-    uint64_t hash = 0xcbf29ce484222325;
+    uint64_t hash = seed;
     uint64_t prime = 0x100000001b3;
 
     for (uint64_t i = 0; i < len; ++i) {
@@ -210,35 +211,119 @@ uint64_t hash_64_fnv1a(const void* key, uint64_t len) {
 
 }  // hash_64_fnv1a
 
+uint64_t hash_64_xx(const void* key, uint64_t len, uint64_t seed) {
+    return XXHash64::hash(key, len, seed);
+}
+
 constexpr uint64_t shift_const(uint64_t value, uint8_t amount) {
     return (value << amount) | (value >> (64u - amount));
 }
 
-static uint64_t hash_var(Var* var) {
-    if (!var) return 0;
-    if (var->type() == VarType::Expression) {
-        auto expr = reinterpret_cast<Expr*>(var);
-        auto op_hash = (uint64_t)expr->op;
-        return hash_var(expr->left) ^ hash_var(expr->right) ^ op_hash;
-    } else if (var->type() == VarType::ConstValue) {
-        auto c = reinterpret_cast<Const*>(var);
-        return static_cast<uint64_t>(c->value());
-    } else if (var->type() == VarType::Parameter) {
-        auto v = var->to_string();
-        return hash_64_fnv1a(v.c_str(), v.size());
-    } else {
-        auto v = var->to_string();
-        auto hash = hash_64_fnv1a(v.c_str(), v.size());
-        if (!var->parametrized()) {
-            hash ^= var->width();
+constexpr uint64_t hash_combine(uint64_t seed, uint64_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6u) + (seed >> 2u));
+}
+
+// structural hash over the var tree. no string is materialized except for the rare
+// cases where the name alone does not describe the node (function calls, interfaces,
+// packed struct members and enum casts).
+// expressions are the only nodes that can be shared as operands, e.g. a chain of
+// t = t + t, so their hashes are memoized. the memo is owned by the hasher, since an
+// expression can be used by several generators that are hashed in parallel
+class VarHasher {
+public:
+
+    uint64_t hash(Var* var) {
+        if (!var) return 0;
+        auto const type = var->type();
+        if (type == VarType::ConstValue) {
+            auto c = reinterpret_cast<Const*>(var);
+            auto hash = hash_combine(static_cast<uint64_t>(c->value()), c->width());
+            return hash_combine(hash, c->is_signed());
         }
+        if (type != VarType::Expression) return compute(var);
+        auto expr = reinterpret_cast<Expr*>(var);
+        auto it = expr_hashes_.find(expr);
+        if (it != expr_hashes_.end()) return it->second;
+        auto hash = compute(var);
+        expr_hashes_.emplace(expr, hash);
         return hash;
     }
-}
+
+private:
+    std::unordered_map<const Expr*, uint64_t> expr_hashes_;
+
+    static uint64_t hash_str(const std::string& str) {
+        return hash_64_fnv1a(str.c_str(), str.size());
+    }
+
+    uint64_t compute(Var* var) {
+        auto const type = var->type();
+        uint64_t hash = static_cast<uint64_t>(type);
+        switch (type) {
+            case VarType::Expression: {
+                auto expr = reinterpret_cast<Expr*>(var);
+                hash = hash_combine(hash, static_cast<uint64_t>(expr->op));
+                if (expr->op == ExprOp::Concat) {
+                    auto concat = reinterpret_cast<VarConcat*>(expr);
+                    for (auto* v : concat->vars()) hash = hash_combine(hash, this->hash(v));
+                } else if (expr->op == ExprOp::Extend) {
+                    auto ext = reinterpret_cast<VarExtend*>(expr);
+                    hash = hash_combine(hash, this->hash(ext->parent_var()));
+                    hash = hash_combine(hash, ext->width());
+                } else {
+                    if (expr->op == ExprOp::Conditional) {
+                        auto cond = reinterpret_cast<ConditionalExpr*>(expr);
+                        hash = hash_combine(hash, this->hash(cond->condition));
+                    }
+                    hash = hash_combine(hash, this->hash(expr->left));
+                    hash = hash_combine(hash, this->hash(expr->right));
+                }
+                return hash;
+            }
+            case VarType::Slice: {
+                auto slice = reinterpret_cast<VarSlice*>(var);
+                if (slice->sliced_by_var()) {
+                    auto var_slice = reinterpret_cast<VarVarSlice*>(slice);
+                    hash = hash_combine(hash, this->hash(slice->parent_var));
+                    return hash_combine(hash, this->hash(var_slice->sliced_var()));
+                }
+                if (dynamic_cast<PackedSlice*>(slice))
+                    return hash_combine(hash, hash_str(var->to_string()));
+                hash = hash_combine(hash, this->hash(slice->parent_var));
+                hash = hash_combine(hash, slice->high);
+                hash = hash_combine(hash, slice->low);
+                hash = hash_combine(hash, slice->var_high());
+                return hash_combine(hash, slice->var_low());
+            }
+            case VarType::BaseCasted: {
+                auto casted = reinterpret_cast<VarCasted*>(var);
+                if (casted->is_enum()) return hash_combine(hash, hash_str(var->to_string()));
+                hash = hash_combine(hash, this->hash(casted->parent_var()));
+                hash = hash_combine(hash, static_cast<uint64_t>(casted->cast_type()));
+                return hash_combine(hash, casted->width());
+            }
+            case VarType::Parameter: {
+                return hash_combine(hash, hash_str(var->to_string()));
+            }
+            default: {
+                if (var->is_function() || var->is_interface() || type == VarType::Iter) {
+                    hash = hash_combine(hash, hash_str(var->to_string()));
+                } else {
+                    hash = hash_combine(hash, hash_str(var->name));
+                }
+                if (!var->parametrized()) {
+                    hash = hash_combine(hash, var->width());
+                }
+                return hash;
+            }
+        }
+    }
+};
 
 class HashVisitor : public IRVisitor {
 public:
     explicit HashVisitor(Generator* root) : root_(root) {
+        use_node_marks();
         context_ = root->context();
         // compute the hash for all vars
         auto vars = root->get_vars();
@@ -261,9 +346,15 @@ public:
         return result;
     }
 
+    void visit_root(IRNode* root) override {
+        // vars are hashed structurally by the stmts that own them, no need to walk them
+        if (root->ir_node_kind() == IRNodeKind::VarKind) return;
+        IRVisitor::visit_root(root);
+    }
+
     void visit(AssignStmt* stmt) override {
         uint64_t stmt_hash =
-            hash_var(stmt->left()) ^ (shift(hash_var(stmt->right()), 1));
+            var_hasher_.hash(stmt->left()) ^ (shift(var_hasher_.hash(stmt->right()), 1));
         // based on level
         stmt_hash = shift(stmt_hash, level);
         stmt_hashes_.emplace_back(stmt_hash);
@@ -275,15 +366,13 @@ public:
         // the number of 0 and 1 the same. And I don't think the shifting will
         // introduce any correlation either
         constexpr uint64_t if_signature = shift_const(0x9e3779b97f4a7c16, 1);
-        auto var = stmt->predicate()->to_string();
-        uint64_t hash = hash_64_fnv1a(var.c_str(), var.size()) << level;
+        uint64_t hash = var_hasher_.hash(stmt->predicate().get()) << level;
         stmt_hashes_.emplace_back(if_signature ^ hash);
     }
 
     void visit(SwitchStmt* stmt) override {
         constexpr uint64_t switch_signature = shift_const(0x9e3779b97f4a7c16, 2);
-        auto var = stmt->target()->to_string();
-        uint64_t hash = hash_64_fnv1a(var.c_str(), var.size()) << level;
+        uint64_t hash = var_hasher_.hash(stmt->target().get()) << level;
         stmt_hashes_.emplace_back(switch_signature ^ hash);
     }
 
@@ -293,15 +382,13 @@ public:
     }
 
     void visit(SequentialStmtBlock* stmt) override {
-        std::string cond;
+        uint64_t hash = 0;
         auto const& conditions = stmt->get_conditions();
         for (auto const& [type, var] : conditions) {
-            if (type == BlockEdgeType::Posedge)
-                cond.append("1" + var->to_string());
-            else
-                cond.append("0" + var->to_string());
+            hash = hash_combine(hash, type == BlockEdgeType::Posedge);
+            hash = hash_combine(hash, var_hasher_.hash(var.get()));
         }
-        uint64_t hash = hash_64_fnv1a(cond.c_str(), cond.size()) << level;
+        hash = hash << level;
         constexpr uint64_t seq_signature = shift_const(0x9e3779b97f4a7c16, 3);
         stmt_hashes_.emplace_back(hash ^ seq_signature);
     }
@@ -324,17 +411,18 @@ public:
     void visit(FunctionCallStmt* stmt) override {
         // this is to hash the call args and func_def
         auto func = stmt->func();
-        auto str = func->function_name();
-        if (str != break_point_func_name) {
+        auto const& func_name = func->function_name();
+        uint64_t hash = hash_64_fnv1a(func_name.c_str(), func_name.size());
+        if (func_name != break_point_func_name) {
             // breakpoint with id doesn't count since their ids will be different all the time
             auto const& var = stmt->var();
             auto const& var_args = var->args();
             // this is ordered map
             for (auto const& iter : var_args) {
-                str.append(iter.second->to_string());
+                hash = hash_combine(hash, var_hasher_.hash(iter.second.get()));
             }
         }
-        uint64_t hash = hash_64_fnv1a(str.c_str(), str.size()) << level;
+        hash = hash << level;
         constexpr uint64_t call_signature = shift_const(0x9e3779b97f4a7c16, 4);
         stmt_hashes_.emplace_back(hash ^ call_signature);
     }
@@ -342,6 +430,7 @@ public:
 private:
     std::vector<uint64_t> var_hashes_;
     std::vector<uint64_t> stmt_hashes_;
+    VarHasher var_hasher_;
     Generator* root_;
     Context* context_;
 
@@ -359,11 +448,9 @@ uint64_t hash_generator(Generator* generator) {
 
 void hash_generator_src(Context* context, Generator* generator) {
     auto filename = generator->external_filename();
-    std::ifstream fs(filename);
-
-    std::string content;
-    content.assign(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
-    uint64_t hash = XXHash64::hash(content.c_str(), content.size(), 0);
+    // the library index only re-hashes the file if it has changed
+    uint64_t hash = fs::exists(filename) ? VerilogLibraryIndex::global().get(filename)->hash
+                                         : XXHash64::hash(nullptr, 0, 0);
     context->add_hash(generator, hash);
 }
 
@@ -373,24 +460,56 @@ void hash_generator_name(Context* context, Generator* generator) {
     context->add_hash(generator, hash);
 }
 
-void hash_generators_context(Context* context, Generator* root, HashStrategy strategy) {
-    // clear the hash first
-    if (!context->track_generated())
-        context->clear_hash();
+// statements of the child generators are part of the parent's hash, so a parent has to be
+// re-hashed if any of its descendants changed
+std::unordered_set<Generator*> get_stale_generators(Context* context,
+                                                    const std::vector<Generator*>& sequence) {
+    // children are placed before their parents
+    std::unordered_set<Generator*> result;
+    for (auto* node : sequence) {
+        bool stale = node->is_dirty() || !context->has_hash(node);
+        if (!stale) {
+            for (auto const& child : node->get_child_generators()) {
+                if (result.find(child.get()) != result.end()) {
+                    stale = true;
+                    break;
+                }
+            }
+        }
+        if (stale) result.emplace(node);
+    }
+    return result;
+}
 
+void hash_generators_context(Context* context, Generator* root, HashStrategy strategy) {
     // compute the generator graph
     GeneratorGraph g(root);
+    auto const& sequence = g.get_sorted_generators();
+    auto stale = get_stale_generators(context, sequence);
+    // only drop the hashes that need to be recomputed
+    if (!context->track_generated()) {
+        std::vector<std::pair<Generator*, uint64_t>> cached;
+        for (auto* node : sequence) {
+            if (stale.find(node) == stale.end()) cached.emplace_back(node, context->get_hash(node));
+        }
+        context->clear_hash();
+        for (auto const& [node, hash] : cached) context->add_hash(node, hash);
+    } else {
+        for (auto* node : stale) context->remove_hash(node);
+    }
+
     // if it's sequential, do topological sort
     // if it's parallel, do level sort
 
     if (strategy == HashStrategy::SequentialHash) {
-        auto const& sequence = g.get_sorted_generators();
         std::vector<Generator*> list;
         // reserve for list
-        list.reserve(sequence.size());
+        list.reserve(stale.size());
 
         for (auto& node : sequence) {
-            // different cases
+            if (stale.find(node) == stale.end()) continue;
+            // different cases. the ones not hashed by their content stay dirty so that they
+            // are always recomputed
             if (node->external()) {
                 if (node->external_filename().empty()) {
                     // user marked external file, skip it
@@ -410,30 +529,21 @@ void hash_generators_context(Context* context, Generator* root, HashStrategy str
         for (auto const& node : list) {
             uint64_t hash = hash_generator(node);
             context->add_hash(node, hash);
+            node->clear_dirty();
         }
     } else if (strategy == HashStrategy::ParallelHash) {
-        uint32_t num_cpus = get_num_cpus();
-        cxxpool::thread_pool pool{num_cpus};
-
-        auto levels = g.get_leveled_generators();
-        // we proceed in a reversed order
-        for (int i = static_cast<int>(levels.size() - 1); i >= 0; i--) {
-            auto list = levels[i];
-            std::vector<uint64_t> hash_values;
-            std::vector<std::future<uint64_t>> thread_tasks;
-            thread_tasks.reserve(list.size());
-
-            for (auto const& node : list) {
-                auto task = pool.push(hash_generator, node);
-                thread_tasks.emplace_back(std::move(task));
-            }
-
-            cxxpool::get(thread_tasks.begin(), thread_tasks.end(), hash_values);
-            for (uint64_t j = 0; j < list.size(); j++) {
-                auto const& node = list[j];
-                auto const hash = hash_values[j];
-                context->add_hash(node, hash);
-            }
+        // reserve the hash entries up front so that workers only update existing entries, which
+        // lets a parent read its children's hashes without locking the context
+        for (auto* node : stale) context->add_hash(node, 0);
+        try {
+            schedule_generators(root, [&stale, context](Generator* node) {
+                if (stale.find(node) == stale.end()) return;
+                context->set_hash(node, hash_generator(node));
+                node->clear_dirty();
+            });
+        } catch (...) {
+            for (auto* node : stale) context->remove_hash(node);
+            throw;
         }
     }
 }
@@ -7,7 +7,10 @@ namespace kratos {
 
 void hash_generators_context(Context *context, Generator *root, HashStrategy strategy);
 
-uint64_t hash_64_fnv1a(const void* key, uint64_t len);
+// seed with the result of a previous call to hash data incrementally
+uint64_t hash_64_fnv1a(const void* key, uint64_t len, uint64_t seed = 0xcbf29ce484222325);
+// faster for large inputs, such as file content
+uint64_t hash_64_xx(const void* key, uint64_t len, uint64_t seed = 0);
 
 }  // namespace kratos
 
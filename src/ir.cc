@@ -1,9 +1,8 @@
 #include "ir.hh"
 
-#include "cxxpool.h"
 #include "generator.hh"
-#include "graph.hh"
-#include "util.hh"
+#include "scheduler.hh"
+#include "stmt.hh"
 
 namespace kratos {
 
@@ -23,19 +22,45 @@ bool IRNode::has_attribute(const std::string &value_str) const {
     return false;
 }
 
+IRVisitor::~IRVisitor() { release_node_marks(); }
+
+void IRVisitor::use_node_marks() {
+    release_node_marks();
+    auto const epoch = ++epoch_counter_;
+    uint64_t no_owner = 0;
+    if (marks_owner_.compare_exchange_strong(no_owner, epoch)) epoch_ = epoch;
+}
+
+void IRVisitor::release_node_marks() {
+    if (!epoch_) return;
+    auto epoch = epoch_;
+    marks_owner_.compare_exchange_strong(epoch, 0);
+    epoch_ = 0;
+}
+
+bool IRVisitor::mark_visited(IRNode *node) {
+    if (epoch_) return node->visit_mark.epoch.exchange(epoch_, std::memory_order_relaxed) != epoch_;
+    return visited_.emplace(node).second;
+}
+
 void IRVisitor::visit_root(IRNode *root) {
     // recursively call visits
     root->accept(this);
     uint64_t child_count = root->child_count();
     level++;
-    std::vector<IRNode *> visits(child_count);
-    for (uint64_t i = 0; i < child_count; i++) {
-        visits[i] = root->get_child(i);
-    }
-    for (auto &child : visits) {
-        if (visited_.find(child) == visited_.end()) {
-            visited_.emplace(child);
-            visit_root(child);
+    if (epoch_) {
+        for (uint64_t i = 0; i < child_count; i++) {
+            auto *child = root->get_child(i);
+            if (mark_visited(child)) visit_root(child);
+        }
+    } else {
+        // children may be changed by the visits
+        std::vector<IRNode *> visits(child_count);
+        for (uint64_t i = 0; i < child_count; i++) {
+            visits[i] = root->get_child(i);
+        }
+        for (auto &child : visits) {
+            if (mark_visited(child)) visit_root(child);
         }
     }
     level--;
@@ -50,24 +75,8 @@ void IRVisitor::visit_generator_root(Generator *generator) {
 }
 
 void IRVisitor::visit_generator_root_p(kratos::Generator *generator) {
-    GeneratorGraph graph(generator);
-    auto levels = graph.get_leveled_generators();
-    uint32_t num_cpus = get_num_cpus();
-    cxxpool::thread_pool pool{num_cpus};
-    for (int i = static_cast<int>(levels.size() - 1); i >= 0; i--) {
-        level = static_cast<uint32_t>(i);
-        pool.clear();
-        auto current_level = levels[i];
-        std::vector<std::future<void>> tasks;
-        tasks.reserve(current_level.size());
-        for (auto *mod : current_level) {
-            auto t = pool.push([=](Generator *g) { g->accept_generator(this); }, mod);
-            tasks.emplace_back(std::move(t));
-        }
-        for (auto &t : tasks) {
-            t.get();
-        }
-    }
+    // a generator is visited once all its child generators are visited
+    schedule_generators(generator, [this](Generator *g) { g->accept_generator(this); });
 }
 
 void IRVisitor::visit_content(Generator *generator) {
@@ -76,32 +85,36 @@ void IRVisitor::visit_content(Generator *generator) {
     uint64_t stmts_count = generator->stmts_count();
     for (uint64_t i = 0; i < stmts_count; i++) {
         auto *child = generator->get_child(i);
-        if (visited_.find(child) == visited_.end()) {
-            visited_.emplace(child);
-            visit_root(child);
-        }
+        if (mark_visited(child)) visit_root(child);
     }
     // visit the vars
     auto var_names = generator->get_all_var_names();
     for (auto const &name : var_names) {
         auto var = generator->get_var(name);
-        auto *ptr = var.get();
-        if (visited_.find(ptr) == visited_.end()) {
-            visited_.emplace(ptr);
-            visit(var.get());
-        }
+        if (mark_visited(var.get())) visit(var.get());
     }
     // visit the functions
     // TODO: refactor this
     auto functions = generator->functions();
     for (auto const &iter : functions) {
         auto *ptr = iter.second.get();
-        if (visited_.find(ptr) == visited_.end()) {
-            visited_.emplace(ptr);
-            visit_root(ptr);
-        }
+        if (mark_visited(ptr)) visit_root(ptr);
     }
 
     level--;
 }
-}  // namespace kratos
\ No newline at end of file
+
+void FusedIRVisitor::visit_generator_content(Generator *generator) {
+    generator->accept_generator(this);
+    uint64_t stmts_count = generator->stmts_count();
+    for (uint64_t i = 0; i < stmts_count; i++) {
+        auto *child = generator->get_child(i);
+        if (mark_visited(child)) visit_root(child);
+    }
+    auto functions = generator->functions();
+    for (auto const &iter : functions) {
+        auto *ptr = iter.second.get();
+        if (mark_visited(ptr)) visit_root(ptr);
+    }
+}
+}  // namespace kratos
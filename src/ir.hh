@@ -1,6 +1,7 @@
 #ifndef KRATOS_IR_HH
 #define KRATOS_IR_HH
 
+#include <atomic>
 #include <cstdint>
 #include <vector>
 
@@ -25,6 +26,15 @@ private:
     std::shared_ptr<void> target_ = nullptr;
 };
 
+// node mark used by the visitors, copies of a node start unmarked
+struct VisitMark {
+    VisitMark() = default;
+    VisitMark(const VisitMark &) {}
+    VisitMark &operator=(const VisitMark &) { return *this; }
+
+    std::atomic<uint64_t> epoch = 0;
+};
+
 struct IRNode {
 public:
     explicit IRNode(IRNodeKind type) : ast_node_type_(type) {}
@@ -56,6 +66,9 @@ public:
     }
     [[nodiscard]] bool has_attribute(const std::string &value_str) const;
 
+    // epoch of the last visitor that marked this node, see IRVisitor::use_node_marks()
+    VisitMark visit_mark;
+
     virtual ~IRNode() = default;
 
 private:
@@ -105,12 +118,83 @@ public:
     // generator specific traversal
     virtual void visit(Generator *) {}
 
-    virtual ~IRVisitor() = default;
+    virtual ~IRVisitor();
 
 protected:
     uint32_t level = 0;
 
     std::unordered_set<IRNode *> visited_;
+
+    // opt into epoch-based node marks instead of visited_. every visitor gets a new epoch and
+    // a node is seen once its mark is set to that epoch, so there is no per-visitor set and the
+    // children are iterated in place. visitors that opt in must not add or remove the children
+    // of the node being visited.
+    // the marks are shared by all the nodes, so only one visitor can own them at a time, until
+    // it is destroyed. visitors that run concurrently, e.g. on different generators that share
+    // constants or ports, would overwrite each other's marks, so while another visitor owns
+    // them this one keeps using visited_
+    void use_node_marks();
+    // returns true the first time the node is seen by this visitor
+    bool mark_visited(IRNode *node);
+
+private:
+    uint64_t epoch_ = 0;
+    inline static std::atomic<uint64_t> epoch_counter_ = 0;
+    // epoch of the visitor that owns the marks, 0 if there is none
+    inline static std::atomic<uint64_t> marks_owner_ = 0;
+
+    void release_node_marks();
+
+    friend class FusedIRVisitor;
+};
+
+// dispatches every node to multiple visitors, so that they share a single traversal
+class FusedIRVisitor : public IRVisitor {
+public:
+    explicit FusedIRVisitor(std::vector<IRVisitor *> visitors) : visitors_(std::move(visitors)) {
+        // the visitors only receive the dispatched nodes, the traversal is done here
+        for (auto *visitor : visitors_) visitor->release_node_marks();
+        use_node_marks();
+    }
+
+    // visit the generator, its statements and functions. child generators are not visited
+    void visit_generator_content(Generator *generator);
+
+    void visit(Var *node) override { dispatch(node); }
+    void visit(Port *node) override { dispatch(node); }
+    void visit(VarSlice *node) override { dispatch(node); }
+    void visit(VarVarSlice *node) override { dispatch(node); }
+    void visit(VarConcat *node) override { dispatch(node); }
+    void visit(Expr *node) override { dispatch(node); }
+    void visit(EnumVar *node) override { dispatch(node); }
+    void visit(EnumConst *node) override { dispatch(node); }
+    void visit(Const *node) override { dispatch(node); }
+    void visit(Param *node) override { dispatch(node); }
+    void visit(FunctionCallVar *node) override { dispatch(node); }
+    void visit(AssignStmt *node) override { dispatch(node); }
+    void visit(ScopedStmtBlock *node) override { dispatch(node); }
+    void visit(IfStmt *node) override { dispatch(node); }
+    void visit(SwitchStmt *node) override { dispatch(node); }
+    void visit(ForStmt *node) override { dispatch(node); }
+    void visit(CombinationalStmtBlock *node) override { dispatch(node); }
+    void visit(SequentialStmtBlock *node) override { dispatch(node); }
+    void visit(LatchStmtBlock *node) override { dispatch(node); }
+    void visit(FunctionStmtBlock *node) override { dispatch(node); }
+    void visit(InitialStmtBlock *node) override { dispatch(node); }
+    void visit(FunctionCallStmt *node) override { dispatch(node); }
+    void visit(ReturnStmt *node) override { dispatch(node); }
+    void visit(ModuleInstantiationStmt *node) override { dispatch(node); }
+    void visit(InterfaceInstantiationStmt *node) override { dispatch(node); }
+    void visit(AssertBase *node) override { dispatch(node); }
+    void visit(Generator *node) override { dispatch(node); }
+
+private:
+    std::vector<IRVisitor *> visitors_;
+
+    template <typename T>
+    void dispatch(T *node) {
+        for (auto *visitor : visitors_) visitor->visit(node);
+    }
 };
 
 // TODO
@@ -1,6 +1,7 @@
 #include "pass.hh"
 
 #include <cassert>
+#include <chrono>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -14,8 +15,10 @@
 #include "fsm.hh"
 #include "generator.hh"
 #include "graph.hh"
+#include "hash.hh"
 #include "interface.hh"
 #include "port.hh"
+#include "scheduler.hh"
 #include "syntax.hh"
 #include "tb.hh"
 #include "util.hh"
@@ -552,14 +555,104 @@ std::map<std::string, std::string> generate_verilog(Generator* top) {
     // this can be parallelized
     unique_visitor.visit_generator_root(top);
     auto const& generator_map = unique_visitor.generator_map();
-    for (const auto& [module_name, module_gen] : generator_map) {
-        SystemVerilogCodeGen codegen(module_gen);
-        result.emplace(module_name, codegen.str());
+    std::vector<std::pair<std::string, Generator*>> modules(generator_map.begin(),
+                                                            generator_map.end());
+    std::vector<std::string> srcs(modules.size());
+    // distinct modules don't share any states, so we can generate them concurrently
+    parallel_for(modules.size(), [&](uint64_t i) {
+        SystemVerilogCodeGen codegen(modules[i].second);
+        srcs[i] = codegen.str();
+    });
+    for (uint64_t i = 0; i < modules.size(); i++) {
+        result.emplace(modules[i].first, std::move(srcs[i]));
     }
     track_generators(top);
     return result;
 }
 
+// size and content hash of every generated file, stored next to the generated files. this is
+// used to skip unchanged files without reading them back. each line is "filename size hash"
+using FileManifest = std::unordered_map<std::string, std::pair<uint64_t, uint64_t>>;
+
+FileManifest load_file_manifest(const std::string& filename) {
+    FileManifest manifest;
+    if (!kratos::fs::exists(filename)) return manifest;
+    std::ifstream in(filename);
+    std::string name;
+    uint64_t size, hash;
+    while (in >> name >> size >> std::hex >> hash >> std::dec) {
+        manifest[name] = {size, hash};
+    }
+    return manifest;
+}
+
+void save_file_manifest(const std::string& filename, const FileManifest& manifest) {
+    // sorted so that the manifest itself is stable
+    std::map<std::string, std::pair<uint64_t, uint64_t>> entries(manifest.begin(),
+                                                                  manifest.end());
+    std::ofstream out(filename, std::ios::trunc);
+    for (auto const& [name, entry] : entries) {
+        out << name << " " << entry.first << " " << std::hex << entry.second << std::dec
+            << std::endl;
+    }
+}
+
+bool is_same_file_content(const std::string& path1, const std::string& path2) {
+    if (kratos::fs::file_size(path1) != kratos::fs::file_size(path2)) return false;
+    // compare chunk by chunk so that we never hold the whole file
+    constexpr uint64_t chunk_size = 1u << 16u;
+    std::ifstream in1(path1, std::ios::binary);
+    std::ifstream in2(path2, std::ios::binary);
+    std::vector<char> buf1(chunk_size), buf2(chunk_size);
+    while (in1 && in2) {
+        in1.read(buf1.data(), chunk_size);
+        in2.read(buf2.data(), chunk_size);
+        auto n = in1.gcount();
+        if (n != in2.gcount() || !std::equal(buf1.begin(), buf1.begin() + n, buf2.begin()))
+            return false;
+    }
+    return true;
+}
+
+// the new content is in new_path, which has the given size and hash
+bool is_file_unchanged(const std::string& path, const std::string& name, uint64_t size,
+                       uint64_t hash, const FileManifest& manifest, const std::string& new_path) {
+    if (!kratos::fs::exists(path)) return false;
+    auto iter = manifest.find(name);
+    if (iter != manifest.end()) {
+        auto const [old_size, old_hash] = iter->second;
+        // the size check on disk catches most of the manual edits
+        return old_size == size && old_hash == hash && kratos::fs::file_size(path) == size;
+    }
+    // not generated by us before, compare the content
+    return is_same_file_content(path, new_path);
+}
+
+// a partially written file, e.g. when the disk is full, must never replace the target
+void write_temp_file(const std::string& new_path,
+                     const std::function<void(std::ostream&)>& write_content) {
+    std::ofstream out(new_path, std::ios::trunc);
+    if (out) write_content(out);
+    if (out) out.close();
+    if (!out) {
+        kratos::fs::remove(new_path);
+        throw UserException(::format("Unable to write to {0}", new_path));
+    }
+}
+
+// content is written to a temporary file first, which only replaces the target if the content
+// changed. returns whether the target is written
+bool commit_file(const std::string& path, const std::string& name, uint64_t size, uint64_t hash,
+                 const FileManifest& manifest, const std::string& new_path) {
+    if (is_file_unchanged(path, name, size, hash, manifest, new_path)) {
+        kratos::fs::remove(new_path);
+        return false;
+    }
+    if (!kratos::fs::rename(new_path, path))
+        throw UserException(::format("Unable to write to {0}", path));
+    return true;
+}
+
 void generate_verilog(Generator* top, const std::string& output_dir,
                       const std::string& package_name, bool debug) {
     // input check
@@ -577,11 +670,9 @@ void generate_verilog(Generator* top, const std::string& output_dir,
 
     // we use header_name + ".svh"
     std::string header_filename = package_name + ".svh";
-    std::map<std::string, std::string> result;
-    for (const auto& [module_name, module_gen] : generator_map) {
-        SystemVerilogCodeGen codegen(module_gen, package_name, header_filename);
-        result.emplace(module_name, codegen.str());
-    }
+    auto manifest_filename = kratos::fs::join(output_dir, package_name + ".manifest");
+    auto manifest = load_file_manifest(manifest_filename);
+
     // write out the content to the output_dir
     // we assume output_dir already exists
     // notice that if the content is the same, we don't override to avoid modifying the timestamps
@@ -589,25 +680,32 @@ void generate_verilog(Generator* top, const std::string& output_dir,
     // ones
     // unfortunately verilator doesn't support incremental build. see
     // https://www.veripool.org/boards/2/topics/2822
-    for (auto const& [module_name, src] : result) {
-        auto path = kratos::fs::join(output_dir, module_name + ".sv");
-        if (kratos::fs::exists(path)) {
-            // load up the file
-            std::ifstream in(path);
-            std::stringstream content_stream;
-            content_stream << in.rdbuf();
-            std::string content = content_stream.str();
-            if (content == src) continue;
-        }
-        // truncate mode
-        std::ofstream out(path, std::ios::trunc);
-        out << src;
+    std::vector<std::pair<std::string, Generator*>> modules(generator_map.begin(),
+                                                            generator_map.end());
+    std::vector<std::pair<uint64_t, uint64_t>> entries(modules.size());
+    // distinct modules don't share any states, so we can generate and write them concurrently
+    parallel_for(modules.size(), [&](uint64_t i) {
+        auto const& [module_name, module_gen] = modules[i];
+        SystemVerilogCodeGen codegen(module_gen, package_name, header_filename);
+        auto filename = module_name + ".sv";
+        auto path = kratos::fs::join(output_dir, filename);
+        // stream the module out so that we don't need to hold the whole module in memory
+        auto new_path = path + ".tmp";
+        write_temp_file(new_path, [&codegen](std::ostream& out) { codegen.write(out); });
+        auto size = codegen.content_size();
+        auto hash = codegen.content_hash();
+        entries[i] = {size, hash};
+        if (!commit_file(path, filename, size, hash, manifest, new_path)) return;
         // tell the system where it went, if allowed
         auto gens = top->context()->get_generators_by_name(module_name);
         for (auto const& gen : gens) {
             if (gen->debug) gen->verilog_fn = path;
         }
+    });
+    for (uint64_t i = 0; i < modules.size(); i++) {
+        manifest[modules[i].first + ".sv"] = entries[i];
     }
+
     // output debug info as well, if required
     if (debug) {
         for (const auto& [module_name, module_gen] : generator_map) {
@@ -640,22 +738,16 @@ void generate_verilog(Generator* top, const std::string& output_dir,
         }
     }
 
-    header_filename = kratos::fs::join(output_dir, header_filename);
-
     // compare it with the old one, if exists. this is for incremental build
     auto values = generate_sv_package_header(top, package_name, true);
     auto def_str = values.first;
-    if (kratos::fs::exists(header_filename)) {
-        std::ifstream in(header_filename);
-        std::stringstream content_stream;
-        content_stream << in.rdbuf();
-        auto content = content_stream.str();
-        if (content == def_str) {
-            return;
-        }
-    }
-    std::ofstream out(header_filename, std::ios::in | std::ios::out | std::ios::trunc);
-    out << def_str;
+    auto header_hash = hash_64_fnv1a(def_str.c_str(), def_str.size());
+    auto header_path = kratos::fs::join(output_dir, header_filename);
+    write_temp_file(header_path + ".tmp", [&def_str](std::ostream& out) { out << def_str; });
+    commit_file(header_path, header_filename, def_str.size(), header_hash, manifest,
+                header_path + ".tmp");
+    manifest[header_filename] = {def_str.size(), header_hash};
+    save_file_manifest(manifest_filename, manifest);
 }
 
 void hash_generators(Generator* top, HashStrategy strategy) {
@@ -967,10 +1059,8 @@ private:
     static void check_var_parent(Generator* generator, Var* dst_var, Var* var, Stmt* stmt) {
         auto* gen = var->generator();
         if (gen == Const::const_gen()) return;
-        if (var->type() == VarType::ConstValue && var->generator() != generator) {
-            var->set_generator(gen);
-            return;
-        }
+        // constants may be shared among generators
+        if (var->type() == VarType::ConstValue && var->generator() != generator) return;
         if (generator != gen) {
             // if it's an input port, the parent context is different
             if (dst_var->type() == VarType::Slice) {
@@ -1012,6 +1102,8 @@ void check_mixed_assignment(Generator* top) {
 
 class SynthesizableVisitor : public IRVisitor {
 public:
+    SynthesizableVisitor() { use_node_marks(); }
+
     void visit(AssignStmt* stmt) override {
         if (stmt->get_delay() >= 0) {
             nodes_.emplace_back(stmt);
@@ -1039,9 +1131,12 @@ private:
 };
 
 void check_non_synthesizable_content(Generator* top) {
-    SynthesizableVisitor visitor;
-    visitor.visit_root(top);
-    auto const& nodes = visitor.nodes();
+    auto const nodes = parallel_collect_stmts<IRNode*>(
+        top, [](Stmt* stmt, std::vector<IRNode*>& result) {
+            SynthesizableVisitor visitor;
+            visitor.visit_root(stmt);
+            result.insert(result.end(), visitor.nodes().begin(), visitor.nodes().end());
+        });
     if (!nodes.empty()) {
         print_nodes(nodes);
         throw UserException(
@@ -1057,6 +1152,8 @@ class ActiveVisitor : public IRVisitor {
     //    because if the async reset is used properly, we will determine the port type first first
     //    if the port is used as an sync reset, the port active type will be undefined.
 public:
+    ActiveVisitor() { use_node_marks(); }
+
     void visit(IfStmt* stmt) override {
         auto predicate = stmt->predicate();
         // notice this just catch some simple mistakes
@@ -1984,6 +2081,9 @@ void merge_wire_assignments(Generator* top) {
 }
 
 class SensitivityVisitor : public IRVisitor {
+public:
+    SensitivityVisitor() { use_node_marks(); }
+
     void visit(SequentialStmtBlock* stmt) override {
         auto const& sensitivity_list = stmt->get_conditions();
         for (auto const& iter : sensitivity_list) {
@@ -2021,8 +2121,10 @@ class SensitivityVisitor : public IRVisitor {
 };
 
 void check_always_sensitivity(Generator* top) {
-    SensitivityVisitor visitor;
-    visitor.visit_root(top);
+    parallel_for_stmts(top, [](Stmt* stmt) {
+        SensitivityVisitor visitor;
+        visitor.visit_root(stmt);
+    });
 }
 
 class PipelineInsertionVisitor : public IRVisitor {
@@ -2725,18 +2827,20 @@ public:
     void visit(Generator* generator) override {
         uint64_t stmt_count = generator->stmts_count();
         for (uint64_t i = 0; i < stmt_count; i++) {
-            auto stmt = generator->get_stmt(i);
-            if (stmt->type() == StatementType::Block) {
-                auto blk = stmt->as<StmtBlock>();
-                if (blk->block_type() == StatementBlockType::Combinational) {
-                    // multiple passes to extract assigned variables
-                    auto stmt_ = blk->as<CombinationalStmtBlock>();
-                    check_combinational(stmt_.get());
-                } else if (blk->block_type() == StatementBlockType::Sequential) {
-                    // multiple passes to extract assigned variables
-                    auto stmt_ = blk->as<SequentialStmtBlock>();
-                    check_sequential(stmt_.get());
-                }
+            check_stmt(generator->get_stmt(i).get());
+        }
+    }
+
+    // block-local
+    static void check_stmt(Stmt* stmt) {
+        if (stmt->type() == StatementType::Block) {
+            auto* blk = reinterpret_cast<StmtBlock*>(stmt);
+            if (blk->block_type() == StatementBlockType::Combinational) {
+                // multiple passes to extract assigned variables
+                check_combinational(reinterpret_cast<CombinationalStmtBlock*>(blk));
+            } else if (blk->block_type() == StatementBlockType::Sequential) {
+                // multiple passes to extract assigned variables
+                check_sequential(reinterpret_cast<SequentialStmtBlock*>(blk));
             }
         }
     }
@@ -2868,8 +2972,7 @@ private:
 };
 
 void check_inferred_latch(Generator* top) {
-    LatchVisitor visitor;
-    visitor.visit_generator_root_p(top);
+    parallel_for_stmts(top, &LatchVisitor::check_stmt);
 }
 
 class MultipleDriverVisitor : public IRVisitor {
@@ -2997,6 +3100,8 @@ void check_multiple_driver(Generator* top) {
 
 class CombinationalLoopVisitor : public IRVisitor {
 public:
+    CombinationalLoopVisitor() { use_node_marks(); }
+
     void visit(Port* port) override { check_var(port); }
     void visit(Var* var) override { check_var(var); }
 
@@ -3034,12 +3139,16 @@ public:
     void visit(Generator* gen) override {
         uint64_t stmt_count = gen->stmts_count();
         for (uint64_t i = 0; i < stmt_count; i++) {
-            auto stmt = gen->get_stmt(i);
-            if (stmt->type() == StatementType::Block) {
-                auto block = stmt->as<StmtBlock>();
-                if (block->block_type() == StatementBlockType::Sequential) {
-                    check_always_ff(block->as<SequentialStmtBlock>().get());
-                }
+            check_stmt(gen->get_stmt(i).get());
+        }
+    }
+
+    // block-local
+    static void check_stmt(Stmt* stmt) {
+        if (stmt->type() == StatementType::Block) {
+            auto* block = reinterpret_cast<StmtBlock*>(stmt);
+            if (block->block_type() == StatementBlockType::Sequential) {
+                check_always_ff(reinterpret_cast<SequentialStmtBlock*>(block));
             }
         }
     }
@@ -3068,8 +3177,7 @@ private:
 };
 
 void check_flip_flop_always_ff(Generator* top) {
-    CheckFlipFlopAlwaysFFVisitor visitor;
-    visitor.visit_generator_root_p(top);
+    parallel_for_stmts(top, &CheckFlipFlopAlwaysFFVisitor::check_stmt);
 }
 
 void sort_stmts(Generator* top) {
@@ -3254,13 +3362,281 @@ void PassManager::add_pass(const std::string& name) {
     passes_order_.emplace_back(name);
 }
 
+uint64_t count_stmts(Stmt* stmt) {
+    uint64_t result = 1;
+    for (uint64_t i = 0; i < stmt->child_count(); i++) {
+        auto* child = stmt->get_child(i);
+        if (child->ir_node_kind() == IRNodeKind::StmtKind)
+            result += count_stmts(reinterpret_cast<Stmt*>(child));
+    }
+    return result;
+}
+
+IRStats compute_ir_stats(Generator* top) {
+    IRStats stats;
+    std::vector<Generator*> generators = {top};
+    while (!generators.empty()) {
+        auto* generator = generators.back();
+        generators.pop_back();
+        stats.num_generators++;
+        stats.num_vars += generator->num_vars();
+        for (uint64_t i = 0; i < generator->stmts_count(); i++) {
+            stats.num_stmts += count_stmts(generator->get_stmt(i).get());
+        }
+        for (auto const& child : generator->get_child_generators()) {
+            generators.emplace_back(child.get());
+        }
+    }
+    return stats;
+}
+
+uint64_t string_heap_size(const std::string& str) {
+    // short strings are stored inline
+    return str.capacity() > std::string().capacity() ? str.capacity() + 1 : 0;
+}
+
+class MemoryUsageVisitor : public IRVisitor {
+public:
+    explicit MemoryUsageVisitor(Generator* generator) : generator_(generator) {}
+
+    void count(IRNode* node) {
+        if (mark_visited(node)) visit_root(node);
+    }
+
+    void visit(Var* var) override { add_var(var, sizeof(Var)); }
+    void visit(Port* var) override { add_var(var, sizeof(Port)); }
+    void visit(VarSlice* var) override { add_var(var, sizeof(VarSlice)); }
+    void visit(VarVarSlice* var) override { add_var(var, sizeof(VarVarSlice)); }
+    void visit(VarConcat* var) override {
+        add_var(var, sizeof(VarConcat) + var->vars().capacity() * sizeof(Var*));
+    }
+    void visit(Expr* var) override { add_var(var, sizeof(Expr)); }
+    void visit(EnumVar* var) override { add_var(var, sizeof(EnumVar)); }
+    void visit(Param* var) override { add_var(var, sizeof(Param)); }
+    void visit(FunctionCallVar* var) override { add_var(var, sizeof(FunctionCallVar)); }
+
+    void visit(AssignStmt* stmt) override { add_stmt(stmt, sizeof(AssignStmt)); }
+    void visit(ScopedStmtBlock* stmt) override { add_stmt(stmt, sizeof(ScopedStmtBlock)); }
+    void visit(IfStmt* stmt) override { add_stmt(stmt, sizeof(IfStmt)); }
+    void visit(SwitchStmt* stmt) override {
+        // one tree node per case
+        add_stmt(stmt, sizeof(SwitchStmt) + stmt->body().size() * 64);
+    }
+    void visit(ForStmt* stmt) override { add_stmt(stmt, sizeof(ForStmt)); }
+    void visit(CombinationalStmtBlock* stmt) override {
+        add_stmt(stmt, sizeof(CombinationalStmtBlock));
+    }
+    void visit(SequentialStmtBlock* stmt) override { add_stmt(stmt, sizeof(SequentialStmtBlock)); }
+    void visit(LatchStmtBlock* stmt) override { add_stmt(stmt, sizeof(LatchStmtBlock)); }
+    void visit(FunctionStmtBlock* stmt) override { add_stmt(stmt, sizeof(FunctionStmtBlock)); }
+    void visit(InitialStmtBlock* stmt) override { add_stmt(stmt, sizeof(InitialStmtBlock)); }
+    void visit(FunctionCallStmt* stmt) override { add_stmt(stmt, sizeof(FunctionCallStmt)); }
+    void visit(ReturnStmt* stmt) override { add_stmt(stmt, sizeof(ReturnStmt)); }
+    void visit(ModuleInstantiationStmt* stmt) override {
+        add_stmt(stmt, sizeof(ModuleInstantiationStmt));
+    }
+    void visit(InterfaceInstantiationStmt* stmt) override {
+        add_stmt(stmt, sizeof(InterfaceInstantiationStmt));
+    }
+
+    MemoryUsage usage;
+
+private:
+    Generator* generator_;
+    // sets can be shared through slices and wrappers
+    std::unordered_set<const AssignStmtSet*> sets_;
+
+    void add_debug_info(IRNode* node) {
+        auto& debug_info = usage.debug_info;
+        debug_info += node->fn_name_ln.capacity() * sizeof(std::pair<std::string, uint32_t>);
+        for (auto const& [fn, ln] : node->fn_name_ln) debug_info += string_heap_size(fn);
+        debug_info += string_heap_size(node->comment);
+        auto const& attributes = node->get_attributes();
+        debug_info += attributes.capacity() * sizeof(std::shared_ptr<Attribute>);
+        for (auto const& attr : attributes) {
+            debug_info += sizeof(Attribute) + string_heap_size(attr->type_str) +
+                          string_heap_size(attr->value_str);
+        }
+    }
+
+    void add_var(Var* var, uint64_t size) {
+        // constants and variables from other generators, e.g. child ports, are not counted
+        if (var->generator() != generator_) return;
+        size += string_heap_size(var->name) + var->size().capacity() * sizeof(uint32_t) +
+                var->get_slices().capacity() * sizeof(std::shared_ptr<VarSlice>);
+        // the sets are part of the object but reported separately
+        size -= 2 * sizeof(AssignStmtSet);
+        usage.connections += 2 * sizeof(AssignStmtSet);
+        for (auto const* set : {&var->sinks(), &var->sources()}) {
+            if (sets_.emplace(set).second) usage.connections += set->heap_size();
+        }
+        switch (var->type()) {
+            case VarType::Slice:
+                usage.slices += size;
+                break;
+            case VarType::Expression:
+                usage.exprs += size;
+                break;
+            default:
+                usage.vars += size;
+        }
+        add_debug_info(var);
+    }
+
+    void add_stmt(Stmt* stmt, uint64_t size) {
+        if (stmt->type() == StatementType::Block) {
+            size += stmt->child_count() * sizeof(std::shared_ptr<Stmt>);
+        }
+        usage.stmts += size;
+        add_debug_info(stmt);
+    }
+};
+
+MemoryUsage compute_memory_usage(Generator* generator) {
+    MemoryUsageVisitor visitor(generator);
+    for (auto const& [name, var] : generator->vars()) visitor.count(var.get());
+    for (auto const& [name, param] : generator->get_params()) visitor.count(param.get());
+    for (auto const& expr : generator->exprs()) visitor.count(expr.get());
+    for (uint64_t i = 0; i < generator->stmts_count(); i++) {
+        visitor.count(generator->get_stmt(i).get());
+    }
+    for (auto const& [name, func] : generator->functions()) visitor.count(func.get());
+    visitor.usage.num_generators = 1;
+    return visitor.usage;
+}
+
+void run_analysis_visitors(Generator* top, const std::vector<AnalysisVisitorFactory>& factories) {
+    schedule_generators(top, [&factories](Generator* generator) {
+        std::vector<std::unique_ptr<IRVisitor>> visitors;
+        std::vector<IRVisitor*> visitor_ptrs;
+        visitors.reserve(factories.size());
+        visitor_ptrs.reserve(factories.size());
+        for (auto const& fn : factories) {
+            visitors.emplace_back(fn());
+            visitor_ptrs.emplace_back(visitors.back().get());
+        }
+        FusedIRVisitor visitor(visitor_ptrs);
+        visitor.visit_generator_content(generator);
+    });
+}
+
+void PassManager::register_analysis_pass(const std::string& name, AnalysisVisitorFactory fn) {
+    register_pass(name, [fn](Generator* top) { run_analysis_visitors(top, {fn}); });
+    analysis_passes_.emplace(name, std::move(fn));
+}
+
 void PassManager::run_passes(Generator* generator) {
-    for (const auto& fn_name : passes_order_) {
-        auto fn = passes_.at(fn_name);
+    pass_stats_.clear();
+    // consecutive analysis passes are merged into one step
+    std::vector<std::pair<std::string, std::function<void(Generator*)>>> steps;
+    steps.reserve(passes_order_.size());
+    auto const is_analysis = [this](const std::string& name) {
+        return analysis_passes_.find(name) != analysis_passes_.end();
+    };
+    for (uint64_t i = 0; i < passes_order_.size();) {
+        uint64_t end = i + 1;
+        if (fuse_analysis_passes_ && is_analysis(passes_order_[i])) {
+            while (end < passes_order_.size() && is_analysis(passes_order_[end])) end++;
+        }
+        if (end - i == 1) {
+            steps.emplace_back(passes_order_[i], passes_.at(passes_order_[i]));
+        } else {
+            std::vector<AnalysisVisitorFactory> factories;
+            for (uint64_t j = i; j < end; j++) {
+                factories.emplace_back(analysis_passes_.at(passes_order_[j]));
+            }
+            auto name = string::join(passes_order_.begin() + i, passes_order_.begin() + end, "+");
+            steps.emplace_back(name, [factories](Generator* top) {
+                run_analysis_visitors(top, factories);
+            });
+        }
+        i = end;
+    }
+
+    if (!instrumented_) {
+        for (auto const& [name, fn] : steps) {
+            fn(generator);
+        }
+        return;
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto seconds = [](clock::duration d) { return std::chrono::duration<double>(d).count(); };
+    auto const run_start = clock::now();
+    auto ir_stats = compute_ir_stats(generator);
+    for (auto const& [name, fn] : steps) {
+        PassStats stats;
+        stats.name = name;
+        stats.before = ir_stats;
+        auto const peak_rss = get_peak_rss();
+        auto const cpu_time = get_cpu_time();
+        auto const start = clock::now();
+
         fn(generator);
+
+        auto const end = clock::now();
+        stats.start_time = seconds(start - run_start);
+        stats.wall_time = seconds(end - start);
+        stats.cpu_time = get_cpu_time() - cpu_time;
+        stats.peak_rss_delta = get_peak_rss() - peak_rss;
+        ir_stats = compute_ir_stats(generator);
+        stats.after = ir_stats;
+        pass_stats_.emplace_back(stats);
     }
 }
 
+std::string escape_json_string(const std::string& str) {
+    std::string result;
+    result.reserve(str.size());
+    for (auto c : str) {
+        if (c == '"' || c == '\\') {
+            result.append(1, '\\');
+            result.append(1, c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            result.append(::format("\\u{0:04x}", static_cast<int>(c)));
+        } else {
+            result.append(1, c);
+        }
+    }
+    return result;
+}
+
+void PassManager::save_trace(const std::string& filename) const {
+    std::ofstream stream(filename, std::ios::trunc);
+    if (stream.bad() || !stream.is_open())
+        throw UserException(::format("Unable to open {0} to write the trace", filename));
+    auto to_us = [](double seconds) { return static_cast<uint64_t>(seconds * 1e6); };
+    std::vector<std::string> events;
+    events.reserve(pass_stats_.size() * 2);
+    for (auto const& stats : pass_stats_) {
+        auto const name = escape_json_string(stats.name);
+        // one complete event per pass
+        events.emplace_back(::format(
+            "{{\"name\": \"{0}\", \"cat\": \"pass\", \"ph\": \"X\", \"pid\": 1, "
+            "\"tid\": 1, \"ts\": {1}, \"dur\": {2}, \"args\": {{\"cpu_time_us\": {3}, "
+            "\"generators\": [{4}, {5}], \"stmts\": [{6}, {7}], \"vars\": [{8}, {9}], "
+            "\"peak_rss_delta\": {10}}}}}",
+            name, to_us(stats.start_time), to_us(stats.wall_time), to_us(stats.cpu_time),
+            stats.before.num_generators, stats.after.num_generators, stats.before.num_stmts,
+            stats.after.num_stmts, stats.before.num_vars, stats.after.num_vars,
+            stats.peak_rss_delta));
+        // ir size after the pass, shown as a counter track
+        events.emplace_back(::format(
+            "{{\"name\": \"ir_size\", \"ph\": \"C\", \"pid\": 1, \"ts\": {0}, "
+            "\"args\": {{\"stmts\": {1}, \"vars\": {2}}}}}",
+            to_us(stats.start_time + stats.wall_time), stats.after.num_stmts,
+            stats.after.num_vars));
+    }
+    stream << "{\"traceEvents\": [" << std::endl;
+    stream << string::join(events.begin(), events.end(), ",\n") << std::endl;
+    stream << "]}" << std::endl;
+}
+
+template <typename T>
+std::unique_ptr<IRVisitor> make_visitor() {
+    return std::make_unique<T>();
+}
+
 void PassManager::register_builtin_passes() {
     register_pass("remove_pass_through_modules", &remove_pass_through_modules);
 
@@ -3282,7 +3658,7 @@ void PassManager::register_builtin_passes() {
 
     register_pass("verify_generator_connectivity", &verify_generator_connectivity);
 
-    register_pass("check_mixed_assignment", &check_mixed_assignment);
+    register_analysis_pass("check_mixed_assignment", &make_visitor<MixedAssignmentVisitor>);
 
     register_pass("merge_wire_assignments", &merge_wire_assignments);
 
@@ -3294,11 +3670,11 @@ void PassManager::register_builtin_passes() {
 
     register_pass("realize_fsm", &realize_fsm);
 
-    register_pass("check_function_return", &check_function_return);
+    register_analysis_pass("check_function_return", &make_visitor<FunctionReturnVisitor>);
 
     register_pass("sort_stmts", &sort_stmts);
 
-    register_pass("check_active_high", &check_active_high);
+    register_analysis_pass("check_active_high", &make_visitor<ActiveVisitor>);
 
     register_pass("check_non_synthesizable_content", &check_non_synthesizable_content);
 
@@ -3314,15 +3690,16 @@ void PassManager::register_builtin_passes() {
 
     register_pass("remove_assertion", &remove_assertion);
 
-    register_pass("check_always_sensitivity", &check_always_sensitivity);
+    register_analysis_pass("check_always_sensitivity", &make_visitor<SensitivityVisitor>);
 
-    register_pass("check_inferred_latch", &check_inferred_latch);
+    register_analysis_pass("check_inferred_latch", &make_visitor<LatchVisitor>);
 
     register_pass("check_multiple_driver", &check_multiple_driver);
 
-    register_pass("check_combinational_loop", &check_combinational_loop);
+    register_analysis_pass("check_combinational_loop", &make_visitor<CombinationalLoopVisitor>);
 
-    register_pass("check_flip_flop_always_ff", &check_flip_flop_always_ff);
+    register_analysis_pass("check_flip_flop_always_ff",
+                           &make_visitor<CheckFlipFlopAlwaysFFVisitor>);
 
     register_pass("convert_continuous_stmt", &convert_continuous_stmt);
 
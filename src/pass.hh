@@ -112,12 +112,48 @@ void realize_fsm(Generator* top);
 
 void sort_stmts(Generator* top);
 
+// IR size of a design hierarchy
+struct IRStats {
+    uint64_t num_generators = 0;
+    uint64_t num_stmts = 0;
+    uint64_t num_vars = 0;
+};
+
+IRStats compute_ir_stats(Generator* top);
+// estimated memory used by the nodes owned by the generator, excluding its child generators
+MemoryUsage compute_memory_usage(Generator* generator);
+
+// collected for every pass when the pass manager is instrumented
+struct PassStats {
+    std::string name;
+    // wall time since run_passes() starts, in seconds
+    double start_time = 0;
+    double wall_time = 0;
+    // process cpu time, which includes all the threads used by the pass
+    double cpu_time = 0;
+    IRStats before;
+    IRStats after;
+    // increase of the process peak RSS, in bytes
+    uint64_t peak_rss_delta = 0;
+};
+
+// creates a fresh visitor of an analysis pass
+using AnalysisVisitorFactory = std::function<std::unique_ptr<IRVisitor>()>;
+
+// run the visitors on every generator within a single traversal. generators are visited in
+// parallel and every generator gets its own set of visitors, so the visitors can't keep any
+// state across generators
+void run_analysis_visitors(Generator* top, const std::vector<AnalysisVisitorFactory>& factories);
+
 class PassManager {
 public:
     PassManager() = default;
 
     void register_pass(const std::string& name, std::function<void(Generator*)> fn);
     void register_pass(const std::string& name, void(fn)(Generator*));
+    // analysis passes only inspect the IR. consecutive analysis passes are fused into a single
+    // traversal of the design
+    void register_analysis_pass(const std::string& name, AnalysisVisitorFactory fn);
     void add_pass(const std::string& name);
 
     [[nodiscard]] bool inline has_pass(const std::string& name) const {
@@ -130,9 +166,24 @@ public:
 
     [[nodiscard]] uint64_t num_passes() const { return passes_order_.size(); }
 
+    // instrumentation. stats are reset every time run_passes() is called
+    void set_instrumented(bool value) { instrumented_ = value; }
+    [[nodiscard]] bool instrumented() const { return instrumented_; }
+    [[nodiscard]] const std::vector<PassStats>& pass_stats() const { return pass_stats_; }
+    // chrome trace event format, can be loaded in chrome://tracing or perfetto
+    void save_trace(const std::string& filename) const;
+
+    void set_fuse_analysis_passes(bool value) { fuse_analysis_passes_ = value; }
+    [[nodiscard]] bool fuse_analysis_passes() const { return fuse_analysis_passes_; }
+
 private:
     std::map<std::string, std::function<void(Generator*)>> passes_;
+    std::map<std::string, AnalysisVisitorFactory> analysis_passes_;
     std::vector<std::string> passes_order_;
+    bool fuse_analysis_passes_ = true;
+
+    bool instrumented_ = false;
+    std::vector<PassStats> pass_stats_;
 };
 
 }  // namespace kratos
@@ -191,11 +191,11 @@ public:
     ModportPort(InterfaceRef *ref, Var *var, PortDirection dir);
 
     // wraps all the critical functions
-    const std::unordered_set<std::shared_ptr<AssignStmt>> &sinks() const override {
+    const AssignStmtSet &sinks() const override {
         return var_->sinks();
     };
     void remove_sink(const std::shared_ptr<AssignStmt> &stmt) override { var_->remove_sink(stmt); }
-    const std::unordered_set<std::shared_ptr<AssignStmt>> &sources() const override {
+    const AssignStmtSet &sources() const override {
         return var_->sources();
     };
     void clear_sinks(bool remove_parent = false) override { var_->clear_sources(remove_parent); }
@@ -0,0 +1,250 @@
+#include "scheduler.hh"
+
+#include <limits>
+#include <unordered_map>
+
+#include "generator.hh"
+#include "graph.hh"
+#include "util.hh"
+
+namespace kratos {
+
+// pool and queue owned by the current thread, if it is a worker
+thread_local ThreadPool *current_pool = nullptr;
+thread_local uint32_t current_queue = 0;
+
+ThreadPool::ThreadPool(uint32_t num_threads) {
+    num_threads = std::max(1u, num_threads);
+    queues_.reserve(num_threads);
+    for (uint32_t i = 0; i < num_threads; i++) queues_.emplace_back(std::make_unique<TaskQueue>());
+    threads_.reserve(num_threads);
+    for (uint32_t i = 0; i < num_threads; i++) {
+        threads_.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(mutex_);
+        stop_ = true;
+    }
+    task_cond_.notify_all();
+    for (auto &t : threads_) t.join();
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::global() {
+    static std::mutex mutex;
+    static std::shared_ptr<ThreadPool> pool;
+    std::lock_guard guard(mutex);
+    // the pool is only replaced from outside the workers, so that a pool is never destroyed
+    // by one of its own threads
+    if (current_pool) {
+        auto self = current_pool->self_.lock();
+        if (self) return self;
+    }
+    auto num_cpus = std::max(1u, get_num_cpus());
+    if (!pool || pool->num_threads() != num_cpus) {
+        pool = std::make_shared<ThreadPool>(num_cpus);
+        pool->self_ = pool;
+    }
+    return pool;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    uint32_t index = current_pool == this ? current_queue : next_queue_++ % queues_.size();
+    {
+        auto &queue = *queues_[index];
+        std::lock_guard guard(queue.mutex);
+        queue.tasks.emplace_back(std::move(task));
+    }
+    num_pending_++;
+    {
+        // make sure sleeping threads won't miss the update
+        std::lock_guard guard(mutex_);
+    }
+    task_cond_.notify_one();
+    if (num_waiters_ > 0) done_cond_.notify_all();
+}
+
+bool ThreadPool::run_one(uint32_t index) {
+    std::function<void()> task;
+    {
+        // own queue first, newest task
+        auto &queue = *queues_[index];
+        std::lock_guard guard(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+    // steal the oldest task from the others
+    for (uint32_t i = 1; !task && i < queues_.size(); i++) {
+        auto &queue = *queues_[(index + i) % queues_.size()];
+        std::lock_guard guard(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+    if (!task) return false;
+    num_pending_--;
+    task();
+    task_done();
+    return true;
+}
+
+void ThreadPool::task_done() {
+    if (num_waiters_ > 0) {
+        {
+            std::lock_guard guard(mutex_);
+        }
+        done_cond_.notify_all();
+    }
+}
+
+void ThreadPool::worker_loop(uint32_t index) {
+    current_pool = this;
+    current_queue = index;
+    while (true) {
+        if (run_one(index)) continue;
+        std::unique_lock lock(mutex_);
+        task_cond_.wait(lock, [this]() { return stop_ || num_pending_ > 0; });
+        if (stop_ && num_pending_ == 0) return;
+    }
+}
+
+void ThreadPool::wait_until(const std::function<bool()> &done) {
+    uint32_t index = current_pool == this ? current_queue : 0;
+    while (!done()) {
+        if (run_one(index)) continue;
+        num_waiters_++;
+        {
+            std::unique_lock lock(mutex_);
+            done_cond_.wait(lock, [&]() { return done() || num_pending_ > 0; });
+        }
+        num_waiters_--;
+    }
+}
+
+void schedule_generators(Generator *root, const std::function<void(Generator *)> &fn) {
+    GeneratorGraph graph(root);
+    // children are always in front of their parents
+    auto const sequence = graph.get_sorted_generators();
+    auto const size = static_cast<uint32_t>(sequence.size());
+    constexpr auto no_parent = std::numeric_limits<uint32_t>::max();
+
+    std::unordered_map<Generator *, uint32_t> indices;
+    indices.reserve(size);
+    for (uint32_t i = 0; i < size; i++) indices.emplace(sequence[i], i);
+
+    std::vector<uint32_t> parents(size, no_parent);
+    auto num_children = std::make_unique<std::atomic<uint32_t>[]>(size);
+    for (uint32_t i = 0; i < size; i++) {
+        auto *node = graph.get_node(sequence[i]);
+        num_children[i] = static_cast<uint32_t>(node->children.size());
+        if (node->parent) parents[i] = indices.at(node->parent->generator);
+    }
+
+    auto pool = ThreadPool::global();
+    std::atomic<uint32_t> num_done = 0;
+    std::atomic<bool> failed = false;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    std::function<void(uint32_t)> run = [&](uint32_t index) {
+        if (!failed) {
+            try {
+                fn(sequence[index]);
+            } catch (...) {
+                std::lock_guard guard(error_mutex);
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+        }
+        // the last child to finish releases the parent
+        auto parent = parents[index];
+        if (parent != no_parent && --num_children[parent] == 0) {
+            pool->submit([&run, parent]() { run(parent); });
+        }
+        num_done++;
+    };
+
+    // collect the leaves before submitting anything, since finished tasks release parents
+    std::vector<uint32_t> leaves;
+    for (uint32_t i = 0; i < size; i++) {
+        if (num_children[i] == 0) leaves.emplace_back(i);
+    }
+    for (auto i : leaves) pool->submit([&run, i]() { run(i); });
+    pool->wait_until([&]() { return num_done == size; });
+
+    if (error) std::rethrow_exception(error);
+}
+
+void parallel_for(uint64_t size, const std::function<void(uint64_t)> &fn) {
+    if (size == 0) return;
+    auto pool = ThreadPool::global();
+    std::atomic<uint64_t> num_done = 0;
+    // calls after the lowest failed index are skipped
+    std::atomic<uint64_t> failed_index = std::numeric_limits<uint64_t>::max();
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    for (uint64_t i = 0; i < size; i++) {
+        pool->submit([&, i]() {
+            if (i < failed_index) {
+                try {
+                    fn(i);
+                } catch (...) {
+                    std::lock_guard guard(error_mutex);
+                    if (i < failed_index) {
+                        error = std::current_exception();
+                        failed_index = i;
+                    }
+                }
+            }
+            num_done++;
+        });
+    }
+    pool->wait_until([&]() { return num_done == size; });
+
+    if (error) std::rethrow_exception(error);
+}
+
+std::vector<Stmt *> get_block_local_stmts(Generator *root) {
+    GeneratorGraph graph(root);
+    auto const generators = graph.get_sorted_generators();
+    std::vector<Stmt *> result;
+    for (auto *generator : generators) {
+        auto const stmts_count = generator->stmts_count();
+        for (uint64_t i = 0; i < stmts_count; i++) {
+            result.emplace_back(generator->get_stmt(i).get());
+        }
+        for (auto const &iter : generator->functions()) {
+            result.emplace_back(iter.second.get());
+        }
+    }
+    return result;
+}
+
+uint64_t stmts_chunk_size(uint64_t num_stmts) {
+    // a few chunks per thread so that stealing can balance the uneven blocks
+    constexpr uint64_t min_chunk_size = 16;
+    auto const num_chunks = static_cast<uint64_t>(ThreadPool::global()->num_threads()) * 8;
+    return std::max(min_chunk_size, (num_stmts + num_chunks - 1) / num_chunks);
+}
+
+void parallel_for_chunks(uint64_t size, const std::function<void(uint64_t)> &fn) {
+    auto const chunk_size = stmts_chunk_size(size);
+    auto const num_chunks = (size + chunk_size - 1) / chunk_size;
+    parallel_for(num_chunks, [&](uint64_t chunk) {
+        auto const end = std::min<uint64_t>(size, (chunk + 1) * chunk_size);
+        for (uint64_t i = chunk * chunk_size; i < end; i++) fn(i);
+    });
+}
+
+void parallel_for_stmts(Generator *root, const std::function<void(Stmt *)> &fn) {
+    auto const stmts = get_block_local_stmts(root);
+    parallel_for_chunks(stmts.size(), [&](uint64_t i) { fn(stmts[i]); });
+}
+
+}  // namespace kratos
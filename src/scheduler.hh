@@ -0,0 +1,106 @@
+#ifndef KRATOS_SCHEDULER_HH
+#define KRATOS_SCHEDULER_HH
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kratos {
+
+class Generator;
+class Stmt;
+
+// persistent work-stealing pool. every worker owns a queue and pops its own tasks in LIFO
+// order; idle workers steal from the other end of their peers' queues.
+// threads waiting on the pool help executing tasks, so nested parallel calls won't deadlock
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t num_threads);
+    ~ThreadPool();
+
+    // process-wide pool, sized by get_num_cpus(). when the number of cpus changes, a new pool
+    // is created and the old one lives on until every caller holding it is done.
+    // workers always get their own pool back
+    static std::shared_ptr<ThreadPool> global();
+
+    void submit(std::function<void()> task);
+    // run queued tasks on the calling thread until done() returns true
+    void wait_until(const std::function<bool()> &done);
+
+    [[nodiscard]] uint32_t num_threads() const { return static_cast<uint32_t>(threads_.size()); }
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::weak_ptr<ThreadPool> self_;
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<uint64_t> num_pending_ = 0;
+    std::atomic<uint32_t> next_queue_ = 0;
+    std::atomic<uint32_t> num_waiters_ = 0;
+    bool stop_ = false;
+
+    std::mutex mutex_;
+    std::condition_variable task_cond_;
+    std::condition_variable done_cond_;
+
+    void worker_loop(uint32_t index);
+    bool run_one(uint32_t index);
+    void task_done();
+};
+
+// run fn on every generator in the hierarchy. a generator is scheduled as soon as all its
+// child generators are done, there is no barrier between hierarchy levels.
+// the first exception thrown by fn is re-thrown once all the running tasks are finished
+void schedule_generators(Generator *root, const std::function<void(Generator *)> &fn);
+
+// run fn(0) ... fn(size - 1) on the global pool. if several calls fail, the exception with the
+// lowest index is re-thrown, so errors are reported the same way regardless of the scheduling
+void parallel_for(uint64_t size, const std::function<void(uint64_t)> &fn);
+// same as above, but a task runs a chunk of consecutive indices, for fine-grained work
+void parallel_for_chunks(uint64_t size, const std::function<void(uint64_t)> &fn);
+
+// top-level statements and function definitions of every generator in the hierarchy,
+// children first
+std::vector<Stmt *> get_block_local_stmts(Generator *root);
+
+// block-local passes only read or change the statement they are given, thus the statements
+// within a single generator can be processed in parallel. statements are split into chunks
+void parallel_for_stmts(Generator *root, const std::function<void(Stmt *)> &fn);
+// number of statements or indices processed by a single task
+uint64_t stmts_chunk_size(uint64_t num_stmts);
+
+// same as above, except that every chunk appends its results to its own buffer. the buffers
+// are merged in statement order afterwards
+template <typename T>
+std::vector<T> parallel_collect_stmts(Generator *root,
+                                      const std::function<void(Stmt *, std::vector<T> &)> &fn) {
+    auto const stmts = get_block_local_stmts(root);
+    auto const chunk_size = stmts_chunk_size(stmts.size());
+    auto const num_chunks = (stmts.size() + chunk_size - 1) / chunk_size;
+    std::vector<std::vector<T>> buffers(num_chunks);
+    parallel_for(num_chunks, [&](uint64_t chunk) {
+        auto const end = std::min<uint64_t>(stmts.size(), (chunk + 1) * chunk_size);
+        for (uint64_t i = chunk * chunk_size; i < end; i++) fn(stmts[i], buffers[chunk]);
+    });
+    std::vector<T> result;
+    for (auto &buffer : buffers) {
+        result.insert(result.end(), std::make_move_iterator(buffer.begin()),
+                      std::make_move_iterator(buffer.end()));
+    }
+    return result;
+}
+
+}  // namespace kratos
+
+#endif  // KRATOS_SCHEDULER_HH
@@ -3,7 +3,9 @@
 #include "eval.hh"
 #include "except.hh"
 #include "fmt/format.h"
+#include "graph.hh"
 #include "pass.hh"
+#include "scheduler.hh"
 #include "stmt.hh"
 #include "util.hh"
 
@@ -11,6 +13,14 @@ using fmt::format;
 
 namespace kratos {
 
+inline uint64_t sim_mask(uint32_t width) { return width >= 64 ? UINT64_MASK : ~(UINT64_MASK << width); }
+// the bound is checked first, 1 << 64 is undefined
+inline uint64_t sim_clog2(uint64_t value) {
+    uint64_t result = 0;
+    while (result < 64 && (1ull << result) < value) result++;
+    return result;
+}
+
 class DependencyVisitor : public IRVisitor {
 public:
     DependencyVisitor() = default;
@@ -191,9 +201,80 @@ Simulator::Simulator(kratos::Generator *generator) {
     visitor.visit_generator_root_p(generator);
     dependency_ = visitor.dependency();
     linked_dependency_ = visitor.linked_dependency();
+    // lay out every variable in the value store ahead of time
+    GeneratorGraph graph(generator);
+    auto generators = graph.get_sorted_generators();
+    for (auto const *gen : generators) {
+        for (auto const &iter : gen->vars()) {
+            auto const *var = iter.second.get();
+            if (var->type() == VarType::Base || var->type() == VarType::PortIO)
+                values_.entry(var);
+        }
+    }
     init_pull_up_value(generator);
 }
 
+const SimValueStore::Entry &SimValueStore::entry(const Var *root) {
+    auto it = entries_.find(root);
+    if (it != entries_.end()) return it->second;
+    Entry entry{num_bits_, root->width(), static_cast<uint32_t>(entries_.size())};
+    num_bits_ += entry.width;
+    bits_.resize((num_bits_ + 63) / 64, 0);
+    valid_.resize((entries_.size() + 1 + 63) / 64, 0);
+    return entries_.emplace(root, entry).first->second;
+}
+
+uint64_t SimValueStore::read(uint64_t offset, uint32_t width) const {
+    auto word = offset / 64;
+    auto low = offset % 64;
+    uint64_t value = bits_[word] >> low;
+    if (low + width > 64) value |= bits_[word + 1] << (64 - low);
+    return value & sim_mask(width);
+}
+
+void SimValueStore::write(uint64_t offset, uint32_t width, uint64_t value) {
+    auto word = offset / 64;
+    auto low = offset % 64;
+    value &= sim_mask(width);
+    auto mask = sim_mask(width) << low;
+    bits_[word] = (bits_[word] & ~mask) | (value << low);
+    if (low + width > 64) {
+        auto high_mask = sim_mask(low + width - 64);
+        bits_[word + 1] = (bits_[word + 1] & ~high_mask) | (value >> (64 - low));
+    }
+}
+
+std::vector<uint64_t> SimValueStore::read_words(uint64_t offset, uint32_t width) const {
+    std::vector<uint64_t> words(num_words(width), 0);
+    bv_copy(words.data(), 0, bits_.data() + offset / 64, offset % 64, width);
+    return words;
+}
+
+void SimValueStore::write_words(uint64_t offset, uint32_t width,
+                                const std::vector<uint64_t> &words) {
+    // missing words are zero
+    auto value = words;
+    value.resize(num_words(width), 0);
+    bv_copy(bits_.data() + offset / 64, offset % 64, value.data(), 0, width);
+}
+
+void SimValueStore::load(const State &state) {
+    // variables allocated after the snapshot was taken are invalid
+    auto num_words = bits_.size();
+    auto num_valid = valid_.size();
+    bits_ = state.bits;
+    valid_ = state.valid;
+    bits_.resize(num_words, 0);
+    valid_.resize(num_valid, 0);
+}
+
+void Simulator::load_state(const SimValueStore::State &state) {
+    values_.load(state);
+    event_queue_ = {};
+    nba_values_.clear();
+    scope_.clear();
+}
+
 std::optional<uint64_t> Simulator::get_value_(const kratos::Var *var) const {
     if (!var) return std::nullopt;
     // only scalar
@@ -214,34 +295,19 @@ std::optional<uint64_t> Simulator::get_value_(const kratos::Var *var) const {
         }
     } else if (var->type() == VarType::Slice) {
         auto root = var->get_var_root_parent();
-        std::vector<uint64_t> values;
-        if (root->type() == VarType::ConstValue || root->type() == VarType::Parameter) {
-            auto value = get_value_(var);
-            if (!value)
-                throw InternalException(
-                    ::format("Unable to get value for {0}", var->handle_name()));
-            values = {*value};
-        } else if (root->size().size() == 1 && root->size().front() == 1) {
-            // this is size one
-            auto value = get_value_(root);
-            if (!value) return std::nullopt;
-            values = {*value};
-        } else if (complex_values_.find(root) == complex_values_.end()) {
-            return std::nullopt;
-        } else {
-            values = complex_values_.at(root);
-        }
-        // obtain the index
-        auto index = get_slice_index(var);
-        if (index.empty()) return std::nullopt;
-        auto const [var_high, var_low] = compute_var_high_low(root, index);
+        auto range = get_slice_range(var);
+        if (!range) return std::nullopt;
+        auto const [var_high, var_low] = *range;
         if (var_high + 1 - var_low > root->width())
             throw InternalException("Unable to resolve variable slicing");
-        auto base = var_low / root->var_width();
-        auto low = var_low % root->var_width();
-        auto high = var_high % root->var_width();
-        auto value = values[base];
-        return (value >> low) & (~(0xFFFFFFFFFFFFFFFF << (high + 1)));
+        auto width = std::min<uint32_t>(var_high + 1 - var_low, 64);
+        if (root->type() == VarType::ConstValue || root->type() == VarType::Parameter) {
+            auto value = static_cast<uint64_t>(reinterpret_cast<const Const *>(root)->value());
+            return var_low >= 64 ? 0 : (value >> var_low) & sim_mask(width);
+        }
+        auto const &entry = values_.entry(root);
+        if (!values_.valid(entry)) return std::nullopt;
+        return values_.read(entry.offset + var_low, width);
     } else {
         // function call
         if (var->is_function()) {
@@ -256,10 +322,9 @@ std::optional<uint64_t> Simulator::get_value_(const kratos::Var *var) const {
             return std::nullopt;
 
         } else {
-            if (values_.find(var) == values_.end())
-                return std::nullopt;
-            else
-                return values_.at(var);
+            auto const &entry = values_.entry(var);
+            if (!values_.valid(entry)) return std::nullopt;
+            return values_.read(entry.offset, std::min<uint32_t>(entry.width, 64));
         }
     }
 }
@@ -271,107 +336,86 @@ void Simulator::set_value_(const kratos::Var *var, std::optional<uint64_t> op_va
         set_complex_value_(var, std::vector<uint64_t>{value});
         return;
     }
+    if (var->width() > 64) {
+        set_wide_value_(var, {value});
+        return;
+    }
     if (var->type() == VarType::Parameter || var->type() == VarType::ConstValue) {
         throw UserException(::format("Cannot set value for constant {0}", var->handle_name()));
-    } else if (var->type() == VarType::Slice) {
-        auto root = var->get_var_root_parent();
-        std::vector<uint64_t *> values;
+    }
+    const Var *root = var;
+    uint32_t var_low = 0;
+    uint32_t width = var->width();
+    if (var->type() == VarType::Slice) {
+        root = var->get_var_root_parent();
         if (root->type() == VarType::ConstValue || root->type() == VarType::Parameter) {
             throw UserException(::format("Cannot set value for constant {0}", var->handle_name()));
-        } else if (root->size().size() == 1 && root->size().front() == 1) {
-            // this is size one
-            if (values_.find(root) == values_.end()) values_[root] = 0;
-            values = {&values_.at(root)};
-        } else {
-            uint32_t base = 1;
-            for (uint32_t s : root->size()) {
-                base *= s;
-            }
-            if (complex_values_.find(root) == complex_values_.end()) {
-                // fill in values
-                std::vector<uint64_t> v(base);
-                for (uint64_t i = 0; i < base; i++) v[i] = 0;
-                complex_values_.emplace(root, v);
-            }
-            std::vector<uint64_t> &v_ref = complex_values_.at(root);
-            values.reserve(base);
-            for (uint64_t i = 0; i < base; i++) values.emplace_back(&v_ref[i]);
         }
         // obtain the index
-        auto index = get_slice_index(var);
-        if (index.empty()) throw InternalException("Empty slice");
-        auto [var_high, var_low] = compute_var_high_low(root, index);
-        if (var_high + 1 - var_low > root->width())
+        auto range = get_slice_range(var);
+        if (!range) throw InternalException("Empty slice");
+        auto const [var_high, low] = *range;
+        if (var_high + 1 - low > root->width())
             throw InternalException("Unable to resolve variable slicing");
-        auto base = var_low / root->var_width();
-        var_high = var_high - base * root->var_width();
-        var_low = var_low - base * root->var_width();
-        auto v = values[base];
-        auto temp = *v;
-        // compute the mask
-        uint64_t mask = (0xFFFFFFFFFFFFFFFF >> (var_high + 1)) >> var_low;
-        *v = *v & (~mask);
-        value = value & (0xFFFFFFFFFFFFFFFF >> (var_high - var_low + 1));
-        *v = *v | (value << var_low);
-        if (*v != temp) {
-            std::unordered_set<uint32_t> changed_bits;
-            uint64_t m = (*v) ^ temp;
-            for (uint32_t bit = 0; bit < root->width(); bit++) {
+        var_low = low;
+        width = var_high + 1 - low;
+    }
+    width = std::min<uint32_t>(width, 64);
+    auto const &entry = values_.entry(root);
+    std::unordered_set<uint32_t> changed_bits;
+    value &= sim_mask(width);
+    if (values_.valid(entry)) {
+        auto temp = values_.read(entry.offset + var_low, width);
+        uint64_t m = value ^ temp;
+        if (m) {
+            values_.write(entry.offset + var_low, width, value);
+            for (uint32_t bit = 0; bit < width; bit++) {
                 if ((m >> bit) & 1u) {
-                    changed_bits.emplace(bit);
+                    changed_bits.emplace(bit + var_low);
                 }
             }
-            trigger_event(root, changed_bits);
         }
     } else {
-        std::unordered_set<uint32_t> changed_bits;
-        if (values_.find(var) != values_.end()) {
-            auto temp = values_.at(var);
-            if (temp != value) {
-                values_[var] = value;
-                uint64_t m = value ^ temp;
-                for (uint32_t bit = 0; bit < var->width(); bit++) {
-                    if ((m >> bit) & 1u) {
-                        changed_bits.emplace(bit);
-                    }
-                }
-            }
-        } else {
-            values_[var] = value;
-            for (uint32_t i = 0; i < var->width(); i++) changed_bits.emplace(i);
-        }
-        trigger_event(var, changed_bits);
+        // the rest of the bits are pulled down
+        values_.set_valid(entry);
+        values_.write(entry.offset + var_low, width, value);
+        for (uint32_t i = 0; i < width; i++) changed_bits.emplace(i + var_low);
     }
+    trigger_event(root, changed_bits);
 }
 
 std::optional<std::vector<uint64_t>> Simulator::get_complex_value_(const kratos::Var *var) const {
     if (!var) return std::nullopt;
     if (var->size().size() == 1 && var->size().front() == 1) {
-        // this is a scalar
+        // this is a scalar. wide values are returned as words
+        if (var->width() > 64) return get_wide_value_(var);
         auto v = get_value_(var);
         if (v)
             return std::vector<uint64_t>{*v};
         else
             return std::nullopt;
     }
+    auto root = var->get_var_root_parent();
+    uint32_t var_low = 0;
+    uint32_t var_high = var->width() - 1;
     if (var->type() == VarType::Slice) {
-        auto root = var->get_var_root_parent();
-        auto index = get_slice_index(var);
-        if (index.empty()) return std::nullopt;
-        auto const [var_high, var_low] = compute_var_high_low(root, index);
+        auto range = get_slice_range(var);
+        if (!range) return std::nullopt;
+        std::tie(var_high, var_low) = *range;
         if (var_low % root->var_width() != 0 ||
             (var_high % root->var_width() != root->var_width() - 1))
             throw InternalException("Misaligned vector slicing");
-        if (complex_values_.find(root) == complex_values_.end()) return std::nullopt;
-        auto values = complex_values_.at(root);
-        // compute the slice range
-        auto low = var_low / root->var_width();
-        auto high = var_high / root->var_width();
-        return std::vector<uint64_t>(values.begin() + low, values.end() + high + 1);
-    } else {
-        if (complex_values_.find(var) == complex_values_.end()) return std::nullopt;
-        return complex_values_.at(var);
     }
+    auto const &entry = values_.entry(root);
+    if (!values_.valid(entry)) return std::nullopt;
+    auto var_width = root->var_width();
+    auto width = std::min<uint32_t>(var_width, 64);
+    std::vector<uint64_t> result;
+    result.reserve((var_high + 1 - var_low) / var_width);
+    for (uint64_t low = var_low; low <= var_high; low += var_width) {
+        result.emplace_back(values_.read(entry.offset + low, width));
+    }
+    return result;
 }
 
 void Simulator::set_complex_value_(const kratos::Var *var,
@@ -379,99 +423,219 @@ void Simulator::set_complex_value_(const kratos::Var *var,
     if (!op_value) return;
     auto value = *op_value;
     if (var->size().size() == 1 && var->size().front() == 1) {
+        if (var->width() > 64) {
+            set_wide_value_(var, value);
+            return;
+        }
         if (value.size() > 1) throw UserException("Cannot set multiple values to a scalar");
         set_value_(var, value[0]);
         return;
     }
-    std::vector<uint64_t *> values;
-    uint64_t base = 1;
-    const Var *fill_var;
-    uint32_t low, high;
+    auto fill_var = var->get_var_root_parent();
+    uint32_t var_low = 0;
+    uint32_t var_high = var->width() - 1;
     if (var->type() == VarType::Slice) {
-        auto root = var->get_var_root_parent();
-        fill_var = root;
-        auto index = get_slice_index(var);
-        if (index.empty()) throw InternalException("Empty slice");
-        auto const [var_high, var_low] = compute_var_high_low(root, index);
-        if (var_low % root->var_width() != 0 ||
-            (var_high % root->var_width() != root->var_width() - 1))
+        auto range = get_slice_range(var);
+        if (!range) throw InternalException("Empty slice");
+        std::tie(var_high, var_low) = *range;
+        if (var_low % fill_var->var_width() != 0 ||
+            (var_high % fill_var->var_width() != fill_var->var_width() - 1))
             throw InternalException("Misaligned vector slicing");
-        low = var_low;
-        high = var_high;
-        if (root->size().size() == 1 && root->size().front() == 1) {
-            // this is size one
-            if (values_.find(root) == values_.end()) values_[root] = 0;
-            values = {&values_.at(root)};
-        } else {
-            for (uint32_t s : root->size()) {
-                base *= s;
-            }
-            std::vector<uint64_t> &v_ref = complex_values_.at(root);
-            values.reserve(base);
-            for (uint64_t i = 0; i < base; i++) values.emplace_back(&v_ref[i]);
-        }
-    } else {
-        for (uint32_t s : var->size()) {
-            base *= s;
-        }
-        fill_var = var;
-        low = 0;
-        high = base - 1;
-    }
-    bool fill_in = false;
-    if (complex_values_.find(fill_var) == complex_values_.end()) {
-        // whatever bits changed
-        // fill in values
-        fill_in = true;
-        if (complex_values_.find(fill_var) == complex_values_.end()) {
-            // fill in values
-            std::vector<uint64_t> v(base);
-            for (uint64_t i = 0; i < base; i++) v[i] = 0;
-            complex_values_.emplace(var, v);
-        }
-    }
-
-    // get values
-    if (var->type() != VarType::Slice) {
-        values.reserve(base);
-        auto &v_ref = complex_values_.at(var);
-        for (uint64_t i = 0; i < base; i++) values.emplace_back(&v_ref[i]);
     }
+    uint32_t var_width = fill_var->var_width();
+    uint32_t width = std::min<uint32_t>(var_width, 64);
+    uint64_t num_values = (var_high + 1 - var_low) / var_width;
 
-    if (values.size() != value.size()) {
+    if (num_values != value.size()) {
         // expand the value to if the target is packed
         if (fill_var->is_packed()) {
             if (value.size() > 1) {
                 throw InternalException("Multiple value assigned to packed array not supported");
             }
             auto v = value[0];
-            std::vector<uint64_t> v_(values.size());
-            for (uint64_t i = 0; i < values.size(); i++) {
-                auto w = fill_var->var_width();
-                v_[i] = (v >> (w * i)) & (~(UINT64_MASK << w));
+            std::vector<uint64_t> v_(num_values);
+            for (uint64_t i = 0; i < num_values; i++) {
+                v_[i] = var_width * i >= 64 ? 0 : (v >> (var_width * i)) & sim_mask(width);
             }
             value = v_;
         } else {
             throw UserException("Misaligned slicing");
         }
     };
-    std::unordered_set<uint32_t> changed_bits;
-    uint32_t var_width = fill_var->var_width();
 
-    for (uint32_t i = low; i <= high; i++) {
-        if (*(values[i]) != value[i] || fill_in) {
-            uint32_t bit_mask = (*values[i]) ^ value[i];
-            *(values[i]) = value[i];
+    auto const &entry = values_.entry(fill_var);
+    bool fill_in = !values_.valid(entry);
+    if (fill_in) values_.set_valid(entry);
+    std::unordered_set<uint32_t> changed_bits;
+    for (uint32_t i = 0; i < num_values; i++) {
+        auto low = var_low + i * var_width;
+        auto old = values_.read(entry.offset + low, width);
+        auto v = value[i] & sim_mask(width);
+        if (old != v || fill_in) {
+            uint64_t bit_mask = old ^ v;
+            values_.write(entry.offset + low, width, v);
             for (uint32_t bit = 0; bit < var_width; bit++) {
-                if ((bit_mask >> bit) & 1u || fill_in) {
-                    changed_bits.emplace(bit + var_width * i);
+                if ((bit < 64 && (bit_mask >> bit) & 1u) || fill_in) {
+                    changed_bits.emplace(bit + low);
                 }
             }
         }
     }
+    // whatever bits changed
     trigger_event(fill_var, changed_bits);
 }
 
+std::optional<std::vector<uint64_t>> Simulator::get_words_(const Var *var) const {
+    if (var->size().size() == 1 && var->size().front() == 1) {
+        if (var->width() > 64) return get_wide_value_(var);
+        auto v = get_value_(var);
+        if (!v) return std::nullopt;
+        return std::vector<uint64_t>{*v};
+    }
+    // flatten the array
+    auto values = get_complex_value_(var);
+    if (!values) return std::nullopt;
+    auto var_width = var->var_width();
+    std::vector<uint64_t> result(num_words(var->width()), 0);
+    for (uint32_t i = 0; i < values->size(); i++) {
+        bv_deposit(result.data(), i * var_width, std::min<uint32_t>(var_width, 64),
+                   (*values)[i]);
+    }
+    return result;
+}
+
+std::optional<std::vector<uint64_t>> Simulator::get_wide_value_(const Var *var) const {
+    auto width = var->width();
+    if (var->type() == VarType::Parameter || var->type() == VarType::ConstValue) {
+        auto value = reinterpret_cast<const Const *>(var)->value();
+        std::vector<uint64_t> words(num_words(width), value < 0 ? UINT64_MASK : 0);
+        words[0] = static_cast<uint64_t>(value);
+        bv_truncate(words.data(), width);
+        return words;
+    } else if (var->type() == VarType::Expression) {
+        return eval_expr(var);
+    }
+    auto root = var->get_var_root_parent();
+    uint32_t var_low = 0;
+    if (var->type() == VarType::Slice) {
+        auto range = get_slice_range(var);
+        if (!range) return std::nullopt;
+        var_low = range->second;
+    } else if (var->is_function()) {
+        return std::nullopt;
+    }
+    auto const &entry = values_.entry(root);
+    if (!values_.valid(entry)) return std::nullopt;
+    return values_.read_words(entry.offset + var_low, width);
+}
+
+void Simulator::set_wide_value_(const Var *var, const std::vector<uint64_t> &value) {
+    if (var->type() == VarType::Parameter || var->type() == VarType::ConstValue) {
+        throw UserException(::format("Cannot set value for constant {0}", var->handle_name()));
+    }
+    auto width = var->width();
+    const Var *root = var;
+    uint32_t var_low = 0;
+    if (var->type() == VarType::Slice) {
+        root = var->get_var_root_parent();
+        if (root->type() == VarType::ConstValue || root->type() == VarType::Parameter) {
+            throw UserException(::format("Cannot set value for constant {0}", var->handle_name()));
+        }
+        auto range = get_slice_range(var);
+        if (!range) throw InternalException("Empty slice");
+        var_low = range->second;
+    }
+    auto words = value;
+    words.resize(num_words(width), 0);
+    bv_truncate(words.data(), width);
+    auto const &entry = values_.entry(root);
+    std::unordered_set<uint32_t> changed_bits;
+    if (values_.valid(entry)) {
+        auto old = values_.read_words(entry.offset + var_low, width);
+        for (uint32_t i = 0; i < words.size(); i++) {
+            uint64_t m = old[i] ^ words[i];
+            for (uint32_t bit = 0; m && bit < 64; bit++) {
+                if ((m >> bit) & 1u) changed_bits.emplace(var_low + i * 64 + bit);
+            }
+        }
+        if (!changed_bits.empty()) values_.write_words(entry.offset + var_low, width, words);
+    } else {
+        values_.set_valid(entry);
+        values_.write_words(entry.offset + var_low, width, words);
+        for (uint32_t i = 0; i < width; i++) changed_bits.emplace(var_low + i);
+    }
+    trigger_event(root, changed_bits);
+}
+
+std::optional<std::vector<uint64_t>> Simulator::eval_wide_expr_(const Expr *expr) const {
+    auto width = expr->width();
+    if (expr->op == ExprOp::Concat) {
+        auto var_concat = reinterpret_cast<const VarConcat *>(expr);
+        std::vector<uint64_t> result(num_words(width), 0);
+        // the first var is the most significant one
+        uint32_t low = width;
+        for (auto const *var : var_concat->vars()) {
+            auto value = get_words_(var);
+            if (!value) return std::nullopt;
+            low -= var->width();
+            value->resize(num_words(var->width()), 0);
+            bv_copy(result.data(), low, value->data(), 0, var->width());
+        }
+        return result;
+    } else if (expr->op == ExprOp::Extend) {
+        auto base_var = reinterpret_cast<const VarExtend *>(expr)->parent_var();
+        auto value = get_words_(base_var);
+        if (!value) return std::nullopt;
+        value->resize(num_words(base_var->width()), 0);
+        std::vector<uint64_t> result(num_words(width));
+        bv_extend(result.data(), value->data(), base_var->width(), width, expr->is_signed());
+        return result;
+    } else if (is_ternary_op(expr->op)) {
+        auto const *cond = reinterpret_cast<const ConditionalExpr *>(expr);
+        auto predicate = get_value_(cond->condition);
+        if (!predicate) return get_words_(expr->right);
+        return get_words_(*predicate ? expr->left : expr->right);
+    }
+    auto left = get_words_(expr->left);
+    if (!left) return std::nullopt;
+    if (is_unary_op(expr->op) || !expr->right) {
+        // unary minus is created with a null right operand
+        auto op = expr->op == ExprOp::Minus ? ExprOp::UMinus : expr->op;
+        return eval_unary_op(*left, op, expr->left->width());
+    }
+    auto right = get_words_(expr->right);
+    if (!right) return std::nullopt;
+    bool is_shift = expr->op == ExprOp::ShiftLeft || expr->op == ExprOp::LogicalShiftRight ||
+                    expr->op == ExprOp::SignedShiftRight;
+    auto operand_width =
+        is_shift ? expr->left->width() : std::max(expr->left->width(), expr->right->width());
+    return eval_bin_op(*left, *right, expr->op, operand_width, expr->is_signed());
+}
+
+std::optional<std::pair<uint32_t, uint32_t>> Simulator::get_slice_range(const Var *var) const {
+    auto it = slice_ranges_.find(var);
+    if (it != slice_ranges_.end()) return it->second;
+    // only slices with static index can be resolved ahead of time
+    bool is_static = var->type() == VarType::Slice;
+    for (auto const *v = var; v->type() == VarType::Slice;
+         v = reinterpret_cast<const VarSlice *>(v)->parent_var) {
+        if (reinterpret_cast<const VarSlice *>(v)->sliced_by_var()) {
+            is_static = false;
+            break;
+        }
+    }
+    if (is_static) {
+        // static slices already know their position within the root
+        auto range = std::make_pair(var->var_high(), var->var_low());
+        slice_ranges_.emplace(var, range);
+        return range;
+    }
+    auto index = get_slice_index(var);
+    if (index.empty()) return std::nullopt;
+    auto root = var->get_var_root_parent();
+    return compute_var_high_low(root, index);
+}
+
 std::vector<std::pair<uint32_t, uint32_t>> Simulator::get_slice_index(const Var *var) const {
     if (var->type() != VarType::Slice) {
         return {};
@@ -724,7 +888,8 @@ uint64_t Simulator::static_evaluate_expr(Var *expr) {
     auto result = sim.eval_expr(expr);
     // sanity check, no coverage
     // LCOV_EXCL_START
-    if (!result || (*result).size() != 1)
+    if (!result || (*result).empty() ||
+        !bv_is_zero(result->data() + 1, static_cast<uint32_t>(result->size() - 1)))
         throw UserException(::format("Unable to static elaborate value {0}", expr->to_string()));
     auto value = static_cast<int64_t>((*result)[0]);
     if (value <= 0)
@@ -762,6 +927,10 @@ void Simulator::init_pull_up_value(Generator *generator) {
 std::optional<std::vector<uint64_t>> Simulator::eval_expr(const kratos::Var *var) const {
     if (var->type() == VarType::Expression) {
         auto expr = reinterpret_cast<const Expr *>(var);
+        // values wider than 64 bits are evaluated with the multi-word kernels
+        if (expr->width() > 64 || expr->left->width() > 64 ||
+            (expr->right && expr->right->width() > 64))
+            return eval_wide_expr_(expr);
         // there are couple special ones
         if (expr->op == ExprOp::Concat) {
             auto var_concat = reinterpret_cast<const VarConcat *>(expr);
@@ -813,7 +982,7 @@ std::optional<std::vector<uint64_t>> Simulator::eval_expr(const kratos::Var *var
                 auto result = eval_ternary_op(c, (*left_val)[0], (*right_val)[0], expr->width());
                 return std::vector<uint64_t>{result};
             }
-            else if (!is_unary_op(expr->op)) {
+            else if (!is_unary_op(expr->op) && expr->right) {
                 if (!right_val) return std::nullopt;
                 if ((*left_val).size() > 1) throw std::runtime_error("Not implemented");
                 if ((*right_val).size() > 1) throw std::runtime_error("Not implemented");
@@ -824,7 +993,9 @@ std::optional<std::vector<uint64_t>> Simulator::eval_expr(const kratos::Var *var
                 return std::vector<uint64_t>{result};
             } else {
                 auto left_value = (*left_val)[0];
-                auto result = eval_unary_op(left_value, expr->op, expr->width());
+                // unary minus is created with a null right operand
+                auto op = expr->op == ExprOp::Minus ? ExprOp::UMinus : expr->op;
+                auto result = eval_unary_op(left_value, op, expr->width());
                 return std::vector<uint64_t>{result};
             }
         }
@@ -834,4 +1005,1520 @@ std::optional<std::vector<uint64_t>> Simulator::eval_expr(const kratos::Var *var
     }
 }
 
+SimProgram::SimProgram(Generator *generator) {
+    if (!generator) return;
+    fix_assignment_type(generator);
+    GeneratorGraph graph(generator);
+    // every generator starts as its own partition
+    std::unordered_map<Generator *, uint32_t> partitions;
+    for (auto const &level : graph.get_leveled_generators()) {
+        for (auto *gen : level) partitions.emplace(gen, static_cast<uint32_t>(partitions.size()));
+    }
+    auto generators = graph.get_sorted_generators();
+    for (auto *gen : generators) {
+        auto partition = partitions.at(gen);
+        uint64_t stmt_count = gen->stmts_count();
+        for (uint64_t i = 0; i < stmt_count; i++) {
+            auto stmt = gen->get_stmt(i);
+            if (stmt->type() == StatementType::Assign) {
+                add_process(stmt.get(), false, partition);
+            } else if (stmt->type() == StatementType::Block) {
+                auto block = stmt->as<StmtBlock>();
+                auto block_type = block->block_type();
+                if (block_type == StatementBlockType::Combinational ||
+                    block_type == StatementBlockType::Latch) {
+                    add_process(block.get(), false, partition);
+                } else if (block_type == StatementBlockType::Sequential) {
+                    add_process(block.get(), true, partition);
+                }
+            } else if (stmt->type() == StatementType::ModuleInstantiation) {
+                auto inst = stmt->as<ModuleInstantiationStmt>();
+                // the connection is stored as an unordered set. sort them so that the process
+                // order is deterministic
+                auto const &conn = inst->connection_stmt();
+                std::vector<AssignStmt *> assigns(conn.begin(), conn.end());
+                std::sort(assigns.begin(), assigns.end(), [](AssignStmt *a, AssignStmt *b) {
+                    return a->left()->to_string() < b->left()->to_string();
+                });
+                for (auto *assign : assigns) add_process(assign, false, partition);
+            }
+        }
+    }
+    this->partition();
+    levelize();
+}
+
+uint32_t SimProgram::root_id(const Var *var) {
+    var = var->get_var_root_parent();
+    if (root_ids_.find(var) != root_ids_.end()) return root_ids_.at(var);
+    auto id = static_cast<uint32_t>(roots_.size());
+    SimRoot root{var, static_cast<uint32_t>(slot_root_.size()), 1, var->width()};
+    if (var->width() > 64) {
+        // store one array element per slot
+        if (var->var_width() > 64 || var->var_width() == 0)
+            throw UnsupportedSimulationException(
+                ::format("{0} is wider than 64 bits, which is not supported by the compiled "
+                         "simulator",
+                         var->to_string()));
+        root.slot_width = var->var_width();
+        root.num_slots = var->width() / var->var_width();
+    }
+    for (uint32_t i = 0; i < root.num_slots; i++) slot_root_.emplace_back(id);
+    roots_.emplace_back(root);
+    readers_.emplace_back();
+    root_ids_.emplace(var, id);
+    return id;
+}
+
+uint32_t SimProgram::temp_slot() {
+    auto slot = static_cast<uint32_t>(slot_root_.size());
+    slot_root_.emplace_back(SIM_NO_SLOT);
+    return slot;
+}
+
+uint32_t SimProgram::const_slot(uint64_t value, uint32_t width) {
+    value &= sim_mask(width);
+    auto key = std::make_pair(value, width);
+    if (const_slots_.find(key) != const_slots_.end()) return const_slots_.at(key);
+    auto slot = temp_slot();
+    const_slots_.emplace(key, slot);
+    constants_.emplace_back(slot, value);
+    return slot;
+}
+
+SimLocation SimProgram::location(const Var *var, std::vector<SimInstruction> &tape,
+                                 std::vector<uint32_t> &reads) {
+    if (var->type() == VarType::BaseCasted) {
+        auto const *casted = reinterpret_cast<const VarCasted *>(var);
+        return location(const_cast<VarCasted *>(casted)->parent_var(), tape, reads);
+    }
+    if (var->type() != VarType::Base && var->type() != VarType::PortIO &&
+        var->type() != VarType::Slice) {
+        throw UnsupportedSimulationException(
+            ::format("Unable to compute location for {0}", var->to_string()));
+    }
+    SimLocation loc;
+    loc.root = root_id(var);
+    auto const &root = roots_[loc.root];
+    loc.slot = root.base;
+    loc.width = var->width();
+    uint32_t offset = 0;
+    if (var->type() == VarType::Slice) {
+        auto const *slice = reinterpret_cast<const VarSlice *>(var);
+        auto const *parent = slice->parent_var;
+        auto parent_loc = location(parent, tape, reads);
+        if (slice->sliced_by_var()) {
+            auto const *var_slice = reinterpret_cast<const VarVarSlice *>(slice);
+            auto index = lower_expr(var_slice->sliced_var(), tape, reads);
+            uint32_t stride, bound;
+            if (parent->size().size() == 1 && parent->size().front() == 1 &&
+                !parent->explicit_array()) {
+                stride = 1;
+                bound = parent->width();
+            } else {
+                bound = parent->size().front();
+                stride = parent->width() / bound;
+            }
+            SimInstruction inst{SimOpCode::Index};
+            inst.dst = temp_slot();
+            inst.a = index;
+            inst.count = stride;
+            inst.width = bound;
+            if (parent_loc.offset_slot != SIM_NO_SLOT) {
+                inst.b = parent_loc.offset_slot;
+            } else {
+                inst.param = (parent_loc.slot - root.base) * root.slot_width + parent_loc.low;
+            }
+            tape.emplace_back(inst);
+            loc.offset_slot = inst.dst;
+            return loc;
+        }
+        // the slice's var_low is absolute to the root, while the parent's may not be
+        auto relative = slice->var_low() - parent->var_low();
+        if (parent_loc.offset_slot != SIM_NO_SLOT) {
+            SimInstruction inst{SimOpCode::Index};
+            inst.dst = temp_slot();
+            inst.a = const_slot(0, 1);
+            inst.b = parent_loc.offset_slot;
+            inst.param = relative;
+            tape.emplace_back(inst);
+            loc.offset_slot = inst.dst;
+            return loc;
+        }
+        offset = (parent_loc.slot - root.base) * root.slot_width + parent_loc.low + relative;
+    }
+    if (root.num_slots == 1) {
+        loc.low = offset;
+    } else {
+        auto elem = offset / root.slot_width;
+        auto low = offset % root.slot_width;
+        loc.slot = root.base + elem;
+        if (low == 0 && loc.width % root.slot_width == 0) {
+            loc.count = loc.width / root.slot_width;
+            loc.width = root.slot_width;
+        } else if (low + loc.width <= root.slot_width) {
+            loc.low = low;
+        } else {
+            throw UnsupportedSimulationException(
+                ::format("{0} spans multiple array elements, which is not supported by the "
+                         "compiled simulator",
+                         var->to_string()));
+        }
+    }
+    return loc;
+}
+
+uint32_t SimProgram::read_location(const SimLocation &loc, std::vector<SimInstruction> &tape) {
+    auto const &root = roots_[loc.root];
+    if (loc.count > 1) {
+        throw UnsupportedSimulationException(
+            ::format("Unable to use array {0} in an expression", root.var->to_string()));
+    }
+    if (loc.offset_slot != SIM_NO_SLOT) {
+        SimInstruction inst{SimOpCode::DynSlice};
+        inst.dst = temp_slot();
+        inst.a = root.base;
+        inst.b = loc.offset_slot;
+        inst.width = loc.width;
+        inst.param = root.slot_width;
+        inst.count = root.num_slots;
+        tape.emplace_back(inst);
+        return inst.dst;
+    }
+    if (loc.low == 0 && loc.width == root.slot_width) return loc.slot;
+    SimInstruction inst{SimOpCode::Slice};
+    inst.dst = temp_slot();
+    inst.a = loc.slot;
+    inst.param = loc.low;
+    inst.width = loc.width;
+    tape.emplace_back(inst);
+    return inst.dst;
+}
+
+uint32_t SimProgram::lower_expr(const Var *var, std::vector<SimInstruction> &tape,
+                                std::vector<uint32_t> &reads) {
+    switch (var->type()) {
+        case VarType::ConstValue:
+        case VarType::Parameter: {
+            auto const *c = reinterpret_cast<const Const *>(var);
+            return const_slot(static_cast<uint64_t>(c->value()), var->width());
+        }
+        case VarType::BaseCasted: {
+            auto const *casted = reinterpret_cast<const VarCasted *>(var);
+            auto *parent = const_cast<VarCasted *>(casted)->parent_var();
+            auto slot = lower_expr(parent, tape, reads);
+            if (parent->width() == var->width()) return slot;
+            SimInstruction inst{SimOpCode::Extend};
+            inst.dst = temp_slot();
+            inst.a = slot;
+            inst.param = std::min(parent->width(), var->width());
+            inst.width = var->width();
+            inst.is_signed = parent->is_signed();
+            tape.emplace_back(inst);
+            return inst.dst;
+        }
+        case VarType::Expression: {
+            auto const *expr = reinterpret_cast<const Expr *>(var);
+            if (expr->width() > 64) {
+                throw UnsupportedSimulationException(
+                    ::format("{0} is wider than 64 bits, which is not supported by the compiled "
+                             "simulator",
+                             expr->to_string()));
+            }
+            SimInstruction inst{SimOpCode::Binary};
+            inst.op = expr->op;
+            inst.width = expr->width();
+            inst.is_signed = expr->is_signed();
+            if (expr->op == ExprOp::Concat) {
+                auto const *concat = reinterpret_cast<const VarConcat *>(expr);
+                auto const &vars = concat->vars();
+                auto slot = lower_expr(vars[0], tape, reads);
+                uint32_t width = vars[0]->width();
+                for (uint64_t i = 1; i < vars.size(); i++) {
+                    SimInstruction c{SimOpCode::Concat};
+                    c.a = slot;
+                    c.b = lower_expr(vars[i], tape, reads);
+                    c.param = vars[i]->width();
+                    width += vars[i]->width();
+                    c.width = width;
+                    c.dst = temp_slot();
+                    tape.emplace_back(c);
+                    slot = c.dst;
+                }
+                return slot;
+            } else if (expr->op == ExprOp::Extend) {
+                auto const *extend = reinterpret_cast<const VarExtend *>(expr);
+                inst.code = SimOpCode::Extend;
+                inst.a = lower_expr(extend->parent_var(), tape, reads);
+                inst.param = extend->parent_var()->width();
+            } else if (expr->op == ExprOp::Conditional) {
+                auto const *cond = reinterpret_cast<const ConditionalExpr *>(expr);
+                inst.code = SimOpCode::Ternary;
+                inst.a = lower_expr(cond->condition, tape, reads);
+                inst.b = lower_expr(expr->left, tape, reads);
+                inst.c = lower_expr(expr->right, tape, reads);
+            } else if (is_unary_op(expr->op) || is_reduction_op(expr->op) || !expr->right) {
+                inst.code = SimOpCode::Unary;
+                // unary minus is created with a null right operand
+                if (expr->op == ExprOp::Minus) inst.op = ExprOp::UMinus;
+                inst.a = lower_expr(expr->left, tape, reads);
+                inst.param = expr->left->width();
+            } else {
+                inst.a = lower_expr(expr->left, tape, reads);
+                inst.b = lower_expr(expr->right, tape, reads);
+                inst.param = expr->left->width();
+            }
+            inst.dst = temp_slot();
+            tape.emplace_back(inst);
+            return inst.dst;
+        }
+        case VarType::Base:
+        case VarType::PortIO:
+        case VarType::Slice: {
+            if (var->is_function()) {
+                auto const *call = reinterpret_cast<const FunctionCallVar *>(var);
+                auto *def = call->func();
+                if (def->is_builtin() && def->function_name() == "clog2") {
+                    SimInstruction inst{SimOpCode::Clog2};
+                    inst.a = lower_expr(call->args().begin()->second.get(), tape, reads);
+                    inst.width = var->width();
+                    inst.dst = temp_slot();
+                    tape.emplace_back(inst);
+                    return inst.dst;
+                }
+                throw UnsupportedSimulationException(
+                    ::format("Function call {0} is not supported by the compiled simulator",
+                             var->to_string()));
+            }
+            auto loc = location(var, tape, reads);
+            reads.emplace_back(loc.root);
+            return read_location(loc, tape);
+        }
+        default: {
+            throw UnsupportedSimulationException(
+                ::format("{0} is not supported by the compiled simulator", var->to_string()));
+        }
+    }
+}
+
+void SimProgram::lower_assign(AssignStmt *stmt, uint32_t predicate, bool nba,
+                              SimProcess &process) {
+    auto &tape = process.tape;
+    auto loc = location(stmt->left(), tape, process.reads);
+    process.writes.emplace_back(loc.root);
+    auto const &root = roots_[loc.root];
+    SimInstruction inst{SimOpCode::Store};
+    inst.c = predicate;
+    inst.nba = nba;
+    if (loc.count > 1) {
+        // array copy
+        auto right_loc = location(stmt->right(), tape, process.reads);
+        process.reads.emplace_back(right_loc.root);
+        if (right_loc.count != loc.count || right_loc.offset_slot != SIM_NO_SLOT) {
+            throw UnsupportedSimulationException(
+                ::format("Unable to assign {0} to {1} in the compiled simulator",
+                         stmt->right()->to_string(), stmt->left()->to_string()));
+        }
+        inst.code = SimOpCode::Copy;
+        inst.dst = loc.slot;
+        inst.a = right_loc.slot;
+        inst.count = loc.count;
+    } else if (loc.offset_slot != SIM_NO_SLOT) {
+        inst.code = SimOpCode::DynStore;
+        inst.a = lower_expr(stmt->right(), tape, process.reads);
+        inst.dst = root.base;
+        inst.b = loc.offset_slot;
+        inst.width = loc.width;
+        inst.param = root.slot_width;
+        inst.count = root.num_slots;
+    } else {
+        inst.a = lower_expr(stmt->right(), tape, process.reads);
+        inst.dst = loc.slot;
+        inst.param = loc.low;
+        inst.width = loc.width;
+    }
+    tape.emplace_back(inst);
+}
+
+void SimProgram::lower_stmt(Stmt *stmt, uint32_t predicate, bool nba, SimProcess &process) {
+    auto &tape = process.tape;
+    switch (stmt->type()) {
+        case StatementType::Assign: {
+            auto *assign = reinterpret_cast<AssignStmt *>(stmt);
+            lower_assign(assign, predicate,
+                         nba && assign->assign_type() == AssignmentType::NonBlocking, process);
+            break;
+        }
+        case StatementType::Block: {
+            auto *block = reinterpret_cast<StmtBlock *>(stmt);
+            for (auto const &s : *block) lower_stmt(s.get(), predicate, nba, process);
+            break;
+        }
+        case StatementType::If: {
+            auto *if_ = reinterpret_cast<IfStmt *>(stmt);
+            auto cond = lower_expr(if_->predicate().get(), tape, process.reads);
+            SimInstruction then_{SimOpCode::PredTrue};
+            then_.dst = temp_slot();
+            then_.a = predicate;
+            then_.b = cond;
+            tape.emplace_back(then_);
+            SimInstruction else_{SimOpCode::PredFalse};
+            else_.dst = temp_slot();
+            else_.a = predicate;
+            else_.b = cond;
+            tape.emplace_back(else_);
+            lower_stmt(if_->then_body().get(), then_.dst, nba, process);
+            lower_stmt(if_->else_body().get(), else_.dst, nba, process);
+            break;
+        }
+        case StatementType::Switch: {
+            auto *switch_ = reinterpret_cast<SwitchStmt *>(stmt);
+            auto const *target = switch_->target().get();
+            auto value = lower_expr(target, tape, process.reads);
+            auto matched = const_slot(0, 1);
+            std::vector<std::pair<uint32_t, Stmt *>> cases;
+            Stmt *default_ = nullptr;
+            for (auto const &[cond, body] : switch_->body()) {
+                if (!cond) {
+                    default_ = body.get();
+                    continue;
+                }
+                SimInstruction eq{SimOpCode::PredEq};
+                eq.dst = temp_slot();
+                eq.a = predicate;
+                eq.b = value;
+                eq.c = const_slot(static_cast<uint64_t>(cond->value()), target->width());
+                tape.emplace_back(eq);
+                SimInstruction or_{SimOpCode::PredOr};
+                or_.dst = temp_slot();
+                or_.a = matched;
+                or_.b = eq.dst;
+                tape.emplace_back(or_);
+                matched = or_.dst;
+                cases.emplace_back(eq.dst, body.get());
+            }
+            for (auto const &[pred, body] : cases) lower_stmt(body, pred, nba, process);
+            if (default_) {
+                SimInstruction inst{SimOpCode::PredAndNot};
+                inst.dst = temp_slot();
+                inst.a = predicate;
+                inst.b = matched;
+                inst.c = value;
+                tape.emplace_back(inst);
+                lower_stmt(default_, inst.dst, nba, process);
+            }
+            break;
+        }
+        case StatementType::Comment:
+        case StatementType::RawString:
+        case StatementType::Assert: {
+            // no simulation semantics
+            break;
+        }
+        default: {
+            throw UnsupportedSimulationException(
+                "Statement type not supported by the compiled simulator");
+        }
+    }
+}
+
+void SimProgram::add_process(Stmt *stmt, bool sequential, uint32_t partition) {
+    SimProcess process;
+    process.stmt = stmt;
+    process.sequential = sequential;
+    process.partition = partition;
+    lower_stmt(stmt, SIM_NO_SLOT, sequential, process);
+    if (sequential) {
+        for (auto const &inst : process.tape) {
+            if ((inst.code == SimOpCode::Store || inst.code == SimOpCode::DynStore ||
+                 inst.code == SimOpCode::Copy) &&
+                !inst.nba)
+                process.blocking = true;
+        }
+    }
+    for (auto *vec : {&process.reads, &process.writes}) {
+        std::sort(vec->begin(), vec->end());
+        vec->erase(std::unique(vec->begin(), vec->end()), vec->end());
+    }
+    auto id = static_cast<uint32_t>(processes_.size());
+    if (sequential) {
+        auto *block = reinterpret_cast<SequentialStmtBlock *>(stmt);
+        for (auto const &[edge, var] : block->get_conditions()) {
+            std::vector<SimInstruction> tape;
+            std::vector<uint32_t> reads;
+            auto loc = location(var.get(), tape, reads);
+            if (!tape.empty() || loc.count > 1)
+                throw UnsupportedSimulationException(
+                    ::format("Unable to use {0} as an edge trigger", var->to_string()));
+            triggers_[loc.slot].emplace_back(Trigger{id, edge, loc.low});
+        }
+    }
+    processes_.emplace_back(std::move(process));
+}
+
+void SimProgram::levelize() {
+    auto const num_processes = static_cast<uint32_t>(processes_.size());
+    for (uint32_t i = 0; i < num_processes; i++) {
+        auto const &process = processes_[i];
+        if (process.sequential) continue;
+        for (auto root : process.reads) readers_[root].emplace_back(i);
+    }
+    // edges from writers to readers
+    std::vector<std::vector<uint32_t>> edges(num_processes);
+    std::vector<uint32_t> in_degree(num_processes, 0);
+    for (uint32_t i = 0; i < num_processes; i++) {
+        auto const &process = processes_[i];
+        if (process.sequential) continue;
+        auto &edge = edges[i];
+        for (auto root : process.writes) {
+            for (auto reader : readers_[root]) {
+                if (reader != i) edge.emplace_back(reader);
+            }
+        }
+        std::sort(edge.begin(), edge.end());
+        edge.erase(std::unique(edge.begin(), edge.end()), edge.end());
+        for (auto reader : edge) in_degree[reader]++;
+    }
+    std::queue<uint32_t> queue;
+    for (uint32_t i = 0; i < num_processes; i++) {
+        if (!processes_[i].sequential && in_degree[i] == 0) queue.emplace(i);
+    }
+    std::vector<bool> visited(num_processes, false);
+    uint32_t max_level = 0;
+    while (!queue.empty()) {
+        auto i = queue.front();
+        queue.pop();
+        visited[i] = true;
+        comb_order_.emplace_back(i);
+        auto const &process = processes_[i];
+        max_level = std::max(max_level, process.level);
+        for (auto reader : edges[i]) {
+            auto &reader_process = processes_[reader];
+            reader_process.level = std::max(reader_process.level, process.level + 1);
+            // only nets that cross partitions start a new stage
+            auto stage = process.stage + (process.partition != reader_process.partition);
+            reader_process.stage = std::max(reader_process.stage, stage);
+            if (--in_degree[reader] == 0) queue.emplace(reader);
+        }
+    }
+    // sorting by stage and level is still a topological order, and processes of the same
+    // stage are next to each other
+    std::stable_sort(comb_order_.begin(), comb_order_.end(), [this](uint32_t a, uint32_t b) {
+        auto const &pa = processes_[a];
+        auto const &pb = processes_[b];
+        return std::tie(pa.stage, pa.level) < std::tie(pb.stage, pb.level);
+    });
+    // processes inside a loop keep their statement order and will be re-evaluated until the
+    // values converge
+    for (uint32_t i = 0; i < num_processes; i++) {
+        if (!processes_[i].sequential && !visited[i]) {
+            acyclic_ = false;
+            processes_[i].level = max_level + 1;
+            processes_[i].stage = SIM_NO_SLOT;
+            comb_order_.emplace_back(i);
+        }
+    }
+    order_index_ = std::vector<uint32_t>(num_processes, SIM_NO_SLOT);
+    for (uint32_t i = 0; i < comb_order_.size(); i++) order_index_[comb_order_[i]] = i;
+}
+
+void SimProgram::partition() {
+    // generators that drive the same variable, e.g. a parent driving its child's ports
+    // through slices, have to be merged into the same partition
+    std::vector<uint32_t> parents;
+    for (auto const &process : processes_) {
+        while (parents.size() <= process.partition) parents.emplace_back(parents.size());
+    }
+    std::function<uint32_t(uint32_t)> find = [&](uint32_t i) {
+        return parents[i] == i ? i : parents[i] = find(parents[i]);
+    };
+    std::vector<uint32_t> writers(roots_.size(), SIM_NO_SLOT);
+    for (auto const &process : processes_) {
+        for (auto root : process.writes) {
+            if (writers[root] == SIM_NO_SLOT)
+                writers[root] = process.partition;
+            else
+                parents[find(process.partition)] = find(writers[root]);
+        }
+    }
+    std::unordered_map<uint32_t, uint32_t> ids;
+    for (auto &process : processes_) {
+        auto id = find(process.partition);
+        if (ids.find(id) == ids.end()) ids.emplace(id, static_cast<uint32_t>(ids.size()));
+        process.partition = ids.at(id);
+    }
+    num_partitions_ = static_cast<uint32_t>(ids.size());
+}
+
+CompiledSimulator::CompiledSimulator(Generator *generator) : program_(generator) {
+    resize();
+    // evaluate every combinational process once to propagate the constants
+    for (auto p : program_.comb_order()) {
+        in_queue_[p] = true;
+        dirty_.emplace(program_.order_index()[p]);
+    }
+    settle();
+}
+
+CompiledSimulator::~CompiledSimulator() = default;
+
+void CompiledSimulator::set_parallel(bool value) { parallel_ = value; }
+
+void CompiledSimulator::resize() {
+    auto num_slots = program_.num_slots();
+    if (values_.size() == num_slots) return;
+    auto old_size = values_.size();
+    values_.resize(num_slots, 0);
+    valid_.resize(num_slots, false);
+    nba_values_.resize(num_slots, 0);
+    nba_pending_.resize(num_slots, false);
+    in_queue_.resize(program_.processes().size(), false);
+    for (auto const &[slot, value] : program_.constants()) {
+        if (slot < old_size) continue;
+        values_[slot] = value;
+        valid_[slot] = true;
+    }
+}
+
+void CompiledSimulator::mark_dirty(uint32_t root, uint32_t process) {
+    for (auto p : program_.readers()[root]) {
+        if (p == process || in_queue_[p]) continue;
+        in_queue_[p] = true;
+        dirty_.emplace(program_.order_index()[p]);
+    }
+}
+
+void CompiledSimulator::write_slot(uint32_t slot, uint64_t value, bool nba, SimWriteLog &log) {
+    if (nba) {
+        if (!nba_pending_[slot]) {
+            nba_pending_[slot] = true;
+            log.nba_slots.emplace_back(slot);
+        }
+        nba_values_[slot] = value;
+        return;
+    }
+    auto old = values_[slot];
+    bool was_valid = valid_[slot];
+    if (was_valid && old == value) return;
+    values_[slot] = value;
+    valid_[slot] = true;
+    log.roots.emplace_back(program_.slot_root()[slot]);
+    auto const &triggers = program_.triggers();
+    if (triggers.empty()) return;
+    auto it = triggers.find(slot);
+    if (it == triggers.end()) return;
+    for (auto const &trigger : it->second) {
+        bool new_bit = (value >> trigger.bit) & 1u;
+        bool old_bit = (old >> trigger.bit) & 1u;
+        if (was_valid && new_bit == old_bit) continue;
+        if ((trigger.edge == BlockEdgeType::Posedge) == new_bit)
+            log.triggered.emplace_back(trigger.process);
+    }
+}
+
+void CompiledSimulator::apply(SimWriteLog &log) {
+    for (auto root : log.roots) mark_dirty(root, log.process);
+    triggered_.insert(triggered_.end(), log.triggered.begin(), log.triggered.end());
+    nba_slots_.insert(nba_slots_.end(), log.nba_slots.begin(), log.nba_slots.end());
+    log.roots.clear();
+    log.triggered.clear();
+    log.nba_slots.clear();
+}
+
+void CompiledSimulator::run(const std::vector<SimInstruction> &tape, SimWriteLog &log) {
+    auto *values = values_.data();
+    auto *valid = valid_.data();
+    for (auto const &inst : tape) {
+        switch (inst.code) {
+            case SimOpCode::Unary: {
+                valid[inst.dst] = valid[inst.a];
+                values[inst.dst] =
+                    eval_unary_op(values[inst.a], inst.op, inst.param) & sim_mask(inst.width);
+                break;
+            }
+            case SimOpCode::Binary: {
+                auto left = values[inst.a];
+                auto right = values[inst.b];
+                bool is_valid = valid[inst.a] && valid[inst.b];
+                if ((inst.op == ExprOp::Divide || inst.op == ExprOp::Mod) &&
+                    (right & sim_mask(inst.param)) == 0)
+                    is_valid = false;
+                valid[inst.dst] = is_valid;
+                if (is_valid)
+                    values[inst.dst] =
+                        eval_bin_op(left, right, inst.op, inst.param, inst.is_signed) &
+                        sim_mask(inst.width);
+                break;
+            }
+            case SimOpCode::Ternary: {
+                auto branch = values[inst.a] ? inst.b : inst.c;
+                valid[inst.dst] = valid[inst.a] && valid[branch];
+                values[inst.dst] = values[branch] & sim_mask(inst.width);
+                break;
+            }
+            case SimOpCode::Slice: {
+                valid[inst.dst] = valid[inst.a];
+                values[inst.dst] = (values[inst.a] >> inst.param) & sim_mask(inst.width);
+                break;
+            }
+            case SimOpCode::DynSlice: {
+                auto offset = values[inst.b];
+                auto elem = offset / inst.param;
+                auto low = offset % inst.param;
+                if (!valid[inst.b] || elem >= inst.count || low + inst.width > inst.param) {
+                    valid[inst.dst] = false;
+                    break;
+                }
+                auto slot = inst.a + elem;
+                valid[inst.dst] = valid[slot];
+                values[inst.dst] = (values[slot] >> low) & sim_mask(inst.width);
+                break;
+            }
+            case SimOpCode::Index: {
+                auto index = values[inst.a];
+                bool is_valid = valid[inst.a] && (inst.width == 0 || index < inst.width);
+                uint64_t offset = index * inst.count + inst.param;
+                if (inst.b != SIM_NO_SLOT) {
+                    is_valid = is_valid && valid[inst.b];
+                    offset += values[inst.b];
+                }
+                valid[inst.dst] = is_valid;
+                values[inst.dst] = offset;
+                break;
+            }
+            case SimOpCode::Concat: {
+                valid[inst.dst] = valid[inst.a] && valid[inst.b];
+                values[inst.dst] =
+                    ((values[inst.a] << inst.param) | values[inst.b]) & sim_mask(inst.width);
+                break;
+            }
+            case SimOpCode::Extend: {
+                auto v = values[inst.a] & sim_mask(inst.param);
+                if (inst.is_signed && inst.param < 64 && ((v >> (inst.param - 1)) & 1u)) {
+                    v |= ~sim_mask(inst.param);
+                }
+                valid[inst.dst] = valid[inst.a];
+                values[inst.dst] = v & sim_mask(inst.width);
+                break;
+            }
+            case SimOpCode::Clog2: {
+                valid[inst.dst] = valid[inst.a];
+                values[inst.dst] = sim_clog2(values[inst.a]) & sim_mask(inst.width);
+                break;
+            }
+            case SimOpCode::PredTrue:
+            case SimOpCode::PredFalse: {
+                bool parent = inst.a == SIM_NO_SLOT || values[inst.a];
+                // neither branch is taken if the condition is unknown
+                bool cond = values[inst.b];
+                if (inst.code == SimOpCode::PredFalse) cond = !cond;
+                valid[inst.dst] = true;
+                values[inst.dst] = parent && valid[inst.b] && cond;
+                break;
+            }
+            case SimOpCode::PredEq: {
+                bool parent = inst.a == SIM_NO_SLOT || values[inst.a];
+                valid[inst.dst] = true;
+                values[inst.dst] = parent && valid[inst.b] && values[inst.b] == values[inst.c];
+                break;
+            }
+            case SimOpCode::PredOr: {
+                valid[inst.dst] = true;
+                values[inst.dst] = values[inst.a] || values[inst.b];
+                break;
+            }
+            case SimOpCode::PredAndNot: {
+                bool parent = inst.a == SIM_NO_SLOT || values[inst.a];
+                valid[inst.dst] = true;
+                values[inst.dst] = parent && valid[inst.c] && !values[inst.b];
+                break;
+            }
+            case SimOpCode::Store:
+            case SimOpCode::DynStore: {
+                if (inst.c != SIM_NO_SLOT && !values[inst.c]) break;
+                if (!valid[inst.a]) break;
+                auto slot = inst.dst;
+                auto low = inst.param;
+                if (inst.code == SimOpCode::DynStore) {
+                    if (!valid[inst.b]) break;
+                    auto offset = values[inst.b];
+                    auto elem = offset / inst.param;
+                    low = offset % inst.param;
+                    if (elem >= inst.count || low + inst.width > inst.param) break;
+                    slot += elem;
+                }
+                uint64_t base;
+                if (inst.nba && nba_pending_[slot])
+                    base = nba_values_[slot];
+                else
+                    base = valid[slot] ? values[slot] : 0;
+                auto mask = sim_mask(inst.width) << low;
+                auto value = (base & ~mask) | ((values[inst.a] << low) & mask);
+                write_slot(slot, value, inst.nba, log);
+                break;
+            }
+            case SimOpCode::Copy: {
+                if (inst.c != SIM_NO_SLOT && !values[inst.c]) break;
+                for (uint32_t i = 0; i < inst.count; i++) {
+                    if (valid[inst.a + i])
+                        write_slot(inst.dst + i, values[inst.a + i], inst.nba, log);
+                }
+                break;
+            }
+        }
+    }
+}
+
+void CompiledSimulator::settle() {
+    if (parallel_ && program_.acyclic()) {
+        settle_parallel();
+        return;
+    }
+    auto const &processes = program_.processes();
+    auto const &order = program_.comb_order();
+    uint64_t limit = (order.size() + 1) * 1024;
+    uint64_t iterations = 0;
+    while (!dirty_.empty()) {
+        auto p = order[dirty_.top()];
+        dirty_.pop();
+        in_queue_[p] = false;
+        log_.process = p;
+        run(processes[p].tape, log_);
+        apply(log_);
+        if (++iterations > limit) throw UserException("Simulation doesn't converge");
+    }
+    log_.process = SIM_NO_SLOT;
+}
+
+void CompiledSimulator::dispatch(uint64_t num_groups, const std::function<void(uint64_t)> &fn) {
+    if (num_groups == 1) {
+        fn(0);
+        return;
+    }
+    // one task per thread, each one takes a contiguous range of groups. the tasks share the
+    // global pool with the passes, so the cores are not oversubscribed
+    uint64_t num_tasks = std::min<uint64_t>(num_groups, std::max(1u, get_num_cpus()));
+    parallel_for(num_tasks, [&fn, num_groups, num_tasks](uint64_t t) {
+        auto begin = num_groups * t / num_tasks;
+        auto end = num_groups * (t + 1) / num_tasks;
+        for (auto i = begin; i < end; i++) fn(i);
+    });
+}
+
+void CompiledSimulator::settle_parallel() {
+    auto const &processes = program_.processes();
+    auto const &order = program_.comb_order();
+    auto const &order_index = program_.order_index();
+    auto const &readers = program_.readers();
+    // without loops every process runs at most once
+    while (!dirty_.empty()) {
+        // processes in the same stage only depend on processes from the same partition
+        auto stage = processes[order[dirty_.top()]].stage;
+        std::map<uint32_t, std::vector<uint32_t>> partitions;
+        while (!dirty_.empty() && processes[order[dirty_.top()]].stage == stage) {
+            partitions[processes[order[dirty_.top()]].partition].emplace_back(dirty_.top());
+            dirty_.pop();
+        }
+        std::vector<std::vector<uint32_t>> groups;
+        groups.reserve(partitions.size());
+        for (auto &iter : partitions) groups.emplace_back(std::move(iter.second));
+        std::vector<SimWriteLog> logs(groups.size());
+        dispatch(groups.size(), [&](uint64_t index) {
+            auto &log = logs[index];
+            std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<>> queue(
+                std::greater<>(), groups[index]);
+            while (!queue.empty()) {
+                auto p = order[queue.top()];
+                queue.pop();
+                in_queue_[p] = false;
+                auto start = log.roots.size();
+                run(processes[p].tape, log);
+                for (auto i = start; i < log.roots.size(); i++) {
+                    for (auto reader : readers[log.roots[i]]) {
+                        if (reader == p || processes[reader].stage != stage || in_queue_[reader])
+                            continue;
+                        in_queue_[reader] = true;
+                        queue.emplace(order_index[reader]);
+                    }
+                }
+            }
+        });
+        // cross-partition nets are only propagated at the end of each stage
+        for (auto &log : logs) {
+            for (auto root : log.roots) {
+                for (auto reader : readers[root]) {
+                    if (in_queue_[reader] || processes[reader].stage == stage) continue;
+                    in_queue_[reader] = true;
+                    dirty_.emplace(order_index[reader]);
+                }
+            }
+            log.roots.clear();
+            apply(log);
+        }
+    }
+}
+
+void CompiledSimulator::run_parallel(const std::vector<uint32_t> &processes) {
+    auto const &program_processes = program_.processes();
+    std::vector<SimWriteLog> logs(processes.size());
+    std::map<uint32_t, std::vector<uint32_t>> partitions;
+    for (uint32_t i = 0; i < processes.size(); i++) {
+        logs[i].process = processes[i];
+        partitions[program_processes[processes[i]].partition].emplace_back(i);
+    }
+    std::vector<const std::vector<uint32_t> *> groups;
+    groups.reserve(partitions.size());
+    for (auto const &iter : partitions) groups.emplace_back(&iter.second);
+    dispatch(groups.size(), [&](uint64_t index) {
+        for (auto i : *groups[index]) run(program_processes[processes[i]].tape, logs[i]);
+    });
+    // apply the side effects in process order so the result is deterministic
+    for (auto &log : logs) apply(log);
+}
+
+void CompiledSimulator::commit_nba() {
+    auto slots = std::move(nba_slots_);
+    nba_slots_.clear();
+    for (auto slot : slots) {
+        nba_pending_[slot] = false;
+        write_slot(slot, nba_values_[slot], false, log_);
+    }
+    apply(log_);
+}
+
+void CompiledSimulator::eval() {
+    resize();
+    settle();
+    auto const &processes = program_.processes();
+    uint64_t depth = 0;
+    while (!triggered_.empty()) {
+        auto triggered = std::move(triggered_);
+        triggered_.clear();
+        std::sort(triggered.begin(), triggered.end());
+        triggered.erase(std::unique(triggered.begin(), triggered.end()), triggered.end());
+        // blocking assignments in sequential blocks are visible to other blocks right away
+        bool blocking = std::any_of(triggered.begin(), triggered.end(),
+                                    [&](uint32_t p) { return processes[p].blocking; });
+        if (parallel_ && !blocking) {
+            run_parallel(triggered);
+        } else {
+            for (auto p : triggered) {
+                log_.process = p;
+                run(processes[p].tape, log_);
+                apply(log_);
+            }
+            log_.process = SIM_NO_SLOT;
+        }
+        commit_nba();
+        settle();
+        if (++depth > MAX_SIMULATION_DEPTH) throw UserException("Simulation doesn't converge");
+    }
+}
+
+SimLocation CompiledSimulator::probe_location(Var *var) {
+    std::vector<SimInstruction> tape;
+    std::vector<uint32_t> reads;
+    auto loc = program_.location(var, tape, reads);
+    resize();
+    // dynamic slicing needs the index computed first
+    if (!tape.empty()) run(tape, log_);
+    return loc;
+}
+
+std::optional<uint64_t> CompiledSimulator::read(const SimLocation &loc) {
+    auto slot = loc.slot;
+    auto low = loc.low;
+    if (loc.offset_slot != SIM_NO_SLOT) {
+        if (!valid_[loc.offset_slot]) return std::nullopt;
+        auto const &root = program_.roots()[loc.root];
+        auto offset = values_[loc.offset_slot];
+        if (offset / root.slot_width >= root.num_slots) return std::nullopt;
+        slot = root.base + offset / root.slot_width;
+        low = offset % root.slot_width;
+    }
+    if (!valid_[slot]) return std::nullopt;
+    return (values_[slot] >> low) & sim_mask(loc.width);
+}
+
+std::optional<uint64_t> CompiledSimulator::get(Var *var) {
+    if (!var) return std::nullopt;
+    // only scalar
+    if (var->size().size() != 1 || var->size().front() > 1) return std::nullopt;
+    if (var->type() == VarType::Base || var->type() == VarType::PortIO) {
+        return read(probe_location(var));
+    }
+    if (probes_.find(var) == probes_.end()) {
+        std::vector<SimInstruction> tape;
+        std::vector<uint32_t> reads;
+        auto slot = program_.lower_expr(var, tape, reads);
+        probes_.emplace(var, std::make_pair(std::move(tape), slot));
+    }
+    resize();
+    auto const &[tape, slot] = probes_.at(var);
+    run(tape, log_);
+    if (!valid_[slot]) return std::nullopt;
+    return values_[slot];
+}
+
+std::optional<std::vector<uint64_t>> CompiledSimulator::get_array(Var *var) {
+    if (!var) return std::nullopt;
+    auto loc = probe_location(var);
+    std::vector<uint64_t> result;
+    if (loc.count > 1) {
+        result.reserve(loc.count);
+        for (uint32_t i = 0; i < loc.count; i++) {
+            if (!valid_[loc.slot + i]) return std::nullopt;
+            result.emplace_back(values_[loc.slot + i]);
+        }
+        return result;
+    }
+    auto value = read(loc);
+    if (!value) return std::nullopt;
+    auto elem_width = var->var_width();
+    auto num_elem = var->width() / elem_width;
+    result.reserve(num_elem);
+    for (uint32_t i = 0; i < num_elem; i++) {
+        result.emplace_back(((*value) >> (i * elem_width)) & sim_mask(elem_width));
+    }
+    return result;
+}
+
+void CompiledSimulator::set(Var *var, std::optional<uint64_t> value, bool eval_) {
+    if (!value) return;
+    if (var->type() == VarType::Parameter || var->type() == VarType::ConstValue)
+        throw UserException(::format("Cannot set value for constant {0}", var->handle_name()));
+    auto loc = probe_location(var);
+    auto const &root = program_.roots()[loc.root];
+    auto v = *value;
+    if (loc.count > 1) {
+        // packed values are split into elements
+        for (uint32_t i = 0; i < loc.count; i++) {
+            auto elem = i * root.slot_width >= 64 ? 0 : (v >> (i * root.slot_width));
+            write_slot(loc.slot + i, elem & sim_mask(root.slot_width), false, log_);
+        }
+    } else {
+        auto slot = loc.slot;
+        auto low = loc.low;
+        if (loc.offset_slot != SIM_NO_SLOT) {
+            if (!valid_[loc.offset_slot]) throw UserException("Empty slice");
+            auto offset = values_[loc.offset_slot];
+            if (offset / root.slot_width >= root.num_slots)
+                throw UserException(::format("Index out of range for {0}", var->to_string()));
+            slot = root.base + offset / root.slot_width;
+            low = offset % root.slot_width;
+        }
+        auto mask = sim_mask(loc.width) << low;
+        auto base = valid_[slot] ? values_[slot] : 0;
+        write_slot(slot, (base & ~mask) | ((v << low) & mask), false, log_);
+    }
+    apply(log_);
+    if (eval_) eval();
+}
+
+void CompiledSimulator::set(Var *var, const std::optional<std::vector<uint64_t>> &value,
+                            bool eval_) {
+    if (!value) return;
+    auto const &values = *value;
+    if (values.size() == 1) {
+        set(var, values[0], eval_);
+        return;
+    }
+    auto loc = probe_location(var);
+    if (loc.count == values.size()) {
+        auto width = program_.roots()[loc.root].slot_width;
+        for (uint32_t i = 0; i < loc.count; i++)
+            write_slot(loc.slot + i, values[i] & sim_mask(width), false, log_);
+        apply(log_);
+        if (eval_) eval();
+        return;
+    }
+    auto elem_width = var->var_width();
+    if (loc.count != 1 || values.size() * elem_width != var->width())
+        throw UserException("Misaligned slicing");
+    uint64_t v = 0;
+    for (uint64_t i = 0; i < values.size(); i++)
+        v |= (values[i] & sim_mask(elem_width)) << (i * elem_width);
+    set(var, v, eval_);
+}
+
+void CompiledSimulator::set_i(const Var *var, std::optional<int64_t> value, bool eval_) {
+    if (!value) return;
+    set(const_cast<Var *>(var), static_cast<uint64_t>(*value) & sim_mask(var->width()), eval_);
+}
+
+void CompiledSimulator::set_i(const Var *var, const std::optional<std::vector<int64_t>> &value,
+                              bool eval_) {
+    if (!value) return;
+    std::vector<uint64_t> values;
+    values.reserve(value->size());
+    for (auto v : *value) values.emplace_back(static_cast<uint64_t>(v) & sim_mask(var->var_width()));
+    set(const_cast<Var *>(var), values, eval_);
+}
+
+// apply the same binary function to every lane. simple enough to be vectorized
+template <typename F>
+void lane_binary_op(uint64_t *dst, uint8_t *dst_valid, const uint64_t *left,
+                    const uint8_t *left_valid, const uint64_t *right, const uint8_t *right_valid,
+                    uint32_t num_lanes, uint64_t mask, F f) {
+    for (uint32_t i = 0; i < num_lanes; i++) {
+        dst[i] = f(left[i], right[i]) & mask;
+        dst_valid[i] = left_valid[i] & right_valid[i];
+    }
+}
+
+BatchSimulator::BatchSimulator(Generator *generator, uint32_t num_lanes)
+    : program_(generator), num_lanes_(num_lanes) {
+    if (num_lanes_ == 0) throw UserException("Batch simulator requires at least one lane");
+    resize();
+    for (auto p : program_.comb_order()) {
+        in_queue_[p] = true;
+        dirty_.emplace(program_.order_index()[p]);
+    }
+    settle();
+    initial_values_ = values_;
+    initial_valid_ = valid_;
+}
+
+void BatchSimulator::resize() {
+    auto size = program_.num_slots() * num_lanes_;
+    if (values_.size() == size) return;
+    auto old_slots = values_.size() / num_lanes_;
+    values_.resize(size, 0);
+    valid_.resize(size, false);
+    nba_values_.resize(size, 0);
+    nba_pending_.resize(size, false);
+    in_queue_.resize(program_.processes().size(), false);
+    trigger_lanes_.resize(program_.processes().size() * num_lanes_, false);
+    for (auto const &[slot, value] : program_.constants()) {
+        if (slot < old_slots) continue;
+        for (uint32_t lane = 0; lane < num_lanes_; lane++) {
+            values_[slot * num_lanes_ + lane] = value;
+            valid_[slot * num_lanes_ + lane] = true;
+        }
+    }
+    // keep the reset state in sync with the new slots
+    if (!initial_values_.empty()) {
+        auto old_size = initial_values_.size();
+        initial_values_.resize(size, 0);
+        initial_valid_.resize(size, false);
+        for (uint64_t i = old_size; i < size; i++) {
+            initial_values_[i] = values_[i];
+            initial_valid_[i] = valid_[i];
+        }
+    }
+}
+
+void BatchSimulator::reset() {
+    resize();
+    values_ = initial_values_;
+    valid_ = initial_valid_;
+    dirty_ = {};
+    std::fill(in_queue_.begin(), in_queue_.end(), false);
+    std::fill(trigger_lanes_.begin(), trigger_lanes_.end(), false);
+    triggered_.clear();
+    for (auto const &[slot, lane] : nba_slots_) nba_pending_[static_cast<uint64_t>(slot) * num_lanes_ + lane] = false;
+    nba_slots_.clear();
+}
+
+void BatchSimulator::mark_dirty(uint32_t root) {
+    for (auto p : program_.readers()[root]) {
+        if (p == current_process_ || in_queue_[p]) continue;
+        in_queue_[p] = true;
+        dirty_.emplace(program_.order_index()[p]);
+    }
+}
+
+void BatchSimulator::write_slot(uint32_t slot, uint32_t lane, uint64_t value, bool nba) {
+    auto index = static_cast<uint64_t>(slot) * num_lanes_ + lane;
+    if (nba) {
+        if (!nba_pending_[index]) {
+            nba_pending_[index] = true;
+            nba_slots_.emplace_back(slot, lane);
+        }
+        nba_values_[index] = value;
+        return;
+    }
+    auto old = values_[index];
+    bool was_valid = valid_[index];
+    if (was_valid && old == value) return;
+    values_[index] = value;
+    valid_[index] = true;
+    mark_dirty(program_.slot_root()[slot]);
+    auto const &triggers = program_.triggers();
+    if (triggers.empty()) return;
+    auto it = triggers.find(slot);
+    if (it == triggers.end()) return;
+    for (auto const &trigger : it->second) {
+        bool new_bit = (value >> trigger.bit) & 1u;
+        bool old_bit = (old >> trigger.bit) & 1u;
+        if (was_valid && new_bit == old_bit) continue;
+        if ((trigger.edge == BlockEdgeType::Posedge) != new_bit) continue;
+        auto &triggered = trigger_lanes_[trigger.process * num_lanes_ + lane];
+        if (!triggered) {
+            triggered = true;
+            triggered_.emplace_back(trigger.process);
+        }
+    }
+}
+
+void BatchSimulator::run(const std::vector<SimInstruction> &tape, const uint8_t *lanes) {
+    auto const n = num_lanes_;
+    auto *values = values_.data();
+    auto *valid = valid_.data();
+    // predicate of a lane. no predicate slot means the process' lane mask
+    auto predicate = [=](uint32_t slot, uint32_t lane) -> bool {
+        if (slot == SIM_NO_SLOT) return lanes ? lanes[lane] : true;
+        return values[slot * n + lane];
+    };
+    for (auto const &inst : tape) {
+        auto *dst = values + static_cast<uint64_t>(inst.dst) * n;
+        auto *dst_valid = valid + static_cast<uint64_t>(inst.dst) * n;
+        auto const *a = values + static_cast<uint64_t>(inst.a) * n;
+        auto const *a_valid = valid + static_cast<uint64_t>(inst.a) * n;
+        auto const *b = values + static_cast<uint64_t>(inst.b) * n;
+        auto const *b_valid = valid + static_cast<uint64_t>(inst.b) * n;
+        auto const mask = sim_mask(inst.width);
+        switch (inst.code) {
+            case SimOpCode::Unary: {
+                for (uint32_t i = 0; i < n; i++) {
+                    dst[i] = eval_unary_op(a[i], inst.op, inst.param) & mask;
+                    dst_valid[i] = a_valid[i];
+                }
+                break;
+            }
+            case SimOpCode::Binary: {
+                switch (inst.op) {
+                    case ExprOp::Add:
+                        lane_binary_op(dst, dst_valid, a, a_valid, b, b_valid, n, mask,
+                                       [](uint64_t x, uint64_t y) { return x + y; });
+                        break;
+                    case ExprOp::Minus:
+                        lane_binary_op(dst, dst_valid, a, a_valid, b, b_valid, n, mask,
+                                       [](uint64_t x, uint64_t y) { return x - y; });
+                        break;
+                    case ExprOp::And:
+                        lane_binary_op(dst, dst_valid, a, a_valid, b, b_valid, n, mask,
+                                       [](uint64_t x, uint64_t y) { return x & y; });
+                        break;
+                    case ExprOp::Or:
+                        lane_binary_op(dst, dst_valid, a, a_valid, b, b_valid, n, mask,
+                                       [](uint64_t x, uint64_t y) { return x | y; });
+                        break;
+                    case ExprOp::Xor:
+                        lane_binary_op(dst, dst_valid, a, a_valid, b, b_valid, n, mask,
+                                       [](uint64_t x, uint64_t y) { return x ^ y; });
+                        break;
+                    case ExprOp::Eq:
+                        lane_binary_op(
+                            dst, dst_valid, a, a_valid, b, b_valid, n, mask,
+                            [](uint64_t x, uint64_t y) { return static_cast<uint64_t>(x == y); });
+                        break;
+                    case ExprOp::Neq:
+                        lane_binary_op(
+                            dst, dst_valid, a, a_valid, b, b_valid, n, mask,
+                            [](uint64_t x, uint64_t y) { return static_cast<uint64_t>(x != y); });
+                        break;
+                    default: {
+                        bool is_div = inst.op == ExprOp::Divide || inst.op == ExprOp::Mod;
+                        auto operand_mask = sim_mask(inst.param);
+                        for (uint32_t i = 0; i < n; i++) {
+                            bool is_valid = a_valid[i] && b_valid[i];
+                            if (is_div && (b[i] & operand_mask) == 0) is_valid = false;
+                            dst_valid[i] = is_valid;
+                            if (is_valid)
+                                dst[i] = eval_bin_op(a[i], b[i], inst.op, inst.param,
+                                                     inst.is_signed) &
+                                         mask;
+                        }
+                    }
+                }
+                break;
+            }
+            case SimOpCode::Ternary: {
+                auto const *c = values + static_cast<uint64_t>(inst.c) * n;
+                auto const *c_valid = valid + static_cast<uint64_t>(inst.c) * n;
+                for (uint32_t i = 0; i < n; i++) {
+                    dst[i] = (a[i] ? b[i] : c[i]) & mask;
+                    dst_valid[i] = a_valid[i] && (a[i] ? b_valid[i] : c_valid[i]);
+                }
+                break;
+            }
+            case SimOpCode::Slice: {
+                for (uint32_t i = 0; i < n; i++) {
+                    dst[i] = (a[i] >> inst.param) & mask;
+                    dst_valid[i] = a_valid[i];
+                }
+                break;
+            }
+            case SimOpCode::DynSlice: {
+                for (uint32_t i = 0; i < n; i++) {
+                    auto offset = b[i];
+                    auto elem = offset / inst.param;
+                    auto low = offset % inst.param;
+                    if (!b_valid[i] || elem >= inst.count || low + inst.width > inst.param) {
+                        dst_valid[i] = false;
+                        continue;
+                    }
+                    auto index = (inst.a + elem) * n + i;
+                    dst[i] = (values[index] >> low) & mask;
+                    dst_valid[i] = valid[index];
+                }
+                break;
+            }
+            case SimOpCode::Index: {
+                for (uint32_t i = 0; i < n; i++) {
+                    bool is_valid = a_valid[i] && (inst.width == 0 || a[i] < inst.width);
+                    uint64_t offset = a[i] * inst.count + inst.param;
+                    if (inst.b != SIM_NO_SLOT) {
+                        is_valid = is_valid && b_valid[i];
+                        offset += b[i];
+                    }
+                    dst[i] = offset;
+                    dst_valid[i] = is_valid;
+                }
+                break;
+            }
+            case SimOpCode::Concat: {
+                for (uint32_t i = 0; i < n; i++) {
+                    dst[i] = ((a[i] << inst.param) | b[i]) & mask;
+                    dst_valid[i] = a_valid[i] & b_valid[i];
+                }
+                break;
+            }
+            case SimOpCode::Extend: {
+                auto low_mask = sim_mask(inst.param);
+                for (uint32_t i = 0; i < n; i++) {
+                    auto v = a[i] & low_mask;
+                    if (inst.is_signed && inst.param < 64 && ((v >> (inst.param - 1)) & 1u))
+                        v |= ~low_mask;
+                    dst[i] = v & mask;
+                    dst_valid[i] = a_valid[i];
+                }
+                break;
+            }
+            case SimOpCode::Clog2: {
+                for (uint32_t i = 0; i < n; i++) {
+                    dst[i] = sim_clog2(a[i]) & mask;
+                    dst_valid[i] = a_valid[i];
+                }
+                break;
+            }
+            case SimOpCode::PredTrue:
+            case SimOpCode::PredFalse: {
+                bool negate = inst.code == SimOpCode::PredFalse;
+                for (uint32_t i = 0; i < n; i++) {
+                    bool cond = (b[i] != 0) != negate;
+                    dst[i] = predicate(inst.a, i) && b_valid[i] && cond;
+                    dst_valid[i] = true;
+                }
+                break;
+            }
+            case SimOpCode::PredEq: {
+                auto const *c = values + static_cast<uint64_t>(inst.c) * n;
+                for (uint32_t i = 0; i < n; i++) {
+                    dst[i] = predicate(inst.a, i) && b_valid[i] && b[i] == c[i];
+                    dst_valid[i] = true;
+                }
+                break;
+            }
+            case SimOpCode::PredOr: {
+                for (uint32_t i = 0; i < n; i++) {
+                    dst[i] = a[i] || b[i];
+                    dst_valid[i] = true;
+                }
+                break;
+            }
+            case SimOpCode::PredAndNot: {
+                auto const *c_valid = valid + static_cast<uint64_t>(inst.c) * n;
+                for (uint32_t i = 0; i < n; i++) {
+                    dst[i] = predicate(inst.a, i) && c_valid[i] && !b[i];
+                    dst_valid[i] = true;
+                }
+                break;
+            }
+            case SimOpCode::Store:
+            case SimOpCode::DynStore: {
+                for (uint32_t i = 0; i < n; i++) {
+                    if (!predicate(inst.c, i) || !a_valid[i]) continue;
+                    auto slot = inst.dst;
+                    auto low = inst.param;
+                    if (inst.code == SimOpCode::DynStore) {
+                        if (!b_valid[i]) continue;
+                        auto elem = b[i] / inst.param;
+                        low = b[i] % inst.param;
+                        if (elem >= inst.count || low + inst.width > inst.param) continue;
+                        slot += elem;
+                    }
+                    auto index = slot * n + i;
+                    uint64_t base;
+                    if (inst.nba && nba_pending_[index])
+                        base = nba_values_[index];
+                    else
+                        base = valid[index] ? values[index] : 0;
+                    auto store_mask = mask << low;
+                    write_slot(slot, i, (base & ~store_mask) | ((a[i] << low) & store_mask),
+                               inst.nba);
+                }
+                break;
+            }
+            case SimOpCode::Copy: {
+                for (uint32_t i = 0; i < n; i++) {
+                    if (!predicate(inst.c, i)) continue;
+                    for (uint32_t j = 0; j < inst.count; j++) {
+                        auto src = (inst.a + j) * n + i;
+                        if (valid[src]) write_slot(inst.dst + j, i, values[src], inst.nba);
+                    }
+                }
+                break;
+            }
+        }
+    }
+}
+
+void BatchSimulator::settle() {
+    auto const &processes = program_.processes();
+    auto const &order = program_.comb_order();
+    uint64_t limit = (order.size() + 1) * 1024;
+    uint64_t iterations = 0;
+    while (!dirty_.empty()) {
+        auto p = order[dirty_.top()];
+        dirty_.pop();
+        in_queue_[p] = false;
+        current_process_ = p;
+        run(processes[p].tape, nullptr);
+        current_process_ = SIM_NO_SLOT;
+        if (++iterations > limit) throw UserException("Simulation doesn't converge");
+    }
+}
+
+void BatchSimulator::commit_nba() {
+    auto slots = std::move(nba_slots_);
+    nba_slots_.clear();
+    for (auto const &[slot, lane] : slots) {
+        auto index = static_cast<uint64_t>(slot) * num_lanes_ + lane;
+        nba_pending_[index] = false;
+        write_slot(slot, lane, nba_values_[index], false);
+    }
+}
+
+void BatchSimulator::eval() {
+    resize();
+    settle();
+    auto const &processes = program_.processes();
+    uint64_t depth = 0;
+    while (!triggered_.empty()) {
+        auto triggered = std::move(triggered_);
+        triggered_.clear();
+        std::sort(triggered.begin(), triggered.end());
+        triggered.erase(std::unique(triggered.begin(), triggered.end()), triggered.end());
+        for (auto p : triggered) {
+            // only the lanes that see the edge are updated
+            auto *lanes = trigger_lanes_.data() + static_cast<uint64_t>(p) * num_lanes_;
+            current_process_ = p;
+            run(processes[p].tape, lanes);
+            std::fill(lanes, lanes + num_lanes_, false);
+        }
+        current_process_ = SIM_NO_SLOT;
+        commit_nba();
+        settle();
+        if (++depth > MAX_SIMULATION_DEPTH) throw UserException("Simulation doesn't converge");
+    }
+}
+
+SimLocation BatchSimulator::probe_location(Var *var) {
+    std::vector<SimInstruction> tape;
+    std::vector<uint32_t> reads;
+    auto loc = program_.location(var, tape, reads);
+    resize();
+    if (!tape.empty()) run(tape, nullptr);
+    return loc;
+}
+
+std::optional<uint64_t> BatchSimulator::read(const SimLocation &loc, uint32_t lane) {
+    auto slot = loc.slot;
+    auto low = loc.low;
+    if (loc.offset_slot != SIM_NO_SLOT) {
+        auto index = static_cast<uint64_t>(loc.offset_slot) * num_lanes_ + lane;
+        if (!valid_[index]) return std::nullopt;
+        auto const &root = program_.roots()[loc.root];
+        auto offset = values_[index];
+        if (offset / root.slot_width >= root.num_slots) return std::nullopt;
+        slot = root.base + offset / root.slot_width;
+        low = offset % root.slot_width;
+    }
+    auto index = static_cast<uint64_t>(slot) * num_lanes_ + lane;
+    if (!valid_[index]) return std::nullopt;
+    return (values_[index] >> low) & sim_mask(loc.width);
+}
+
+std::vector<std::optional<uint64_t>> BatchSimulator::get(Var *var) {
+    std::vector<std::optional<uint64_t>> result(num_lanes_, std::nullopt);
+    if (!var) return result;
+    // only scalar
+    if (var->size().size() != 1 || var->size().front() > 1) return result;
+    if (var->type() == VarType::Base || var->type() == VarType::PortIO) {
+        auto loc = probe_location(var);
+        for (uint32_t lane = 0; lane < num_lanes_; lane++) result[lane] = read(loc, lane);
+        return result;
+    }
+    if (probes_.find(var) == probes_.end()) {
+        std::vector<SimInstruction> tape;
+        std::vector<uint32_t> reads;
+        auto slot = program_.lower_expr(var, tape, reads);
+        probes_.emplace(var, std::make_pair(std::move(tape), slot));
+    }
+    resize();
+    auto const &[tape, slot] = probes_.at(var);
+    run(tape, nullptr);
+    auto base = static_cast<uint64_t>(slot) * num_lanes_;
+    for (uint32_t lane = 0; lane < num_lanes_; lane++) {
+        if (valid_[base + lane]) result[lane] = values_[base + lane];
+    }
+    return result;
+}
+
+std::optional<uint64_t> BatchSimulator::get(Var *var, uint32_t lane) {
+    if (lane >= num_lanes_) return std::nullopt;
+    return get(var)[lane];
+}
+
+void BatchSimulator::set(Var *var, uint32_t lane, std::optional<uint64_t> value) {
+    if (!value) return;
+    if (lane >= num_lanes_) throw UserException(::format("Lane {0} out of range", lane));
+    if (var->type() == VarType::Parameter || var->type() == VarType::ConstValue)
+        throw UserException(::format("Cannot set value for constant {0}", var->handle_name()));
+    auto loc = probe_location(var);
+    auto const &root = program_.roots()[loc.root];
+    auto v = *value;
+    if (loc.count > 1) {
+        // packed values are split into elements
+        for (uint32_t i = 0; i < loc.count; i++) {
+            auto elem = i * root.slot_width >= 64 ? 0 : (v >> (i * root.slot_width));
+            write_slot(loc.slot + i, lane, elem & sim_mask(root.slot_width), false);
+        }
+        return;
+    }
+    auto slot = loc.slot;
+    auto low = loc.low;
+    if (loc.offset_slot != SIM_NO_SLOT) {
+        auto index = static_cast<uint64_t>(loc.offset_slot) * num_lanes_ + lane;
+        if (!valid_[index]) throw UserException("Empty slice");
+        auto offset = values_[index];
+        if (offset / root.slot_width >= root.num_slots)
+            throw UserException(::format("Index out of range for {0}", var->to_string()));
+        slot = root.base + offset / root.slot_width;
+        low = offset % root.slot_width;
+    }
+    auto index = static_cast<uint64_t>(slot) * num_lanes_ + lane;
+    auto mask = sim_mask(loc.width) << low;
+    auto base = valid_[index] ? values_[index] : 0;
+    write_slot(slot, lane, (base & ~mask) | ((v << low) & mask), false);
+}
+
+void BatchSimulator::set(Var *var, const std::vector<uint64_t> &values) {
+    if (values.size() != num_lanes_)
+        throw UserException(::format("Expect {0} values, got {1}", num_lanes_, values.size()));
+    for (uint32_t lane = 0; lane < num_lanes_; lane++) set(var, lane, values[lane]);
+}
+
 }  // namespace kratos
@@ -1,11 +1,57 @@
 #ifndef KRATOS_SIM_HH
 #define KRATOS_SIM_HH
+#include <functional>
 #include <optional>
 #include <queue>
 #include "generator.hh"
+#include "stmt.hh"
 
 namespace kratos {
 constexpr uint64_t MAX_SIMULATION_DEPTH = 0xFFFFFFFF;
+
+// every root variable is assigned a contiguous bit range inside a single packed arena.
+// element i of an array is stored at bits [offset + i * var_width, offset + (i + 1) * var_width)
+class SimValueStore {
+public:
+    struct Entry {
+        uint64_t offset;
+        uint32_t width;
+        uint32_t id;
+    };
+
+    // snapshot of the arena and the valid bits
+    struct State {
+        std::vector<uint64_t> bits;
+        std::vector<uint64_t> valid;
+    };
+
+    // allocated on first use if the variable was not known when the store was created
+    const Entry &entry(const Var *root);
+
+    [[nodiscard]] bool valid(const Entry &entry) const {
+        return (valid_[entry.id / 64] >> (entry.id % 64)) & 1u;
+    }
+    void set_valid(const Entry &entry) { valid_[entry.id / 64] |= 1ull << (entry.id % 64); }
+
+    // width has to be no larger than 64
+    [[nodiscard]] uint64_t read(uint64_t offset, uint32_t width) const;
+    void write(uint64_t offset, uint32_t width, uint64_t value);
+    // arbitrary width, as multi-word bit vectors
+    [[nodiscard]] std::vector<uint64_t> read_words(uint64_t offset, uint32_t width) const;
+    void write_words(uint64_t offset, uint32_t width, const std::vector<uint64_t> &words);
+
+    [[nodiscard]] State save() const { return {bits_, valid_}; }
+    void load(const State &state);
+
+    [[nodiscard]] uint64_t num_bits() const { return num_bits_; }
+
+private:
+    std::unordered_map<const Var *, Entry> entries_;
+    std::vector<uint64_t> bits_;
+    std::vector<uint64_t> valid_;
+    uint64_t num_bits_ = 0;
+};
+
 class Simulator {
 public:
     explicit Simulator(Generator *generator);
@@ -23,6 +69,10 @@ public:
 
     static uint64_t static_evaluate_expr(Var *expr);
 
+    // values can be saved and restored cheaply. loading a state drops pending events
+    [[nodiscard]] SimValueStore::State save_state() const { return values_.save(); }
+    void load_state(const SimValueStore::State &state);
+
 protected:
     void set_value_(const Var *var, std::optional<uint64_t> op_value);
     void set_complex_value_(const Var *var, const std::optional<std::vector<uint64_t>> &op_value);
@@ -30,8 +80,10 @@ protected:
     std::optional<std::vector<uint64_t>> get_complex_value_(const Var *var) const;
 
 private:
-    std::unordered_map<const Var *, uint64_t> values_;
-    std::unordered_map<const Var *, std::vector<uint64_t>> complex_values_;
+    // getters are logically const but may allocate storage for unseen variables
+    mutable SimValueStore values_;
+    // static slices resolved to (var_high, var_low) within their root
+    mutable std::unordered_map<const Var *, std::pair<uint32_t, uint32_t>> slice_ranges_;
     std::queue<std::pair<const Var *, Stmt *>> event_queue_;
     std::unordered_map<const Var *, std::unordered_set<Stmt *>> dependency_;
     // linked dependency is for partial updates
@@ -40,6 +92,12 @@ private:
     std::unordered_set<Stmt *> scope_;
 
     std::vector<std::pair<uint32_t, uint32_t>> get_slice_index(const Var *var) const;
+    std::optional<std::pair<uint32_t, uint32_t>> get_slice_range(const Var *var) const;
+    // values wider than 64 bits
+    std::optional<std::vector<uint64_t>> get_words_(const Var *var) const;
+    std::optional<std::vector<uint64_t>> get_wide_value_(const Var *var) const;
+    void set_wide_value_(const Var *var, const std::vector<uint64_t> &value);
+    std::optional<std::vector<uint64_t>> eval_wide_expr_(const Expr *expr) const;
     void trigger_event(const Var *var, const std::unordered_set<uint32_t> &bit_mask);
 
     void process_stmt(Stmt *stmt, const Var *var);
@@ -58,6 +116,268 @@ private:
 
     uint64_t simulation_depth_ = 0;
 };
+
+// compiled simulation
+// the combinational logic is levelized once and every process (continuous assignment,
+// always_comb, always_ff) is lowered into a flat instruction tape over a dense slot-indexed
+// value array. control flow is lowered into predicates so the tape is branch free
+enum class SimOpCode : uint8_t {
+    Unary,
+    Binary,
+    Ternary,
+    Slice,
+    DynSlice,
+    Index,
+    Concat,
+    Extend,
+    Clog2,
+    PredTrue,
+    PredFalse,
+    PredEq,
+    PredOr,
+    PredAndNot,
+    Store,
+    DynStore,
+    Copy
+};
+
+constexpr uint32_t SIM_NO_SLOT = 0xFFFFFFFF;
+
+struct SimInstruction {
+    SimOpCode code;
+    ExprOp op = ExprOp::Add;
+    bool is_signed = false;
+    bool nba = false;
+    uint32_t dst = SIM_NO_SLOT;
+    uint32_t a = SIM_NO_SLOT;
+    uint32_t b = SIM_NO_SLOT;
+    uint32_t c = SIM_NO_SLOT;
+    // result width for expressions, target width for stores
+    uint32_t width = 0;
+    // operand width, bit offset, or shift amount depending on the op code
+    uint32_t param = 0;
+    // number of slots for copy, or the index range for dynamic slicing
+    uint32_t count = 0;
+};
+
+struct SimRoot {
+    const Var *var;
+    uint32_t base;
+    uint32_t num_slots;
+    // number of bits stored in each slot
+    uint32_t slot_width;
+};
+
+struct SimProcess {
+    Stmt *stmt = nullptr;
+    bool sequential = false;
+    std::vector<SimInstruction> tape;
+    // root ids
+    std::vector<uint32_t> reads;
+    std::vector<uint32_t> writes;
+    // processes in different partitions never write to the same variable
+    uint32_t partition = 0;
+    // combinational processes only read values produced at lower levels
+    uint32_t level = 0;
+    // number of cross-partition nets on the longest path to the process
+    uint32_t stage = 0;
+    // sequential process with blocking assignments
+    bool blocking = false;
+};
+
+struct SimLocation {
+    uint32_t root = SIM_NO_SLOT;
+    uint32_t slot = SIM_NO_SLOT;
+    uint32_t low = 0;
+    uint32_t width = 0;
+    // larger than 1 if the location spans multiple slots, i.e. array elements
+    uint32_t count = 1;
+    // if not SIM_NO_SLOT, the bit offset is computed at runtime and stored in the slot
+    uint32_t offset_slot = SIM_NO_SLOT;
+};
+
+// the lowered design. shared by every simulation engine that executes the tapes
+class SimProgram {
+public:
+    explicit SimProgram(Generator *generator);
+
+    uint32_t root_id(const Var *var);
+    SimLocation location(const Var *var, std::vector<SimInstruction> &tape,
+                         std::vector<uint32_t> &reads);
+    uint32_t lower_expr(const Var *var, std::vector<SimInstruction> &tape,
+                        std::vector<uint32_t> &reads);
+
+    [[nodiscard]] uint64_t num_slots() const { return slot_root_.size(); }
+    [[nodiscard]] const std::vector<SimRoot> &roots() const { return roots_; }
+    [[nodiscard]] const std::vector<uint32_t> &slot_root() const { return slot_root_; }
+    [[nodiscard]] const std::vector<SimProcess> &processes() const { return processes_; }
+    [[nodiscard]] const std::vector<uint32_t> &comb_order() const { return comb_order_; }
+    [[nodiscard]] const std::vector<uint32_t> &order_index() const { return order_index_; }
+    [[nodiscard]] const std::vector<std::vector<uint32_t>> &readers() const { return readers_; }
+    [[nodiscard]] uint32_t num_partitions() const { return num_partitions_; }
+    // false if there is a combinational loop, in which case the levels are not exact
+    [[nodiscard]] bool acyclic() const { return acyclic_; }
+    [[nodiscard]] const std::vector<std::pair<uint32_t, uint64_t>> &constants() const {
+        return constants_;
+    }
+    // slot -> (process, edge, bit)
+    struct Trigger {
+        uint32_t process;
+        BlockEdgeType edge;
+        uint32_t bit;
+    };
+    [[nodiscard]] const std::unordered_map<uint32_t, std::vector<Trigger>> &triggers() const {
+        return triggers_;
+    }
+
+private:
+    std::vector<SimRoot> roots_;
+    std::unordered_map<const Var *, uint32_t> root_ids_;
+    std::vector<uint32_t> slot_root_;
+    std::map<std::pair<uint64_t, uint32_t>, uint32_t> const_slots_;
+    std::vector<std::pair<uint32_t, uint64_t>> constants_;
+
+    std::vector<SimProcess> processes_;
+    std::vector<uint32_t> comb_order_;
+    std::vector<uint32_t> order_index_;
+    // root id -> processes that read the root
+    std::vector<std::vector<uint32_t>> readers_;
+    std::unordered_map<uint32_t, std::vector<Trigger>> triggers_;
+    uint32_t num_partitions_ = 0;
+    bool acyclic_ = true;
+
+    uint32_t temp_slot();
+    uint32_t const_slot(uint64_t value, uint32_t width);
+    uint32_t read_location(const SimLocation &loc, std::vector<SimInstruction> &tape);
+
+    void add_process(Stmt *stmt, bool sequential, uint32_t partition);
+    void lower_stmt(Stmt *stmt, uint32_t predicate, bool nba, SimProcess &process);
+    void lower_assign(AssignStmt *stmt, uint32_t predicate, bool nba, SimProcess &process);
+    void levelize();
+    void partition();
+};
+
+// side effects of running a process, applied once the process finishes. this allows
+// processes to run on different threads
+struct SimWriteLog {
+    uint32_t process = SIM_NO_SLOT;
+    // written roots
+    std::vector<uint32_t> roots;
+    std::vector<uint32_t> triggered;
+    std::vector<uint32_t> nba_slots;
+};
+
+class CompiledSimulator {
+public:
+    explicit CompiledSimulator(Generator *generator);
+    ~CompiledSimulator();
+
+    // same public facing API as the Simulator
+    void set(Var *var, std::optional<uint64_t> value, bool eval = true);
+    void set_i(const Var *var, std::optional<int64_t> value, bool eval = true);
+    void set(Var *var, const std::optional<std::vector<uint64_t>> &value, bool eval = true);
+    void set_i(const Var *var, const std::optional<std::vector<int64_t>> &value, bool eval = true);
+    std::optional<uint64_t> get(Var *var);
+    std::optional<std::vector<uint64_t>> get_array(Var *var);
+
+    void eval();
+
+    // evaluate independent partitions on multiple threads. the number of threads is
+    // controlled by set_num_cpus
+    void set_parallel(bool value);
+    [[nodiscard]] bool parallel() const { return parallel_; }
+
+    [[nodiscard]] const SimProgram &program() const { return program_; }
+
+private:
+    SimProgram program_;
+    bool parallel_ = false;
+    std::vector<uint64_t> values_;
+    std::vector<uint8_t> valid_;
+
+    // dirty combinational processes, ordered by their level
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<>> dirty_;
+    std::vector<uint8_t> in_queue_;
+    std::vector<uint32_t> triggered_;
+    SimWriteLog log_;
+
+    // non-blocking assignments
+    std::vector<uint64_t> nba_values_;
+    std::vector<uint32_t> nba_slots_;
+    std::vector<uint8_t> nba_pending_;
+
+    // cached tapes to evaluate expressions in get()
+    std::unordered_map<const Var *, std::pair<std::vector<SimInstruction>, uint32_t>> probes_;
+
+    void resize();
+    void run(const std::vector<SimInstruction> &tape, SimWriteLog &log);
+    void write_slot(uint32_t slot, uint64_t value, bool nba, SimWriteLog &log);
+    void apply(SimWriteLog &log);
+    void mark_dirty(uint32_t root, uint32_t process);
+    void settle();
+    void settle_parallel();
+    // runs the processes grouped by partition
+    void run_parallel(const std::vector<uint32_t> &processes);
+    void dispatch(uint64_t num_groups, const std::function<void(uint64_t)> &fn);
+    void commit_nba();
+    std::optional<uint64_t> read(const SimLocation &loc);
+    SimLocation probe_location(Var *var);
+};
+
+// evaluates the same design against multiple independent stimuli. values are stored in
+// structure-of-arrays form, i.e. all lanes of a slot are next to each other, so every
+// instruction becomes a loop over the lanes. unlike the other simulators, set does not
+// trigger evaluation; call eval() once all the lanes are set
+class BatchSimulator {
+public:
+    BatchSimulator(Generator *generator, uint32_t num_lanes);
+
+    void set(Var *var, uint32_t lane, std::optional<uint64_t> value);
+    // one value per lane
+    void set(Var *var, const std::vector<uint64_t> &values);
+    std::optional<uint64_t> get(Var *var, uint32_t lane);
+    std::vector<std::optional<uint64_t>> get(Var *var);
+
+    void eval();
+    // drop every value set so far
+    void reset();
+
+    [[nodiscard]] uint32_t num_lanes() const { return num_lanes_; }
+    [[nodiscard]] const SimProgram &program() const { return program_; }
+
+private:
+    SimProgram program_;
+    uint32_t num_lanes_;
+    // index is slot * num_lanes + lane
+    std::vector<uint64_t> values_;
+    std::vector<uint8_t> valid_;
+    std::vector<uint64_t> initial_values_;
+    std::vector<uint8_t> initial_valid_;
+
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<>> dirty_;
+    std::vector<uint8_t> in_queue_;
+    // lanes of a sequential process that see a matching edge
+    std::vector<uint8_t> trigger_lanes_;
+    std::vector<uint32_t> triggered_;
+    uint32_t current_process_ = SIM_NO_SLOT;
+
+    std::vector<uint64_t> nba_values_;
+    std::vector<uint8_t> nba_pending_;
+    std::vector<std::pair<uint32_t, uint32_t>> nba_slots_;
+
+    std::unordered_map<const Var *, std::pair<std::vector<SimInstruction>, uint32_t>> probes_;
+
+    void resize();
+    // lanes is nullptr when every lane is active
+    void run(const std::vector<SimInstruction> &tape, const uint8_t *lanes);
+    void write_slot(uint32_t slot, uint32_t lane, uint64_t value, bool nba);
+    void mark_dirty(uint32_t root);
+    void settle();
+    void commit_nba();
+    SimLocation probe_location(Var *var);
+    std::optional<uint64_t> read(const SimLocation &loc, uint32_t lane);
+};
+
 }  // namespace kratos
 
 #endif  // KRATOS_SIM_HH
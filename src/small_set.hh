@@ -0,0 +1,162 @@
+#ifndef KRATOS_SMALL_SET_HH
+#define KRATOS_SMALL_SET_HH
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+namespace kratos {
+
+// set of shared pointers that is optimized for a few elements, such as the sinks and sources of
+// a variable. the first N elements are stored inline, larger sets move to a heap array. once
+// the set is larger than index_threshold, a hash index is built to keep lookups O(1).
+// elements are stored contiguously, so iteration is a plain array walk. the iteration order is
+// the insertion order, except that erase moves the last element into the erased slot
+template <typename T, uint32_t N>
+class SmallPtrSet {
+public:
+    using value_type = std::shared_ptr<T>;
+    using const_iterator = const value_type *;
+    using iterator = const_iterator;
+
+    static constexpr uint32_t index_threshold = 16;
+
+    SmallPtrSet() = default;
+    template <typename Iter>
+    SmallPtrSet(Iter begin, Iter end) {
+        for (auto it = begin; it != end; it++) emplace(*it);
+    }
+    SmallPtrSet(const SmallPtrSet &set) {
+        reserve(set.size_);
+        for (auto const &ptr : set) emplace(ptr);
+    }
+    SmallPtrSet(SmallPtrSet &&set) noexcept { move_from(std::move(set)); }
+    SmallPtrSet &operator=(const SmallPtrSet &set) {
+        if (this != &set) {
+            clear();
+            reserve(set.size_);
+            for (auto const &ptr : set) emplace(ptr);
+        }
+        return *this;
+    }
+    SmallPtrSet &operator=(SmallPtrSet &&set) noexcept {
+        if (this != &set) {
+            release();
+            move_from(std::move(set));
+        }
+        return *this;
+    }
+    ~SmallPtrSet() { release(); }
+
+    [[nodiscard]] const_iterator begin() const { return data_; }
+    [[nodiscard]] const_iterator end() const { return data_ + size_; }
+    [[nodiscard]] uint64_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+    // memory allocated outside the object, in bytes
+    [[nodiscard]] uint64_t heap_size() const {
+        uint64_t result = data_ != inline_ ? capacity_ * sizeof(value_type) : 0;
+        if (index_) {
+            // buckets plus one node per entry
+            result += index_->bucket_count() * sizeof(void *) +
+                      index_->size() * (sizeof(void *) + sizeof(typename Index::value_type));
+        }
+        return result;
+    }
+
+    const_iterator find(const value_type &ptr) const { return find(ptr.get()); }
+    const_iterator find(const T *ptr) const {
+        if (index_) {
+            auto it = index_->find(ptr);
+            return it == index_->end() ? end() : data_ + it->second;
+        }
+        for (uint32_t i = 0; i < size_; i++) {
+            if (data_[i].get() == ptr) return data_ + i;
+        }
+        return end();
+    }
+    [[nodiscard]] uint64_t count(const value_type &ptr) const { return find(ptr) != end(); }
+
+    std::pair<const_iterator, bool> emplace(const value_type &ptr) {
+        auto it = find(ptr);
+        if (it != end()) return {it, false};
+        if (size_ == capacity_) reserve(capacity_ * 2);
+        data_[size_] = ptr;
+        if (index_) {
+            index_->emplace(ptr.get(), size_);
+        } else if (size_ + 1 > index_threshold) {
+            build_index();
+        }
+        return {data_ + size_++, true};
+    }
+    std::pair<const_iterator, bool> insert(const value_type &ptr) { return emplace(ptr); }
+
+    uint64_t erase(const value_type &ptr) {
+        auto it = find(ptr);
+        if (it == end()) return 0;
+        auto const pos = static_cast<uint32_t>(it - data_);
+        auto const last = size_ - 1;
+        if (index_) index_->erase(ptr.get());
+        if (pos != last) {
+            data_[pos] = std::move(data_[last]);
+            if (index_) (*index_)[data_[pos].get()] = pos;
+        }
+        data_[last].reset();
+        size_--;
+        return 1;
+    }
+
+    void clear() {
+        for (uint32_t i = 0; i < size_; i++) data_[i].reset();
+        size_ = 0;
+        index_.reset();
+    }
+
+    void reserve(uint64_t size) {
+        if (size <= capacity_) return;
+        auto *data = new value_type[size];
+        for (uint32_t i = 0; i < size_; i++) data[i] = std::move(data_[i]);
+        if (data_ != inline_) delete[] data_;
+        data_ = data;
+        capacity_ = static_cast<uint32_t>(size);
+    }
+
+private:
+    value_type *data_ = inline_;
+    uint32_t size_ = 0;
+    uint32_t capacity_ = N;
+    value_type inline_[N];
+    using Index = std::unordered_map<const T *, uint32_t>;
+    std::unique_ptr<Index> index_;
+
+    void build_index() {
+        index_ = std::make_unique<Index>();
+        index_->reserve(capacity_);
+        for (uint32_t i = 0; i <= size_; i++) index_->emplace(data_[i].get(), i);
+    }
+
+    void release() {
+        clear();
+        if (data_ != inline_) delete[] data_;
+        data_ = inline_;
+        capacity_ = N;
+    }
+
+    void move_from(SmallPtrSet &&set) {
+        if (set.data_ == set.inline_) {
+            for (uint32_t i = 0; i < set.size_; i++) inline_[i] = std::move(set.inline_[i]);
+        } else {
+            data_ = set.data_;
+            capacity_ = set.capacity_;
+            set.data_ = set.inline_;
+            set.capacity_ = N;
+        }
+        size_ = set.size_;
+        index_ = std::move(set.index_);
+        set.size_ = 0;
+    }
+};
+
+}  // namespace kratos
+
+#endif  // KRATOS_SMALL_SET_HH
@@ -17,6 +17,11 @@ namespace kratos {
 
 IRNode *Stmt::parent() { return parent_; }
 
+void mark_generator_dirty(const Stmt *stmt) {
+    auto *generator = stmt->generator_parent();
+    if (generator) generator->mark_dirty();
+}
+
 Generator *Stmt::generator_parent() const {
     IRNode *p = parent_;
     // we don't do while loop here to prevent infinite loop
@@ -148,6 +153,16 @@ IRNode *AssignStmt::get_child(uint64_t index) {
         return nullptr;
 }
 
+void AssignStmt::set_left(const std::shared_ptr<Var> &left) {
+    left_ = left.get();
+    mark_generator_dirty(this);
+}
+
+void AssignStmt::set_right(const std::shared_ptr<Var> &right) {
+    right_ = right.get();
+    mark_generator_dirty(this);
+}
+
 void AssignStmt::set_parent(kratos::IRNode *parent) {
     bool has_parent = parent_ != nullptr;
     Stmt::set_parent(parent);
@@ -193,6 +208,7 @@ void IfStmt::set_predicate(const std::shared_ptr<Var> &var) {
     predicate_stmt_ =
         predicate_->generator()->get_auxiliary_var(predicate_->width())->assign(predicate_);
     predicate_stmt_->set_parent(nullptr);
+    mark_generator_dirty(this);
 }
 
 void IfStmt::add_then_stmt(const std::shared_ptr<Stmt> &stmt) {
@@ -235,6 +251,8 @@ void IfStmt::set_then(const std::shared_ptr<ScopedStmtBlock> &stmt) {
     for (auto &s : *stmt) {
         then_body_->add_stmt(s);
     }
+    // an empty body doesn't go through add_stmt
+    mark_generator_dirty(this);
 }
 
 void IfStmt::set_else(const std::shared_ptr<ScopedStmtBlock> &stmt) {
@@ -242,6 +260,8 @@ void IfStmt::set_else(const std::shared_ptr<ScopedStmtBlock> &stmt) {
     for (auto &s : *stmt) {
         else_body_->add_stmt(s);
     }
+    // an empty body doesn't go through add_stmt
+    mark_generator_dirty(this);
 }
 
 void IfStmt::set_parent(IRNode *node) {
@@ -360,9 +380,11 @@ void StmtBlock::add_stmt(const std::shared_ptr<Stmt> &stmt) {
     }
     stmt->set_parent(this);
     stmts_.emplace_back(stmt);
+    mark_generator_dirty(this);
 }
 
 void StmtBlock::clear() {
+    if (!stmts_.empty()) mark_generator_dirty(this);
     for (auto &stmt : stmts_) {
         stmt->clear();
     }
@@ -378,13 +400,17 @@ void StmtBlock::set_parent(IRNode *parent) {
 
 void StmtBlock::remove_stmt(const std::shared_ptr<kratos::Stmt> &stmt) {
     auto pos = std::find(stmts_.begin(), stmts_.end(), stmt);
-    if (pos != stmts_.end()) stmts_.erase(pos);
+    if (pos != stmts_.end()) {
+        stmts_.erase(pos);
+        mark_generator_dirty(this);
+    }
 }
 
 void StmtBlock::set_child(uint64_t index, const std::shared_ptr<Stmt> &stmt) {
     if (index < stmts_.size()) {
         stmts_[index] = stmt;
         stmt->set_parent(this);
+        mark_generator_dirty(this);
     }
 }
 
@@ -420,6 +446,7 @@ void SequentialStmtBlock::add_condition(
     if (pos != conditions_.end()) return;
     auto var = condition.second;
     conditions_.emplace_back(condition);
+    mark_generator_dirty(this);
 }
 
 IRNode *SequentialStmtBlock::get_child(uint64_t index) {
@@ -486,6 +513,7 @@ ScopedStmtBlock &SwitchStmt::add_switch_case(Const &switch_case,
 void SwitchStmt::remove_switch_case(const std::shared_ptr<kratos::Const> &switch_case) {
     if (body_.find(switch_case) != body_.end()) {
         body_.erase(switch_case);
+        mark_generator_dirty(this);
     }
 }
 
@@ -568,8 +596,7 @@ std::shared_ptr<Stmt> LatchStmtBlock::clone() const {
 }
 
 std::unordered_set<std::shared_ptr<AssignStmt>> filter_assignments_with_target(
-    const std::unordered_set<std::shared_ptr<AssignStmt>> &stmts, const Generator *target,
-    bool lhs) {
+    const AssignStmtSet &stmts, const Generator *target, bool lhs) {
     std::unordered_set<std::shared_ptr<AssignStmt>> result;
     for (const auto &stmt : stmts) {
         if (lhs) {
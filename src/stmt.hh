@@ -29,6 +29,9 @@ enum class BlockEdgeType { Posedge, Negedge };
 class StmtBlock;
 class ScopedStmtBlock;
 
+// statements inside a generator are part of its hash
+void mark_generator_dirty(const Stmt *stmt);
+
 class Stmt : public std::enable_shared_from_this<Stmt>, public IRNode {
 public:
     explicit Stmt(StatementType type) : IRNode(IRNodeKind::StmtKind), type_(type) {}
@@ -89,8 +92,8 @@ public:
     Var *&left() { return left_; }
     Var *&right() { return right_; }
 
-    void set_left(const std::shared_ptr<Var> &left) { left_ = left.get(); }
-    void set_right(const std::shared_ptr<Var> &right) { right_ = right.get(); }
+    void set_left(const std::shared_ptr<Var> &left);
+    void set_right(const std::shared_ptr<Var> &right);
 
     void set_parent(IRNode *parent) override;
 
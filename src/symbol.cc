@@ -0,0 +1,88 @@
+#include "symbol.hh"
+
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+namespace kratos {
+
+Symbol SymbolTable::intern(std::string_view str) {
+    auto const hash = std::hash<std::string_view>{}(str);
+    {
+        std::shared_lock lock(mutex_);
+        auto const slot = find_slot(str, hash);
+        if (slot != slots_.size() && slots_[slot] != none) return slots_[slot];
+    }
+    std::unique_lock lock(mutex_);
+    // keep the load factor below 1/2
+    if ((strings_.size() + 1) * 2 > slots_.size()) {
+        rehash(std::max<uint64_t>(64, slots_.size() * 2));
+    }
+    // another thread may have added it in the meantime
+    auto const slot = find_slot(str, hash);
+    if (slots_[slot] != none) return slots_[slot];
+    auto const symbol = static_cast<Symbol>(strings_.size());
+    strings_.emplace_back(store(str));
+    hashes_.emplace_back(hash);
+    slots_[slot] = symbol;
+    return symbol;
+}
+
+Symbol SymbolTable::find(std::string_view str) const {
+    auto const hash = std::hash<std::string_view>{}(str);
+    std::shared_lock lock(mutex_);
+    auto const slot = find_slot(str, hash);
+    return slot != slots_.size() ? slots_[slot] : none;
+}
+
+std::string_view SymbolTable::str(Symbol symbol) const {
+    std::shared_lock lock(mutex_);
+    return strings_.at(symbol);
+}
+
+uint64_t SymbolTable::size() const {
+    std::shared_lock lock(mutex_);
+    return strings_.size();
+}
+
+uint64_t SymbolTable::find_slot(std::string_view str, uint64_t hash) const {
+    // returns either the slot holding the string or the empty slot it would go to
+    if (slots_.empty()) return 0;
+    auto const mask = slots_.size() - 1;
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+        auto const symbol = slots_[i];
+        if (symbol == none || (hashes_[symbol] == hash && strings_[symbol] == str)) return i;
+    }
+}
+
+std::string_view SymbolTable::store(std::string_view str) {
+    char *data;
+    if (str.size() > chunk_size / 4) {
+        // long strings get their own chunk, so that the current one is not wasted
+        chunks_.emplace_back(new char[str.size()]);
+        data = chunks_.back().get();
+    } else {
+        if (remaining_ < str.size()) {
+            chunks_.emplace_back(new char[chunk_size]);
+            current_ = chunks_.back().get();
+            remaining_ = chunk_size;
+        }
+        data = current_;
+        current_ += str.size();
+        remaining_ -= str.size();
+    }
+    std::memcpy(data, str.data(), str.size());
+    return {data, str.size()};
+}
+
+void SymbolTable::rehash(uint64_t capacity) {
+    slots_.assign(capacity, none);
+    auto const mask = capacity - 1;
+    for (Symbol symbol = 0; symbol < strings_.size(); symbol++) {
+        auto i = hashes_[symbol] & mask;
+        while (slots_[i] != none) i = (i + 1) & mask;
+        slots_[i] = symbol;
+    }
+}
+
+}  // namespace kratos
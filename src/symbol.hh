@@ -0,0 +1,143 @@
+#ifndef KRATOS_SYMBOL_HH
+#define KRATOS_SYMBOL_HH
+
+#include <algorithm>
+#include <memory>
+#include <limits>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace kratos {
+
+using Symbol = uint32_t;
+
+// interned names. every distinct string is stored once and gets a compact id, so that name
+// tables can be keyed by integers instead of strings. the characters are packed into large
+// chunks and the index is a flat array of symbols. ids are never released, and it's safe to use
+// the table from multiple threads
+class SymbolTable {
+public:
+    SymbolTable() = default;
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    static constexpr Symbol none = std::numeric_limits<Symbol>::max();
+    static constexpr uint64_t chunk_size = 1u << 16u;
+
+    Symbol intern(std::string_view str);
+    // returns none if the string has never been interned. lookups of unknown names won't grow
+    // the table
+    [[nodiscard]] Symbol find(std::string_view str) const;
+    [[nodiscard]] std::string_view str(Symbol symbol) const;
+    [[nodiscard]] uint64_t size() const;
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char *current_ = nullptr;
+    uint64_t remaining_ = 0;
+    std::vector<std::string_view> strings_;
+    std::vector<uint64_t> hashes_;
+    // open addressing, indexed by the string hash
+    std::vector<Symbol> slots_;
+
+    [[nodiscard]] uint64_t find_slot(std::string_view str, uint64_t hash) const;
+    std::string_view store(std::string_view str);
+    void rehash(uint64_t capacity);
+};
+
+// open-addressing hash map keyed by symbols, used for the per-generator name tables. entries
+// are stored inline in a single array, which is much more compact than a node-based map
+template <typename T>
+class SymbolMap {
+public:
+    [[nodiscard]] uint64_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    const T *find(Symbol symbol) const {
+        if (slots_.empty()) return nullptr;
+        for (auto i = slot(symbol);; i = (i + 1) & mask()) {
+            auto const &entry = slots_[i];
+            if (entry.symbol == SymbolTable::none) return nullptr;
+            if (entry.symbol == symbol) return &entry.value;
+        }
+    }
+    T *find(Symbol symbol) {
+        return const_cast<T *>(static_cast<const SymbolMap *>(this)->find(symbol));
+    }
+
+    // returns false if the symbol already exists, in which case the value is not changed
+    bool emplace(Symbol symbol, T value) {
+        // keep the load factor below 3/4
+        if ((size_ + 1) * 4 > slots_.size() * 3) rehash(std::max<uint64_t>(8, slots_.size() * 2));
+        auto i = slot(symbol);
+        for (; slots_[i].symbol != SymbolTable::none; i = (i + 1) & mask()) {
+            if (slots_[i].symbol == symbol) return false;
+        }
+        slots_[i] = {symbol, std::move(value)};
+        size_++;
+        return true;
+    }
+
+    bool erase(Symbol symbol) {
+        if (slots_.empty() || symbol == SymbolTable::none) return false;
+        auto i = slot(symbol);
+        for (; slots_[i].symbol != symbol; i = (i + 1) & mask()) {
+            if (slots_[i].symbol == SymbolTable::none) return false;
+        }
+        // backward shift deletion, so that no tombstone is needed
+        for (auto j = (i + 1) & mask(); slots_[j].symbol != SymbolTable::none;
+             j = (j + 1) & mask()) {
+            auto const home = slot(slots_[j].symbol);
+            // move the entry into the hole if the hole lies within its probe sequence
+            if (((j - home) & mask()) >= ((j - i) & mask())) {
+                slots_[i] = std::move(slots_[j]);
+                i = j;
+            }
+        }
+        slots_[i] = {};
+        size_--;
+        return true;
+    }
+
+    void clear() {
+        slots_.clear();
+        size_ = 0;
+    }
+
+    // visits the entries in slot order, which is unrelated to the names
+    template <typename Fn>
+    void for_each(Fn &&fn) const {
+        for (auto const &entry : slots_) {
+            if (entry.symbol != SymbolTable::none) fn(entry.symbol, entry.value);
+        }
+    }
+
+private:
+    struct Entry {
+        Symbol symbol = SymbolTable::none;
+        T value = {};
+    };
+    std::vector<Entry> slots_;
+    uint64_t size_ = 0;
+
+    [[nodiscard]] uint64_t mask() const { return slots_.size() - 1; }
+    [[nodiscard]] uint64_t slot(Symbol symbol) const {
+        // fibonacci hashing, symbols are sequential
+        return (static_cast<uint64_t>(symbol) * 0x9e3779b97f4a7c15ull >> 32u) & mask();
+    }
+
+    void rehash(uint64_t capacity) {
+        auto slots = std::move(slots_);
+        slots_ = std::vector<Entry>(capacity);
+        size_ = 0;
+        for (auto &entry : slots) {
+            if (entry.symbol != SymbolTable::none) emplace(entry.symbol, std::move(entry.value));
+        }
+    }
+};
+
+}  // namespace kratos
+
+#endif  // KRATOS_SYMBOL_HH
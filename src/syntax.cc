@@ -1,5 +1,19 @@
 #include "syntax.hh"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
 #include <string>
+#include <unordered_map>
+#include "except.hh"
+#include "hash.hh"
+#include "port.hh"
+#include "util.hh"
+
+using fmt::format;
 
 namespace kratos {
 
@@ -263,7 +277,842 @@ void inline initialize_keywords() {
 }
 
 bool is_valid_variable_name(const std::string &name) {
-    initialize_keywords();
+    static std::once_flag keywords_flag;
+    std::call_once(keywords_flag, initialize_keywords);
     return system_verilog_keywords.find(name) == system_verilog_keywords.end();
 }
-}
\ No newline at end of file
+
+// lexer for module headers. it understands enough of the syntax to skip comments, strings,
+// attributes and compiler directives
+class VerilogLexer {
+public:
+    enum class TokenKind { Identifier, Number, Symbol, String, End };
+    struct Token {
+        TokenKind kind = TokenKind::End;
+        std::string_view text;
+
+        bool is(std::string_view str) const { return kind != TokenKind::String && text == str; }
+    };
+
+    explicit VerilogLexer(std::string_view src) : src_(src) {}
+
+    Token next() {
+        skip_ignored();
+        if (pos_ >= src_.size()) return {};
+        auto const start = pos_;
+        auto const c = src_[pos_];
+        if (is_identifier_start(c)) {
+            while (pos_ < src_.size() && is_identifier_char(src_[pos_])) pos_++;
+            return {TokenKind::Identifier, src_.substr(start, pos_ - start)};
+        }
+        if (c == '\\') {
+            // escaped identifier, terminated by white space
+            pos_++;
+            while (pos_ < src_.size() && !std::isspace(static_cast<unsigned char>(src_[pos_])))
+                pos_++;
+            return {TokenKind::Identifier, src_.substr(start + 1, pos_ - start - 1)};
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '\'') {
+            // sized and based literals, e.g. 4'b1010, are a single token
+            while (pos_ < src_.size() && (std::isalnum(static_cast<unsigned char>(src_[pos_])) ||
+                                          src_[pos_] == '_' || src_[pos_] == '\'' ||
+                                          src_[pos_] == '.' || src_[pos_] == '?')) {
+                pos_++;
+            }
+            return {TokenKind::Number, src_.substr(start, pos_ - start)};
+        }
+        if (c == '"') {
+            pos_++;
+            while (pos_ < src_.size() && src_[pos_] != '"') pos_ += src_[pos_] == '\\' ? 2 : 1;
+            pos_ = std::min(pos_ + 1, src_.size());
+            return {TokenKind::String, src_.substr(start, pos_ - start)};
+        }
+        if (c == '`') {
+            // macro usage
+            pos_++;
+            while (pos_ < src_.size() && is_identifier_char(src_[pos_])) pos_++;
+            return {TokenKind::Identifier, src_.substr(start, pos_ - start)};
+        }
+        // operators used in constant expressions
+        for (auto op : {"**", "<<", ">>"}) {
+            if (src_.substr(pos_, 2) == op) {
+                pos_ += 2;
+                return {TokenKind::Symbol, src_.substr(start, 2)};
+            }
+        }
+        pos_++;
+        return {TokenKind::Symbol, src_.substr(start, 1)};
+    }
+
+private:
+    std::string_view src_;
+    uint64_t pos_ = 0;
+
+    static bool is_identifier_start(char c) {
+        return std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+    }
+    static bool is_identifier_char(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+    }
+
+    void skip_line() {
+        // lines can be continued with a backslash, e.g. in `define
+        while (pos_ < src_.size() && src_[pos_] != '\n') pos_ += src_[pos_] == '\\' ? 2 : 1;
+    }
+
+    void skip_ignored() {
+        while (pos_ < src_.size()) {
+            auto const c = src_[pos_];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                pos_++;
+            } else if (src_.compare(pos_, 2, "//") == 0) {
+                skip_line();
+            } else if (src_.compare(pos_, 2, "/*") == 0) {
+                auto end = src_.find("*/", pos_ + 2);
+                pos_ = end == std::string_view::npos ? src_.size() : end + 2;
+            } else if (src_.compare(pos_, 2, "(*") == 0 && src_.compare(pos_, 3, "(*)") != 0) {
+                // attribute instance
+                auto end = src_.find("*)", pos_ + 2);
+                pos_ = end == std::string_view::npos ? src_.size() : end + 2;
+            } else if (c == '`' && !skip_directive()) {
+                return;
+            } else if (c != '`') {
+                return;
+            }
+        }
+    }
+
+    // returns false if it's a macro usage instead of a directive
+    bool skip_directive() {
+        auto end = pos_ + 1;
+        while (end < src_.size() && is_identifier_char(src_[end])) end++;
+        auto const name = src_.substr(pos_ + 1, end - pos_ - 1);
+        static const std::unordered_set<std::string_view> line_directives = {
+            "define", "undef", "timescale", "include", "default_nettype", "pragma", "line",
+            "unconnected_drive"};
+        static const std::unordered_set<std::string_view> name_directives = {"ifdef", "ifndef",
+                                                                             "elsif"};
+        static const std::unordered_set<std::string_view> directives = {
+            "else",     "endif",          "celldefine", "endcelldefine", "resetall",
+            "undefineall", "nounconnected_drive", "begin_keywords", "end_keywords"};
+        if (line_directives.find(name) != line_directives.end()) {
+            pos_ = end;
+            skip_line();
+        } else if (name_directives.find(name) != name_directives.end()) {
+            // skip the macro name as well
+            pos_ = end;
+            while (pos_ < src_.size() && std::isspace(static_cast<unsigned char>(src_[pos_])))
+                pos_++;
+            while (pos_ < src_.size() && is_identifier_char(src_[pos_])) pos_++;
+        } else if (directives.find(name) != directives.end()) {
+            pos_ = end;
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+using Token = VerilogLexer::Token;
+using TokenKind = VerilogLexer::TokenKind;
+
+std::string join_tokens(const std::vector<Token> &tokens, uint64_t begin, uint64_t end) {
+    std::string result;
+    for (auto i = begin; i < end; i++) {
+        if (i != begin) result.append(" ");
+        result.append(tokens[i].text);
+    }
+    return result;
+}
+
+class VerilogModuleScanner {
+public:
+    explicit VerilogModuleScanner(std::string_view src) : lexer_(src) { advance(); }
+
+    std::map<std::string, VerilogModuleDecl> scan() {
+        std::map<std::string, VerilogModuleDecl> result;
+        while (token_.kind != TokenKind::End) {
+            if (token_.is("module") || token_.is("macromodule")) {
+                auto mod = scan_module();
+                result.emplace(mod.name, std::move(mod));
+            } else {
+                advance();
+            }
+        }
+        return result;
+    }
+
+private:
+    VerilogLexer lexer_;
+    Token token_;
+
+    void advance() { token_ = lexer_.next(); }
+
+    // tokens up to the closing bracket, which is consumed. the opening one has to be consumed
+    // already
+    std::vector<Token> collect_group(std::string_view open, std::string_view close) {
+        std::vector<Token> result;
+        uint32_t depth = 1;
+        while (token_.kind != TokenKind::End) {
+            if (token_.is(open)) {
+                depth++;
+            } else if (token_.is(close) && --depth == 0) {
+                advance();
+                break;
+            }
+            result.emplace_back(token_);
+            advance();
+        }
+        return result;
+    }
+
+    // splits the tokens by top-level commas
+    static std::vector<std::pair<uint64_t, uint64_t>> split_items(const std::vector<Token> &tokens,
+                                                                  std::string_view separator) {
+        std::vector<std::pair<uint64_t, uint64_t>> result;
+        int depth = 0;
+        uint64_t start = 0;
+        for (uint64_t i = 0; i < tokens.size(); i++) {
+            auto const &t = tokens[i];
+            if (t.is("(") || t.is("[") || t.is("{")) {
+                depth++;
+            } else if (t.is(")") || t.is("]") || t.is("}")) {
+                depth--;
+            } else if (depth == 0 && t.is(separator)) {
+                result.emplace_back(start, i);
+                start = i + 1;
+            }
+        }
+        if (start < tokens.size()) result.emplace_back(start, tokens.size());
+        return result;
+    }
+
+    VerilogModuleDecl scan_module() {
+        VerilogModuleDecl mod;
+        advance();
+        if (token_.is("static") || token_.is("automatic")) advance();
+        mod.name = token_.text;
+        advance();
+        // package imports in the header
+        while (token_.is("import")) {
+            while (token_.kind != TokenKind::End && !token_.is(";")) advance();
+            advance();
+        }
+        bool has_header_params = false;
+        if (token_.is("#")) {
+            advance();
+            if (token_.is("(")) {
+                advance();
+                auto const tokens = collect_group("(", ")");
+                for (auto const &[begin, end] : split_items(tokens, ",")) {
+                    add_param(mod, tokens, begin, end);
+                }
+                has_header_params = true;
+            }
+        }
+        if (token_.is("(")) {
+            advance();
+            auto const tokens = collect_group("(", ")");
+            scan_port_list(mod, tokens);
+        }
+        // module body
+        while (token_.kind != TokenKind::End && !token_.is("endmodule")) {
+            if (token_.is("input") || token_.is("output") || token_.is("inout")) {
+                auto const tokens = collect_statement();
+                scan_port_declaration(mod, tokens);
+            } else if (token_.is("parameter") && !has_header_params) {
+                // parameters in the body are local if the header has a parameter list
+                advance();
+                auto const tokens = collect_statement();
+                for (auto const &[begin, end] : split_items(tokens, ",")) {
+                    add_param(mod, tokens, begin, end);
+                }
+            } else if (token_.is("function") || token_.is("task")) {
+                // their arguments look like port declarations
+                auto const end = token_.is("function") ? "endfunction" : "endtask";
+                while (token_.kind != TokenKind::End && !token_.is(end)) advance();
+                advance();
+            } else {
+                advance();
+            }
+        }
+        advance();
+        // end label
+        if (token_.is(":")) {
+            advance();
+            advance();
+        }
+        for (auto const &port : mod.ports) {
+            if (port.direction == no_direction && mod.error.empty()) {
+                mod.error = "direction of port " + port.name + " is not declared";
+            }
+        }
+        return mod;
+    }
+
+    // tokens up to the next ;, which is consumed
+    std::vector<Token> collect_statement() {
+        std::vector<Token> result;
+        while (token_.kind != TokenKind::End && !token_.is(";")) {
+            result.emplace_back(token_);
+            advance();
+        }
+        advance();
+        return result;
+    }
+
+    static void add_param(VerilogModuleDecl &mod, const std::vector<Token> &tokens,
+                          uint64_t begin, uint64_t end) {
+        // [parameter|localparam] [type] name [= value]
+        if (begin < end && (tokens[begin].is("parameter") || tokens[begin].is("localparam"))) {
+            if (tokens[begin].is("localparam")) return;
+            begin++;
+        }
+        uint64_t assign = begin;
+        while (assign < end && !tokens[assign].is("=")) assign++;
+        // the name is the last identifier before the default value
+        for (auto i = assign; i > begin; i--) {
+            if (tokens[i - 1].kind == TokenKind::Identifier) {
+                auto value = assign < end ? join_tokens(tokens, assign + 1, end) : "";
+                mod.params.emplace_back(std::string(tokens[i - 1].text), std::move(value));
+                return;
+            }
+        }
+    }
+
+    static constexpr auto no_direction = static_cast<PortDirection>(-1);
+
+    // parses [direction] [types] [signed] [packed dims] name [unpacked dims]. returns false if
+    // only the name is given
+    static bool parse_declaration(const std::vector<Token> &tokens, uint64_t begin, uint64_t end,
+                                  VerilogPortDecl &decl, std::string &error) {
+        static const std::unordered_set<std::string_view> types = {
+            "wire", "logic", "reg",  "bit",     "var",      "tri",    "wand",     "wor",
+            "uwire", "integer", "int", "byte", "shortint", "longint", "tri0", "tri1",
+            "supply0", "supply1", "triand", "trior", "trireg"};
+        bool has_type = false;
+        auto i = begin;
+        for (; i < end; i++) {
+            auto const &t = tokens[i];
+            if (t.is("input")) {
+                decl.direction = PortDirection::In;
+            } else if (t.is("output")) {
+                decl.direction = PortDirection::Out;
+            } else if (t.is("inout")) {
+                decl.direction = PortDirection::InOut;
+            } else if (t.is("signed")) {
+                decl.is_signed = true;
+            } else if (t.is("unsigned") || types.find(t.text) != types.end()) {
+            } else if (t.is("[")) {
+                i = parse_dim(tokens, i, end, decl.packed_dims, error);
+            } else {
+                break;
+            }
+            has_type = true;
+        }
+        if (i >= end || tokens[i].kind != TokenKind::Identifier) {
+            if (error.empty()) error = "unable to parse port " + join_tokens(tokens, begin, end);
+            return has_type;
+        }
+        decl.name = tokens[i].text;
+        for (i++; i < end; i++) {
+            if (tokens[i].is("[")) {
+                i = parse_dim(tokens, i, end, decl.unpacked_dims, error);
+            } else if (error.empty()) {
+                // e.g. interface ports or default values
+                error = "unsupported port declaration " + join_tokens(tokens, begin, end);
+            }
+        }
+        return has_type;
+    }
+
+    // returns the index of the closing bracket
+    static uint64_t parse_dim(const std::vector<Token> &tokens, uint64_t begin, uint64_t end,
+                              std::vector<std::pair<std::string, std::string>> &dims,
+                              std::string &error) {
+        int depth = 0;
+        uint64_t colon = 0;
+        auto i = begin;
+        for (; i < end; i++) {
+            if (tokens[i].is("[") || tokens[i].is("(")) {
+                depth++;
+            } else if (tokens[i].is("]") || tokens[i].is(")")) {
+                if (--depth == 0) break;
+            } else if (depth == 1 && tokens[i].is(":") && !colon) {
+                colon = i;
+            }
+        }
+        if (i == end) {
+            if (error.empty()) error = "unterminated dimension " + join_tokens(tokens, begin, end);
+            return end;
+        }
+        if (colon) {
+            dims.emplace_back(join_tokens(tokens, begin + 1, colon),
+                              join_tokens(tokens, colon + 1, i));
+        } else {
+            dims.emplace_back(join_tokens(tokens, begin + 1, i), "");
+        }
+        return i;
+    }
+
+    static void scan_port_list(VerilogModuleDecl &mod, const std::vector<Token> &tokens) {
+        const VerilogPortDecl *previous = nullptr;
+        for (auto const &[begin, end] : split_items(tokens, ",")) {
+            VerilogPortDecl decl;
+            decl.direction = no_direction;
+            auto const has_type = parse_declaration(tokens, begin, end, decl, mod.error);
+            if (!has_type && previous) {
+                // ANSI ports without direction and type inherit them from the previous port
+                decl.direction = previous->direction;
+                decl.is_signed = previous->is_signed;
+                decl.packed_dims = previous->packed_dims;
+            }
+            mod.ports.emplace_back(std::move(decl));
+            // non-ANSI ports are only names
+            if (has_type || previous) previous = &mod.ports.back();
+        }
+    }
+
+    static void scan_port_declaration(VerilogModuleDecl &mod, const std::vector<Token> &tokens) {
+        // input [types] [dims] a, b [unpacked], c
+        auto const items = split_items(tokens, ",");
+        if (items.empty()) return;
+        VerilogPortDecl type;
+        std::string error;
+        parse_declaration(tokens, items[0].first, items[0].second, type, error);
+        for (uint64_t i = 0; i < items.size(); i++) {
+            VerilogPortDecl decl = type;
+            if (i > 0) {
+                decl.unpacked_dims.clear();
+                auto const [begin, end] = items[i];
+                if (begin < end) decl.name = tokens[begin].text;
+                for (auto j = begin + 1; j < end; j++) {
+                    if (tokens[j].is("[")) j = parse_dim(tokens, j, end, decl.unpacked_dims, error);
+                }
+            }
+            auto pos = std::find_if(mod.ports.begin(), mod.ports.end(),
+                                    [&decl](auto const &p) { return p.name == decl.name; });
+            if (pos == mod.ports.end()) {
+                if (mod.error.empty()) mod.error = decl.name + " is not in the port list";
+            } else {
+                *pos = std::move(decl);
+            }
+        }
+        if (mod.error.empty()) mod.error = error;
+    }
+};
+
+std::map<std::string, VerilogModuleDecl> scan_verilog_modules(std::string_view src) {
+    VerilogModuleScanner scanner(src);
+    return scanner.scan();
+}
+
+// the on-disk index is a text file. strings are prefixed by their length, so that paths and
+// expressions can contain any character. lengths and counts read back are bounded by the bytes
+// left in the file, so that a corrupted index can't allocate arbitrary amounts of memory
+constexpr auto library_index_header = "kratos-library-index 1";
+
+uint64_t remaining_size(std::istream &in, uint64_t file_size) {
+    auto const pos = in.tellg();
+    if (pos < 0 || static_cast<uint64_t>(pos) > file_size) return 0;
+    return file_size - static_cast<uint64_t>(pos);
+}
+
+bool read_index_size(std::istream &in, uint64_t &size, uint64_t file_size) {
+    return (in >> size) && size <= remaining_size(in, file_size);
+}
+
+void write_index_string(std::ostream &out, const std::string &str) {
+    out << str.size() << ' ' << str << ' ';
+}
+
+bool read_index_string(std::istream &in, std::string &str, uint64_t file_size) {
+    uint64_t size;
+    if (!read_index_size(in, size, file_size) || in.get() != ' ') return false;
+    str.resize(size);
+    in.read(str.data(), static_cast<std::streamsize>(size));
+    return static_cast<bool>(in);
+}
+
+void write_index_dims(std::ostream &out,
+                      const std::vector<std::pair<std::string, std::string>> &dims) {
+    out << dims.size() << ' ';
+    for (auto const &[left, right] : dims) {
+        write_index_string(out, left);
+        write_index_string(out, right);
+    }
+}
+
+bool read_index_dims(std::istream &in, std::vector<std::pair<std::string, std::string>> &dims,
+                     uint64_t file_size) {
+    uint64_t size;
+    if (!read_index_size(in, size, file_size)) return false;
+    dims.resize(size);
+    for (auto &[left, right] : dims) {
+        if (!read_index_string(in, left, file_size) || !read_index_string(in, right, file_size))
+            return false;
+    }
+    return true;
+}
+
+void write_index_entry(std::ostream &out, const std::string &path, const VerilogFileInfo &info) {
+    write_index_string(out, path);
+    out << info.size << ' ' << info.last_write_time << ' ' << info.hash << ' '
+        << info.modules->size() << '\n';
+    for (auto const &[name, mod] : *info.modules) {
+        write_index_string(out, name);
+        write_index_string(out, mod.error);
+        out << mod.params.size() << ' ' << mod.ports.size() << '\n';
+        for (auto const &[param, value] : mod.params) {
+            write_index_string(out, param);
+            write_index_string(out, value);
+            out << '\n';
+        }
+        for (auto const &port : mod.ports) {
+            write_index_string(out, port.name);
+            out << static_cast<int>(port.direction) << ' ' << port.is_signed << ' ';
+            write_index_dims(out, port.packed_dims);
+            write_index_dims(out, port.unpacked_dims);
+            out << '\n';
+        }
+    }
+}
+
+bool read_index_entry(std::istream &in, std::string &path, VerilogFileInfo &info,
+                      uint64_t file_size) {
+    uint64_t num_modules;
+    if (!read_index_string(in, path, file_size) ||
+        !(in >> info.size >> info.last_write_time >> info.hash) ||
+        !read_index_size(in, num_modules, file_size)) {
+        return false;
+    }
+    auto modules = std::make_shared<std::map<std::string, VerilogModuleDecl>>();
+    for (uint64_t i = 0; i < num_modules; i++) {
+        VerilogModuleDecl mod;
+        uint64_t num_params, num_ports;
+        if (!read_index_string(in, mod.name, file_size) ||
+            !read_index_string(in, mod.error, file_size) ||
+            !read_index_size(in, num_params, file_size) ||
+            !read_index_size(in, num_ports, file_size)) {
+            return false;
+        }
+        mod.params.resize(num_params);
+        for (auto &[param, value] : mod.params) {
+            if (!read_index_string(in, param, file_size) ||
+                !read_index_string(in, value, file_size))
+                return false;
+        }
+        mod.ports.resize(num_ports);
+        for (auto &port : mod.ports) {
+            int direction;
+            if (!read_index_string(in, port.name, file_size) ||
+                !(in >> direction >> port.is_signed) ||
+                !read_index_dims(in, port.packed_dims, file_size) ||
+                !read_index_dims(in, port.unpacked_dims, file_size)) {
+                return false;
+            }
+            if (direction < static_cast<int>(PortDirection::In) ||
+                direction > static_cast<int>(PortDirection::InOut)) {
+                return false;
+            }
+            port.direction = static_cast<PortDirection>(direction);
+        }
+        auto name = mod.name;
+        modules->emplace(name, std::move(mod));
+    }
+    info.modules = std::move(modules);
+    return true;
+}
+
+VerilogLibraryIndex::VerilogLibraryIndex() {
+    auto const *filename = std::getenv("KRATOS_LIBRARY_INDEX");
+    if (filename) set_filename(filename);
+}
+
+VerilogLibraryIndex::~VerilogLibraryIndex() {
+    try {
+        if (dirty_) save();
+    } catch (...) {
+        // the index is only a cache
+    }
+}
+
+VerilogLibraryIndex &VerilogLibraryIndex::global() {
+    static VerilogLibraryIndex index;
+    return index;
+}
+
+std::shared_ptr<const VerilogFileInfo> VerilogLibraryIndex::get(const std::string &filename) {
+    auto const path = fs::abspath(filename);
+    auto const size = fs::file_size(path);
+    auto const last_write_time = fs::last_write_time(path);
+    std::shared_ptr<const VerilogFileInfo> entry;
+    {
+        std::lock_guard guard(mutex_);
+        auto it = files_.find(path);
+        if (it != files_.end()) {
+            entry = it->second;
+            if (entry->size == size && entry->last_write_time == last_write_time) return entry;
+        }
+    }
+    // the file is scanned without holding the lock. if several threads ask for the same file,
+    // all of them compute the same result
+    fs::MappedFile file(path);
+    auto const content = file.data();
+    auto info = std::make_shared<VerilogFileInfo>();
+    info->size = size;
+    info->last_write_time = last_write_time;
+    info->hash = hash_64_xx(content.data(), content.size());
+    // the file may only be touched
+    auto const changed = !entry || entry->size != size || entry->hash != info->hash;
+    if (changed) {
+        info->modules = std::make_shared<const std::map<std::string, VerilogModuleDecl>>(
+            scan_verilog_modules(content));
+    } else {
+        info->modules = entry->modules;
+    }
+
+    std::lock_guard guard(mutex_);
+    num_hashes_++;
+    if (changed) num_scans_++;
+    files_[path] = info;
+    dirty_ = true;
+    return info;
+}
+
+void VerilogLibraryIndex::set_filename(const std::string &filename) {
+    std::lock_guard guard(mutex_);
+    filename_ = filename;
+    if (!filename_.empty()) load(filename_);
+}
+
+void VerilogLibraryIndex::load(const std::string &filename) {
+    if (!fs::exists(filename)) return;
+    // parsed from memory, where the read position is cheap to query
+    std::stringstream in;
+    {
+        std::ifstream file(filename, std::ios::binary);
+        in << file.rdbuf();
+    }
+    auto const file_size = static_cast<uint64_t>(std::max<std::streamoff>(0, in.tellp()));
+    std::string header;
+    if (!std::getline(in, header) || header != library_index_header) return;
+    while (in >> std::ws && in.peek() != EOF) {
+        std::string path;
+        auto info = std::make_shared<VerilogFileInfo>();
+        // a truncated or corrupted file only loses the remaining entries
+        if (!read_index_entry(in, path, *info, file_size)) break;
+        // entries checked in this process are more recent
+        files_.emplace(path, std::move(info));
+    }
+}
+
+void VerilogLibraryIndex::save() {
+    std::lock_guard guard(mutex_);
+    if (filename_.empty()) return;
+    load(filename_);
+    // write to a temporary file first, so concurrent runs never see a partial index
+    auto const temp_filename = ::format("{0}.{1}.tmp", filename_, std::random_device()());
+    {
+        std::ofstream out(temp_filename, std::ios::binary | std::ios::trunc);
+        if (!out) throw UserException(::format("unable to write {0}", temp_filename));
+        out << library_index_header << '\n';
+        // sorted so that the index itself is stable
+        std::map<std::string, std::shared_ptr<const VerilogFileInfo>> entries(files_.begin(),
+                                                                               files_.end());
+        for (auto const &[path, info] : entries) write_index_entry(out, path, *info);
+        out.close();
+        if (!out) {
+            fs::remove(temp_filename);
+            throw UserException(::format("unable to write {0}", temp_filename));
+        }
+    }
+    if (!fs::rename(temp_filename, filename_)) {
+        fs::remove(temp_filename);
+        throw UserException(::format("unable to write {0}", filename_));
+    }
+    dirty_ = false;
+}
+
+void VerilogLibraryIndex::clear() {
+    std::lock_guard guard(mutex_);
+    files_.clear();
+    num_scans_ = 0;
+    num_hashes_ = 0;
+}
+
+uint64_t VerilogLibraryIndex::size() const {
+    std::lock_guard guard(mutex_);
+    return files_.size();
+}
+
+uint64_t VerilogLibraryIndex::num_scans() const {
+    std::lock_guard guard(mutex_);
+    return num_scans_;
+}
+
+uint64_t VerilogLibraryIndex::num_hashes() const {
+    std::lock_guard guard(mutex_);
+    return num_hashes_;
+}
+
+class VerilogExprEvaluator {
+public:
+    VerilogExprEvaluator(std::string_view expr, const std::map<std::string, int64_t> &params)
+        : expr_(expr), lexer_(expr), params_(params) {
+        token_ = lexer_.next();
+    }
+
+    int64_t eval() {
+        auto result = eval_binary(0);
+        if (token_.kind != TokenKind::End) error();
+        return result;
+    }
+
+private:
+    std::string_view expr_;
+    VerilogLexer lexer_;
+    const std::map<std::string, int64_t> &params_;
+    Token token_;
+
+    [[noreturn]] void error() const {
+        throw UserException(::format("unable to evaluate {0}", expr_));
+    }
+
+    void advance() { token_ = lexer_.next(); }
+
+    static int precedence(const Token &token) {
+        if (token.kind != TokenKind::Symbol) return -1;
+        static const std::map<std::string_view, int> precedences = {
+            {"<<", 1}, {">>", 1}, {"+", 2}, {"-", 2}, {"*", 3}, {"/", 3}, {"%", 3}, {"**", 4}};
+        auto it = precedences.find(token.text);
+        return it == precedences.end() ? -1 : it->second;
+    }
+
+    int64_t eval_binary(int min_precedence) {
+        auto left = eval_unary();
+        while (precedence(token_) > min_precedence) {
+            auto const op = token_.text;
+            auto const prec = precedence(token_);
+            advance();
+            // ** is right associative
+            auto const right = eval_binary(op == "**" ? prec - 1 : prec);
+            if (op == "+") {
+                left += right;
+            } else if (op == "-") {
+                left -= right;
+            } else if (op == "*") {
+                left *= right;
+            } else if (op == "/" || op == "%") {
+                if (right == 0) error();
+                left = op == "/" ? left / right : left % right;
+            } else if (op == "<<" || op == ">>") {
+                // shifting by 64 or more bits is undefined
+                if (right < 0) error();
+                if (op == "<<") {
+                    auto const shifted = static_cast<uint64_t>(left) << (right & 63);
+                    left = right >= 64 ? 0 : static_cast<int64_t>(shifted);
+                } else {
+                    left = right >= 64 ? (left < 0 ? -1 : 0) : left >> right;
+                }
+            } else {
+                // by squaring, so that a large exponent doesn't loop for ages
+                uint64_t base = static_cast<uint64_t>(left), value = 1;
+                for (auto exp = right > 0 ? static_cast<uint64_t>(right) : 0; exp; exp >>= 1u) {
+                    if (exp & 1u) value *= base;
+                    base *= base;
+                }
+                left = static_cast<int64_t>(value);
+            }
+        }
+        return left;
+    }
+
+    int64_t eval_unary() {
+        if (token_.is("-")) {
+            advance();
+            return -eval_unary();
+        }
+        if (token_.is("+")) {
+            advance();
+            return eval_unary();
+        }
+        if (token_.is("(")) {
+            advance();
+            auto result = eval_binary(0);
+            if (!token_.is(")")) error();
+            advance();
+            return result;
+        }
+        if (token_.kind == TokenKind::Number) {
+            auto const value = parse_number(token_.text);
+            advance();
+            return value;
+        }
+        if (token_.is("$clog2")) {
+            advance();
+            if (!token_.is("(")) error();
+            auto value = eval_unary();
+            // 1 << 63 is already negative
+            int64_t result = 0;
+            while (result < 63 && (int64_t(1) << result) < value) result++;
+            return result;
+        }
+        if (token_.kind == TokenKind::Identifier) {
+            auto it = params_.find(std::string(token_.text));
+            if (it == params_.end()) error();
+            advance();
+            return it->second;
+        }
+        error();
+    }
+
+    int64_t parse_number(std::string_view text) const {
+        std::string digits;
+        int base = 10;
+        auto const quote = text.find('\'');
+        if (quote != std::string_view::npos) {
+            auto i = quote + 1;
+            if (i < text.size() && (text[i] == 's' || text[i] == 'S')) i++;
+            if (i >= text.size()) error();
+            switch (std::tolower(text[i])) {
+                case 'b':
+                    base = 2;
+                    break;
+                case 'o':
+                    base = 8;
+                    break;
+                case 'd':
+                    base = 10;
+                    break;
+                case 'h':
+                    base = 16;
+                    break;
+                default:
+                    error();
+            }
+            text = text.substr(i + 1);
+        }
+        for (auto c : text) {
+            if (c != '_') digits.push_back(c);
+        }
+        if (digits.empty()) error();
+        uint64_t end = 0;
+        int64_t value;
+        try {
+            value = std::stoll(digits, &end, base);
+        } catch (const std::exception &) {
+            error();
+        }
+        // e.g. x/z digits or real numbers
+        if (end != digits.size()) error();
+        return value;
+    }
+};
+
+int64_t eval_verilog_expr(std::string_view expr, const std::map<std::string, int64_t> &params) {
+    VerilogExprEvaluator evaluator(expr, params);
+    return evaluator.eval();
+}
+
+}  // namespace kratos
@@ -1,14 +1,99 @@
 #ifndef KRATOS_SV_SYNTAX_HH
 #define KRATOS_SV_SYNTAX_HH
 
-#include <unordered_set>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace kratos {
 
+enum class PortDirection;
+
 // system verilog reserved keywords
 bool is_valid_variable_name(const std::string &name);
 
+// module headers found in SystemVerilog source. expressions, such as dimensions and parameter
+// values, are kept as written
+struct VerilogPortDecl {
+    std::string name;
+    PortDirection direction;
+    bool is_signed = false;
+    // [msb:lsb] pairs. unpacked [size] dimensions have an empty lsb
+    std::vector<std::pair<std::string, std::string>> packed_dims;
+    std::vector<std::pair<std::string, std::string>> unpacked_dims;
+};
+
+struct VerilogModuleDecl {
+    std::string name;
+    // parameter names and default values, in declaration order
+    std::vector<std::pair<std::string, std::string>> params;
+    // in port list order
+    std::vector<VerilogPortDecl> ports;
+    // first construct the scanner can't handle. it is only reported when the module is used
+    std::string error;
+};
+
+// single-pass scan over the source that indexes every module's parameters and ports, both
+// ANSI and non-ANSI style. conditional compilation is not evaluated, i.e. all the branches
+// are scanned
+std::map<std::string, VerilogModuleDecl> scan_verilog_modules(std::string_view src);
+
+struct VerilogFileInfo {
+    uint64_t size = 0;
+    uint64_t last_write_time = 0;
+    // xxhash of the content
+    uint64_t hash = 0;
+    std::shared_ptr<const std::map<std::string, VerilogModuleDecl>> modules;
+};
+
+// process-wide index of scanned library files, shared by every context. a file is re-hashed
+// if its size or modification time changes, and only re-scanned if its content changes.
+// the index can be stored on disk so that later runs skip unchanged files as well. it is
+// loaded from $KRATOS_LIBRARY_INDEX by default, and saved at exit if anything changed
+class VerilogLibraryIndex {
+public:
+    VerilogLibraryIndex();
+    VerilogLibraryIndex(const VerilogLibraryIndex &) = delete;
+    VerilogLibraryIndex &operator=(const VerilogLibraryIndex &) = delete;
+    ~VerilogLibraryIndex();
+
+    static VerilogLibraryIndex &global();
+
+    // scans the file if it's not in the index or has changed
+    std::shared_ptr<const VerilogFileInfo> get(const std::string &filename);
+
+    // empty filename disables the on-disk index. entries in the file are merged into the
+    // index
+    void set_filename(const std::string &filename);
+    [[nodiscard]] const std::string &filename() const { return filename_; }
+    // merges the on-disk entries written by other runs in the meantime before writing
+    void save();
+    void clear();
+    [[nodiscard]] uint64_t size() const;
+    // number of file scans and content hashes, for testing
+    [[nodiscard]] uint64_t num_scans() const;
+    [[nodiscard]] uint64_t num_hashes() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<const VerilogFileInfo>> files_;
+    std::string filename_;
+    bool dirty_ = false;
+    uint64_t num_scans_ = 0;
+    uint64_t num_hashes_ = 0;
+
+    void load(const std::string &filename);
+};
+
+// evaluates a constant integer expression, such as WIDTH - 1. identifiers are looked up in
+// params. throws UserException if the expression is not supported
+int64_t eval_verilog_expr(std::string_view expr, const std::map<std::string, int64_t> &params);
+
 }  // namespace kratos
 
 #endif  // KRATOS_SV_SYNTAX_HH
@@ -1,12 +1,20 @@
 #include "util.hh"
 
+#include <atomic>
 #include <cstdlib>
+#include <ctime>
 #ifdef INCLUDE_FILESYSTEM
 #include <filesystem>
 #endif
 #include <fstream>
-#include <regex>
 #include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "except.hh"
 #include "expr.hh"
@@ -14,23 +22,55 @@
 #include "generator.hh"
 #include "port.hh"
 #include "stmt.hh"
+#include "syntax.hh"
 
 using fmt::format;
 
 namespace kratos {
 
-static int _num_cpu = -1;
+// set from python while passes run with the GIL released
+static std::atomic<int> _num_cpu = -1;
 
 uint32_t get_num_cpus() {
-    if (_num_cpu < 0) {
+    auto num_cpu = _num_cpu.load();
+    if (num_cpu < 0) {
         // compute the number of CPUs being used
         uint32_t num_cpus = std::thread::hardware_concurrency();
-        _num_cpu = static_cast<int>(std::max(1u, num_cpus / 2));
+        num_cpu = static_cast<int>(std::max(1u, num_cpus / 2));
+        _num_cpu = num_cpu;
     }
-    return static_cast<uint32_t>(_num_cpu);
+    return static_cast<uint32_t>(num_cpu);
 }
 void set_num_cpus(int num_cpu) { _num_cpu = num_cpu; }
 
+uint64_t get_peak_rss() {
+#ifdef _WIN32
+    return 0;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    // linux reports it in KiB
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+double get_cpu_time() {
+#ifdef _WIN32
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto to_seconds = [](const timeval &t) {
+        return static_cast<double>(t.tv_sec) + static_cast<double>(t.tv_usec) / 1e6;
+    };
+    return to_seconds(usage.ru_utime) + to_seconds(usage.ru_stime);
+#endif
+}
+
 std::string ExprOpStr(ExprOp op) {
     switch (op) {
         case ExprOp::UInvert:
@@ -267,84 +307,6 @@ void remove_stmt_from_parent(const std::shared_ptr<Stmt> &stmt) {
     }
 }
 
-std::map<std::string, std::shared_ptr<Port>> get_port_from_mod_def(Generator *generator,
-                                                                   const std::string &mod_def) {
-    std::map<std::string, std::shared_ptr<Port>> result;
-    std::unordered_set<std::string> ignore_list = {"logic", "reg", "wire"};
-    std::regex re("(input|output)\\s?([\\w,\\s_$\\[\\]:])+", std::regex::ECMAScript);  // NOLINT
-    std::smatch match;
-    std::string::const_iterator iter = mod_def.cbegin();
-    while (std::regex_search(iter, mod_def.end(), match, re)) {
-        if (match.size() > 1) {
-            std::string port_declaration = std::string(match[0].first, match[0].second);
-            std::vector<std::string> const tokens = string::get_tokens(port_declaration, ", ");
-            // the first one has to be either input or output
-            if (tokens.size() < 2)
-                throw std::runtime_error(::format("unable to parse {}", port_declaration));
-            std::string input_type = tokens[0];
-            PortDirection direction;
-            if (input_type == "input")
-                direction = PortDirection::In;
-            else if (input_type == "output")
-                direction = PortDirection::Out;
-            else
-                throw std::runtime_error(
-                    ::format("{} has to be either input or output", input_type));
-            // determine the reset
-            uint32_t i = 1;
-            uint32_t high = 0;
-            uint32_t low = 0;
-            while (i < tokens.size()) {
-                auto token = tokens[i];
-                if (token.empty()) {
-                    i++;
-                    continue;
-                }
-                if (token[0] == '[' && token[token.size() - 1] != ']') {
-                    token.append(tokens[++i]);
-                }
-                if (token[0] == '[' && token[token.size() - 1] == ']') {
-                    // determine the size
-                    std::vector<std::string> size_tokens = string::get_tokens(token, "[:] ");
-                    if (size_tokens.size() != 2)
-                        throw std::runtime_error(::format("unable to parse {}", token));
-                    high = std::stoi(size_tokens[0]);
-                    low = std::stoi(size_tokens[1]);
-                    if (high < low)
-                        throw std::runtime_error(
-                            ::format("only [hi:lo] is supported, got [{}:{}]", high, low));
-                } else {
-                    if (token[0] == '[')
-                        throw std::runtime_error(::format("unable to parse {}", port_declaration));
-                    if (token == "input") {
-                        direction = PortDirection::In;
-                        i++;
-                        continue;
-                    } else if (token == "output") {
-                        direction = PortDirection::Out;
-                        i++;
-                        continue;
-                    } else if (token == "inout") {
-                        direction = PortDirection ::InOut;
-                        i++;
-                        continue;
-                    }
-                    const auto &port_name = token;
-                    uint32_t width = high - low + 1;
-                    auto p = std::make_shared<Port>(generator, direction, port_name, width, 1,
-                                                    PortType::Data, false);
-                    result.emplace(port_name, p);
-                }
-
-                i++;
-            }
-        }
-        iter = match[0].second;
-    }
-    return result;
-}
-
-
 std::vector<std::vector<uint32_t>> get_flatten_slices(Var *var) {
     uint32_t num_slices = var->width() / var->var_width();
     std::vector<std::vector<uint32_t>> result;
@@ -365,26 +327,65 @@ std::vector<std::vector<uint32_t>> get_flatten_slices(Var *var) {
     return result;
 }
 
-std::map<std::string, std::shared_ptr<Port>> get_port_from_verilog(Generator *generator,
-                                                                   const std::string &src,
-                                                                   const std::string &top_name) {
-    std::regex re("module\\s+([\\w_$]+)[\\w\\W]*?endmodule", std::regex::ECMAScript);  // NOLINT
-    std::smatch match;
-    std::string::const_iterator iter = src.cbegin();
-    std::string module_def;
-    while (std::regex_search(iter, src.end(), match, re)) {
-        if (match.size() > 1) {
-            std::string module_name = std::string(match[1].first, match[1].second);
-            if (module_name == top_name) {
-                module_def = std::string(match[0].first, match[0].second);
-                break;
+std::map<std::string, std::shared_ptr<Port>> get_port_from_module_decl(
+    Generator *generator, const VerilogModuleDecl &mod) {
+    if (!mod.error.empty())
+        throw UserException(::format("unable to parse module {0}: {1}", mod.name, mod.error));
+    // parameters are evaluated with their default values. the ones that can't be evaluated,
+    // e.g. type parameters, are only reported if a port uses them
+    std::map<std::string, int64_t> params;
+    for (auto const &[name, value] : mod.params) {
+        try {
+            params.emplace(name, eval_verilog_expr(value, params));
+        } catch (const UserException &) {
+        }
+    }
+    std::map<std::string, std::shared_ptr<Port>> result;
+    for (auto const &decl : mod.ports) {
+        uint32_t width = 1;
+        for (auto const &[msb, lsb] : decl.packed_dims) {
+            auto const high = eval_verilog_expr(msb, params);
+            auto const low = eval_verilog_expr(lsb, params);
+            if (high < low)
+                throw UserException(::format("only [hi:lo] is supported, got [{0}:{1}]", high, low));
+            width *= static_cast<uint32_t>(high - low + 1);
+        }
+        std::vector<uint32_t> size;
+        for (auto const &[left, right] : decl.unpacked_dims) {
+            auto const l = eval_verilog_expr(left, params);
+            if (right.empty()) {
+                size.emplace_back(static_cast<uint32_t>(l));
+            } else {
+                auto const r = eval_verilog_expr(right, params);
+                size.emplace_back(static_cast<uint32_t>(std::abs(l - r) + 1));
             }
         }
-        iter = match[0].second;
+        if (size.empty()) size.emplace_back(1);
+        auto p = std::make_shared<Port>(generator, decl.direction, decl.name, width, size,
+                                        PortType::Data, decl.is_signed);
+        result.emplace(decl.name, p);
     }
-    if (module_def.empty())
-        throw std::runtime_error(::format("Unable to find {} definition", top_name));
-    return get_port_from_mod_def(generator, module_def);
+    return result;
+}
+
+std::map<std::string, std::shared_ptr<Port>> get_port_from_verilog(Generator *generator,
+                                                                   const std::string &src,
+                                                                   const std::string &top_name) {
+    auto const modules = scan_verilog_modules(src);
+    auto it = modules.find(top_name);
+    if (it == modules.end())
+        throw UserException(::format("Unable to find {} definition", top_name));
+    return get_port_from_module_decl(generator, it->second);
+}
+
+std::map<std::string, std::shared_ptr<Port>> get_port_from_verilog_file(
+    Generator *generator, const std::string &filename, const std::string &top_name) {
+    auto const info = VerilogLibraryIndex::global().get(filename);
+    auto const &modules = *info->modules;
+    auto it = modules.find(top_name);
+    if (it == modules.end())
+        throw UserException(::format("Unable to find {0} definition in {1}", top_name, filename));
+    return get_port_from_module_decl(generator, it->second);
 }
 
 std::vector<std::string> line_wrap(const std::string &text, uint32_t line_width) {
@@ -529,6 +530,19 @@ bool remove(const std::string &filename) {
 #endif
 }
 
+bool rename(const std::string &from, const std::string &to) {
+#if defined(INCLUDE_FILESYSTEM)
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::rename(from, to, ec);
+    return !ec;
+#else
+    // windows doesn't allow renaming to an existing file
+    std::remove(to.c_str());
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
 std::string temp_directory_path() {
 #if defined(INCLUDE_FILESYSTEM)
     namespace fs = std::filesystem;
@@ -574,6 +588,61 @@ std::string basename(const std::string &filename) {
 #endif
 }
 
+uint64_t file_size(const std::string &filename) {
+#if defined(INCLUDE_FILESYSTEM)
+    return std::filesystem::file_size(filename);
+#else
+    std::ifstream in(filename, std::ios::ate | std::ios::binary);
+    return static_cast<uint64_t>(in.tellg());
+#endif
+}
+
+uint64_t last_write_time(const std::string &filename) {
+#ifdef _WIN32
+    struct _stat64 info {};
+    if (_stat64(filename.c_str(), &info) != 0) return 0;
+    return static_cast<uint64_t>(info.st_mtime) * 1000000000ull;
+#elif defined(__APPLE__)
+    struct stat info {};
+    if (stat(filename.c_str(), &info) != 0) return 0;
+    return static_cast<uint64_t>(info.st_mtimespec.tv_sec) * 1000000000ull +
+           info.st_mtimespec.tv_nsec;
+#else
+    struct stat info {};
+    if (stat(filename.c_str(), &info) != 0) return 0;
+    return static_cast<uint64_t>(info.st_mtim.tv_sec) * 1000000000ull + info.st_mtim.tv_nsec;
+#endif
+}
+
+MappedFile::MappedFile(const std::string &filename) {
+#ifndef _WIN32
+    auto fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw UserException(::format("unable to open {0}", filename));
+    struct stat info {};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        auto *ptr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+            data_ = static_cast<const char *>(ptr);
+            size_ = info.st_size;
+        }
+    }
+    close(fd);
+    // empty files can't be mapped
+    if (data_ || info.st_size == 0) return;
+#endif
+    std::ifstream stream(filename, std::ios::binary);
+    if (!stream) throw UserException(::format("unable to open {0}", filename));
+    buffer_.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (buffer_.empty() && size_) munmap(const_cast<char *>(data_), size_);
+#endif
+}
+
 char separator() {
 #ifdef _WIN32
     return '\\';
@@ -4,8 +4,8 @@
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
-#include <regex>
 #include <sstream>
+#include <string_view>
 #include <thread>
 
 #include "except.hh"
@@ -19,6 +19,9 @@ namespace kratos {
 
 uint32_t get_num_cpus();
 void set_num_cpus(int num_cpu);
+// resource usage of the current process. peak RSS is in bytes and cpu time in seconds
+uint64_t get_peak_rss();
+double get_cpu_time();
 
 std::string ExprOpStr(ExprOp op);
 
@@ -50,6 +53,10 @@ std::vector<std::vector<uint32_t>> get_flatten_slices(Var *var);
 std::map<std::string, std::shared_ptr<Port>> get_port_from_verilog(Generator *generator,
                                                                    const std::string &src,
                                                                    const std::string &top_name);
+// same as above, but the module definitions come from the library index, which only scans the
+// file if it has changed
+std::map<std::string, std::shared_ptr<Port>> get_port_from_verilog_file(
+    Generator *generator, const std::string &filename, const std::string &top_name);
 
 bool inline is_2_power(uint64_t num) { return (num && (!(num & (num - 1)))); }
 
@@ -71,11 +78,32 @@ std::string join(const std::string &path1, const std::string &path2);
 std::string which(const std::string &name);
 bool exists(const std::string &filename);
 bool remove(const std::string &filename);
+bool rename(const std::string &from, const std::string &to);
 std::string temp_directory_path();
 std::string get_ext(const std::string &filename);
 std::string abspath(const std::string &filename);
 std::string basename(const std::string &filename);
+uint64_t file_size(const std::string &filename);
+// nanoseconds since epoch
+uint64_t last_write_time(const std::string &filename);
 char separator();
+
+// read-only file content. it is memory-mapped where possible
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &filename);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    [[nodiscard]] std::string_view data() const { return {data_, size_}; }
+
+private:
+    const char *data_ = nullptr;
+    uint64_t size_ = 0;
+    // used if the file can't be mapped
+    std::string buffer_;
+};
 }  // namespace fs
 
 namespace string {
@@ -0,0 +1,38 @@
+#ifndef KRATOS_BENCH_HH
+#define KRATOS_BENCH_HH
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+
+namespace kratos::bench {
+
+// integer argument at index, or the default value
+inline uint32_t arg(int argc, char **argv, int index, uint32_t value) {
+    return argc > index ? static_cast<uint32_t>(std::stoul(argv[index])) : value;
+}
+
+// best of num_runs wall-clock times, in seconds
+inline double measure(const std::function<void()> &fn, uint32_t num_runs = 3) {
+    double best = 0;
+    for (uint32_t i = 0; i < num_runs; i++) {
+        auto const start = std::chrono::steady_clock::now();
+        fn();
+        auto const time =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = i == 0 ? time : std::min(best, time);
+    }
+    return best;
+}
+
+inline void report(const std::string &name, double seconds) {
+    std::cout << name << ": " << seconds * 1000 << " ms" << std::endl;
+}
+
+}  // namespace kratos::bench
+
+#endif  // KRATOS_BENCH_HH
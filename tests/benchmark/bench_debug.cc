@@ -0,0 +1,91 @@
+// debug information collection and database write on a flat design with many children.
+// usage: bench_debug [num_children] [num_cpus]
+
+#include <sqlite3.h>
+
+#include <iostream>
+#include <thread>
+
+#include "../../src/debug.hh"
+#include "../../src/generator.hh"
+#include "../../src/pass.hh"
+#include "../../src/util.hh"
+#include "bench.hh"
+
+using namespace kratos;
+
+namespace {
+
+uint64_t count_rows(const std::string &filename) {
+    sqlite3 *db;
+    sqlite3_open(filename.c_str(), &db);
+    uint64_t result = 0;
+    for (auto const *table : {"metadata", "breakpoint", "variable", "connection", "hierarchy",
+                              "context", "instance", "instance_set"}) {
+        sqlite3_stmt *stmt;
+        auto const sql = std::string("SELECT COUNT(*) FROM ") + table;
+        sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+        if (sqlite3_step(stmt) == SQLITE_ROW) result += sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return result;
+}
+
+void collect(Generator *top, const std::map<Generator *, std::map<std::string, Var *>> &mapping,
+             const std::string &label) {
+    DebugDatabase db("top");
+    bench::report(label + " set_break_points",
+                  bench::measure([&]() { db.set_break_points(top); }, 1));
+    bench::report(label + " set_variable_mapping",
+                  bench::measure([&]() { db.set_variable_mapping(mapping); }, 1));
+    bench::report(label + " set_generator_connection",
+                  bench::measure([&]() { db.set_generator_connection(top); }));
+    bench::report(label + " set_generator_hierarchy",
+                  bench::measure([&]() { db.set_generator_hierarchy(top); }));
+    bench::report(label + " set_stmt_context",
+                  bench::measure([&]() { db.set_stmt_context(top); }, 1));
+    auto const time = bench::measure([&]() { db.save_database("bench_debug.db"); });
+    auto const num_rows = count_rows("bench_debug.db");
+    std::cout << label << " save_database: " << time * 1000 << " ms, " << num_rows << " rows, "
+              << static_cast<uint64_t>(num_rows / time) << " rows/s" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    auto const num_children = bench::arg(argc, argv, 1, 2000);
+    auto const num_cpus = bench::arg(argc, argv, 2, std::thread::hardware_concurrency());
+
+    Context context;
+    auto &top = context.generator("top");
+    top.debug = true;
+    auto &in = top.port(PortDirection::In, "in", 8);
+    std::map<Generator *, std::map<std::string, Var *>> mapping;
+    for (uint32_t i = 0; i < num_children; i++) {
+        auto &child = context.generator("child" + std::to_string(i));
+        child.debug = true;
+        auto &child_in = child.port(PortDirection::In, "in", 8);
+        auto &child_out = child.port(PortDirection::Out, "out", 8);
+        auto &array = child.var("array", 8, 256);
+        auto comb = child.combinational();
+        for (int j = 0; j < 20; j++) {
+            auto stmt = array[j].assign(child_in, AssignmentType::Blocking);
+            stmt->fn_name_ln.emplace_back("bench.py", j);
+            comb->add_stmt(stmt);
+        }
+        child.add_stmt(child_out.assign(array[0]));
+        mapping[&child] = {{"self.in", &child_in}, {"self.array", &array}};
+        top.add_child_generator("inst" + std::to_string(i), child.shared_from_this());
+        top.add_stmt(child_in.assign(in));
+    }
+    inject_instance_ids(&top);
+    inject_debug_break_points(&top);
+    create_module_instantiation(&top);
+
+    set_num_cpus(1);
+    collect(&top, mapping, "serial");
+    set_num_cpus(static_cast<int>(num_cpus));
+    collect(&top, mapping, "parallel(" + std::to_string(num_cpus) + ")");
+    return 0;
+}
@@ -0,0 +1,51 @@
+// variable sink and source storage on a long chain of one-bit wires, where every variable has
+// one sink and one source.
+// usage: bench_edges [num_wires]
+
+#include <iostream>
+
+#include "../../src/generator.hh"
+#include "../../src/stmt.hh"
+#include "../../src/util.hh"
+#include "bench.hh"
+
+using namespace kratos;
+
+int main(int argc, char **argv) {
+    auto const num_wires = bench::arg(argc, argv, 1, 1000000);
+    constexpr uint32_t num_sweeps = 10;
+
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &in = mod.port(PortDirection::In, "in", 1);
+    std::vector<Var *> wires;
+    wires.reserve(num_wires);
+    auto const rss = get_peak_rss();
+    bench::report("build", bench::measure(
+                               [&]() {
+                                   Var *prev = &in;
+                                   for (uint32_t i = 0; i < num_wires; i++) {
+                                       auto &wire = mod.var("w" + std::to_string(i), 1);
+                                       mod.add_stmt(wire.assign(*prev));
+                                       wires.emplace_back(&wire);
+                                       prev = &wire;
+                                   }
+                               },
+                               1));
+    std::cout << "peak rss: " << (get_peak_rss() - rss) / (1u << 20u) << " MiB" << std::endl;
+
+    uint64_t count = 0;
+    bench::report("sweep", bench::measure([&]() {
+                      for (uint32_t i = 0; i < num_sweeps; i++) {
+                          for (auto *wire : wires) {
+                              for (auto const &stmt : wire->sinks()) {
+                                  count += stmt->left() != wire;
+                              }
+                              for (auto const &stmt : wire->sources()) {
+                                  count += stmt->left() == wire;
+                              }
+                          }
+                      }
+                  }));
+    return count == 0;
+}
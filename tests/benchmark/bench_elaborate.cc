@@ -0,0 +1,48 @@
+// building and tearing down a design with many small ir nodes.
+// usage: bench_elaborate [num_children] [num_stmts]
+
+#include <iostream>
+
+#include "../../src/generator.hh"
+#include "../../src/stmt.hh"
+#include "../../src/util.hh"
+#include "bench.hh"
+
+using namespace kratos;
+
+int main(int argc, char **argv) {
+    auto const num_children = bench::arg(argc, argv, 1, 50);
+    auto const num_stmts = bench::arg(argc, argv, 2, 4000);
+    constexpr uint32_t num_vars = 64;
+
+    auto const rss = get_peak_rss();
+    auto context = std::make_unique<Context>();
+    bench::report("build", bench::measure(
+                               [&]() {
+                                   auto &top = context->generator("top");
+                                   for (uint32_t i = 0; i < num_children; i++) {
+                                       auto &child =
+                                           context->generator("child" + std::to_string(i));
+                                       auto comb = child.combinational();
+                                       std::vector<Var *> vars;
+                                       for (uint32_t j = 0; j < num_vars; j++) {
+                                           vars.emplace_back(
+                                               &child.var("v" + std::to_string(j), 16));
+                                       }
+                                       for (uint32_t j = 0; j < num_stmts; j++) {
+                                           auto &left = child.var("x" + std::to_string(j), 1);
+                                           auto &right = (*vars[j % num_vars] +
+                                                          *vars[(j * 7) % num_vars])
+                                                             .r_or() ^
+                                                         (*vars[(j * 13) % num_vars])[j % 16];
+                                           comb->add_stmt(left.assign(right));
+                                       }
+                                       top.add_child_generator("inst" + std::to_string(i),
+                                                               child.shared_from_this());
+                                   }
+                               },
+                               1));
+    std::cout << "peak rss: " << (get_peak_rss() - rss) / (1u << 20u) << " MiB" << std::endl;
+    bench::report("teardown", bench::measure([&]() { context.reset(); }, 1));
+    return 0;
+}
@@ -0,0 +1,64 @@
+// generator hashing on large generators with nested expressions and if statements.
+// usage: bench_hash [num_generators] [num_stmts]
+
+#include <iostream>
+
+#include "../../src/generator.hh"
+#include "../../src/pass.hh"
+#include "../../src/stmt.hh"
+#include "bench.hh"
+
+using namespace kratos;
+
+int main(int argc, char **argv) {
+    auto const num_generators = bench::arg(argc, argv, 1, 2);
+    auto const num_stmts = bench::arg(argc, argv, 2, 20000);
+
+    Context context;
+    std::vector<Generator *> generators;
+    for (uint32_t i = 0; i < num_generators; i++) {
+        auto &mod = context.generator("mod");
+        auto &in = mod.port(PortDirection::In, "in", 32);
+        auto &sel = mod.port(PortDirection::In, "sel", 4);
+        auto comb = mod.combinational();
+        Var *prev = &in;
+        for (uint32_t j = 0; j < num_stmts; j++) {
+            auto &var = mod.var("v" + std::to_string(j), 32);
+            auto &expr = ((*prev) + constant(j % 100, 32)) ^
+                         ((*prev)[{15, 0}].concat(in[{31, 16}]));
+            if (j % 2 == 0) {
+                auto &predicate = (expr + (*prev)[{31, 0}]).eq(in - constant(j % 16, 32)) |
+                                  sel.eq(constant(j % 16, 4));
+                auto if_ = std::make_shared<IfStmt>(predicate);
+                if_->add_then_stmt(var.assign(expr));
+                if_->add_else_stmt(var.assign(*prev));
+                comb->add_stmt(if_);
+            } else {
+                mod.add_stmt(var.assign(expr));
+            }
+            prev = &var;
+        }
+        generators.emplace_back(&mod);
+    }
+
+    bench::report("hash", bench::measure([&]() {
+                      for (auto *generator : generators) {
+                          context.clear_hash();
+                          generator->mark_dirty();
+                          hash_generators(generator, HashStrategy::SequentialHash);
+                      }
+                  }));
+    // identical generators have to hash the same. every call only keeps the hashes of its own
+    // hierarchy
+    std::vector<uint64_t> hashes;
+    for (auto *generator : generators) {
+        generator->mark_dirty();
+        hash_generators(generator, HashStrategy::SequentialHash);
+        hashes.emplace_back(context.get_hash(generator));
+    }
+    if (std::count(hashes.begin(), hashes.end(), hashes[0]) != num_generators) {
+        std::cerr << "identical generators hash differently" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+// variable creation and name lookups. peak rss only grows, so each layout runs on its own.
+// usage: bench_names shared|wide
+//   shared: 2000 generators with the same 200 variable names
+//   wide:   a single generator with 200k variables
+
+#include <iostream>
+
+#include "../../src/generator.hh"
+#include "../../src/util.hh"
+#include "bench.hh"
+
+using namespace kratos;
+
+int main(int argc, char **argv) {
+    auto const layout = std::string(argc > 1 ? argv[1] : "shared");
+    uint32_t num_generators = 2000, num_vars = 200, num_runs = 10;
+    if (layout == "wide") {
+        num_generators = 1;
+        num_vars = 200000;
+    } else if (layout != "shared") {
+        std::cerr << "unknown layout " << layout << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    for (uint32_t i = 0; i < num_vars; i++) {
+        names.emplace_back("data_path_wire_" + std::to_string(i));
+    }
+
+    Context context;
+    std::vector<Generator *> generators;
+    auto const rss = get_peak_rss();
+    bench::report("create", bench::measure(
+                                [&]() {
+                                    for (uint32_t i = 0; i < num_generators; i++) {
+                                        auto &mod = context.generator("mod" + std::to_string(i));
+                                        generators.emplace_back(&mod);
+                                        for (auto const &name : names) mod.var(name, 1);
+                                    }
+                                },
+                                1));
+    std::cout << "peak rss: " << (get_peak_rss() - rss) / (1u << 20u) << " MiB" << std::endl;
+
+    uint64_t found = 0;
+    bench::report("has_var", bench::measure([&]() {
+                      for (uint32_t run = 0; run < num_runs; run++) {
+                          for (auto *mod : generators) {
+                              for (auto const &name : names) found += mod->has_var(name);
+                          }
+                      }
+                  }));
+    bench::report("vars", bench::measure([&]() {
+                      for (auto *mod : generators) found += mod->vars().size();
+                  }));
+    return found == 0;
+}
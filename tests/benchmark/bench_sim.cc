@@ -0,0 +1,69 @@
+// compiled simulator with serial and parallel evaluation on a top with many independent
+// children.
+// usage: bench_sim [num_children] [num_stmts] [num_cycles] [num_cpus]
+
+#include <iostream>
+#include <thread>
+
+#include "../../src/sim.hh"
+#include "../../src/util.hh"
+#include "bench.hh"
+
+using namespace kratos;
+
+int main(int argc, char **argv) {
+    auto const num_children = bench::arg(argc, argv, 1, 256);
+    auto const num_stmts = bench::arg(argc, argv, 2, 100);
+    auto const num_cycles = bench::arg(argc, argv, 3, 200);
+    auto const num_cpus = bench::arg(argc, argv, 4, std::thread::hardware_concurrency());
+
+    Context context;
+    auto &top = context.generator("top");
+    auto &clk = top.port(PortDirection::In, "clk", 1);
+    auto &in = top.port(PortDirection::In, "in", 32);
+    std::vector<Var *> outputs;
+    for (uint32_t i = 0; i < num_children; i++) {
+        auto &child = context.generator("child" + std::to_string(i));
+        auto &child_clk = child.port(PortDirection::In, "clk", 1);
+        auto &child_in = child.port(PortDirection::In, "in", 32);
+        // a chain of combinational assignments, so that every child is one partition
+        Var *prev = &child_in;
+        for (uint32_t j = 0; j < num_stmts; j++) {
+            auto &var = child.var("v" + std::to_string(j), 32);
+            child.add_stmt(var.assign((*prev) * constant(j + 3, 32) + constant(i, 32)));
+            prev = &var;
+        }
+        auto &acc = child.var("acc", 32);
+        auto seq = child.sequential();
+        seq->add_condition({BlockEdgeType::Posedge, child_clk.shared_from_this()});
+        seq->add_stmt(acc.assign(*prev));
+        outputs.emplace_back(&acc);
+        top.add_child_generator("inst" + std::to_string(i), child.shared_from_this());
+        top.add_stmt(child_clk.assign(clk));
+        top.add_stmt(child_in.assign(in));
+    }
+
+    uint64_t checksum[2] = {0, 0};
+    for (auto parallel : {false, true}) {
+        set_num_cpus(parallel ? static_cast<int>(num_cpus) : 1);
+        CompiledSimulator sim(&top);
+        sim.set_parallel(parallel);
+        auto const label =
+            parallel ? "parallel(" + std::to_string(num_cpus) + ")" : std::string("serial");
+        bench::report(label, bench::measure(
+                                 [&]() {
+                                     for (uint32_t cycle = 0; cycle < num_cycles; cycle++) {
+                                         sim.set(&in, cycle);
+                                         sim.set(&clk, 1);
+                                         sim.set(&clk, 0);
+                                     }
+                                 },
+                                 1));
+        for (auto *var : outputs) checksum[parallel] += sim.get(var).value_or(0);
+    }
+    if (checksum[0] != checksum[1]) {
+        std::cerr << "serial and parallel results differ" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+// node marks against the per-visitor visited set, on a design with many shared variables.
+// usage: bench_visitor [num_children] [num_stmts] [num_cpus]
+
+#include <thread>
+
+#include "../../src/generator.hh"
+#include "../../src/pass.hh"
+#include "../../src/stmt.hh"
+#include "../../src/util.hh"
+#include "bench.hh"
+
+using namespace kratos;
+
+namespace {
+
+class CountVisitor : public IRVisitor {
+public:
+    explicit CountVisitor(bool node_marks) {
+        if (node_marks) use_node_marks();
+    }
+
+    void visit(Var *) override { count++; }
+    void visit(Expr *) override { count++; }
+    void visit(AssignStmt *) override { count++; }
+
+    uint64_t count = 0;
+};
+
+void run_checks(Generator *top, const std::string &label) {
+    bench::report(label + " checks", bench::measure([&]() {
+                      check_non_synthesizable_content(top);
+                      check_active_high(top);
+                      check_always_sensitivity(top);
+                      check_combinational_loop(top);
+                  }));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    auto const num_children = bench::arg(argc, argv, 1, 50);
+    auto const num_stmts = bench::arg(argc, argv, 2, 4000);
+    auto const num_cpus = bench::arg(argc, argv, 3, std::thread::hardware_concurrency());
+    constexpr uint32_t num_vars = 64;
+
+    Context context;
+    auto &top = context.generator("top");
+    for (uint32_t i = 0; i < num_children; i++) {
+        auto &child = context.generator("child" + std::to_string(i));
+        auto comb = child.combinational();
+        std::vector<Var *> vars;
+        for (uint32_t j = 0; j < num_vars; j++) {
+            vars.emplace_back(&child.var("v" + std::to_string(j), 16));
+        }
+        for (uint32_t j = 0; j < num_stmts; j++) {
+            auto &left = child.var("x" + std::to_string(j), 16);
+            auto &right = (*vars[j % num_vars] + *vars[(j * 7) % num_vars]) ^
+                          *vars[(j * 13) % num_vars];
+            comb->add_stmt(left.assign(right));
+        }
+        top.add_child_generator("inst" + std::to_string(i), child.shared_from_this());
+    }
+
+    for (auto node_marks : {false, true}) {
+        bench::report(node_marks ? "node marks" : "visited set", bench::measure([&]() {
+                          CountVisitor visitor(node_marks);
+                          visitor.visit_root(&top);
+                      }));
+    }
+    // the check passes visit the generators in parallel, and only one visitor can own the
+    // node marks at a time
+    set_num_cpus(1);
+    run_checks(&top, "serial");
+    set_num_cpus(static_cast<int>(num_cpus));
+    run_checks(&top, "parallel(" + std::to_string(num_cpus) + ")");
+    return 0;
+}
@@ -1,8 +1,12 @@
+#include <sqlite3.h>
+
 #include "../src/debug.hh"
+#include "../src/debug_symbols.hh"
 #include "../src/except.hh"
 #include "../src/generator.hh"
 #include "../src/pass.hh"
 #include "../src/stmt.hh"
+#include "../src/util.hh"
 #include "gtest/gtest.h"
 
 using namespace kratos;
@@ -62,4 +66,150 @@ TEST(debug, clock_breakpoint) {  // NOLINT
     EXPECT_EQ(block->size(), 1);
     EXPECT_EQ(block->block_type(), StatementBlockType::Sequential);
     EXPECT_EQ((*block)[0]->type(), StatementType::FunctionalCall);
-}
\ No newline at end of file
+}
+
+TEST(debug, save_database) {  // NOLINT
+    Context c;
+    auto &top = c.generator("top");
+    top.debug = true;
+    auto &in = top.port(PortDirection::In, "in", 8);
+    std::map<Generator *, std::map<std::string, Var *>> mapping;
+    // more rows than a single insert batch
+    constexpr uint32_t num_children = 150;
+    for (uint32_t i = 0; i < num_children; i++) {
+        auto &child = c.generator("child" + std::to_string(i));
+        child.debug = true;
+        auto &child_in = child.port(PortDirection::In, "in", 8);
+        auto &child_out = child.port(PortDirection::Out, "out", 8);
+        auto &array = child.var("array", 8, 2);
+        auto stmt = array[0].assign(child_in, AssignmentType::Blocking);
+        stmt->fn_name_ln.emplace_back("test.py", i);
+        child.combinational()->add_stmt(stmt);
+        child.add_stmt(child_out.assign(array[0]));
+        mapping[&child] = {{"self.in", &child_in}, {"self.array", &array}};
+        top.add_child_generator("inst" + std::to_string(i), child.shared_from_this());
+        top.add_stmt(child_in.assign(in));
+        auto &out = top.port(PortDirection::Out, "out" + std::to_string(i), 8);
+        top.add_stmt(out.assign(child_out));
+    }
+
+    inject_instance_ids(&top);
+    inject_debug_break_points(&top);
+    create_module_instantiation(&top);
+    // collected in parallel
+    auto const break_points = extract_debug_break_points(&top);
+    EXPECT_EQ(break_points.size(), num_children);
+    DebugDatabase db("top");
+    db.set_break_points(&top);
+    db.set_variable_mapping(mapping);
+    db.set_generator_connection(&top);
+    db.set_generator_hierarchy(&top);
+    db.set_stmt_context(&top);
+    auto const filename = fs::join(fs::temp_directory_path(), "kratos_debug_save.db");
+    db.save_database(filename);
+
+    sqlite3 *conn;
+    ASSERT_EQ(sqlite3_open(filename.c_str(), &conn), SQLITE_OK);
+    auto count = [&](const std::string &sql) {
+        sqlite3_stmt *stmt;
+        sqlite3_prepare_v2(conn, sql.c_str(), -1, &stmt, nullptr);
+        sqlite3_step(stmt);
+        auto result = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+        return result;
+    };
+    EXPECT_EQ(count("SELECT COUNT(*) FROM instance"), num_children + 1);
+    EXPECT_EQ(count("SELECT COUNT(*) FROM hierarchy"), num_children);
+    // hierarchy is stored in the instantiation order
+    EXPECT_EQ(count("SELECT handle FROM hierarchy WHERE rowid = 1"),
+              count("SELECT id FROM instance WHERE handle_name = 'top.inst0'"));
+    EXPECT_EQ(count("SELECT COUNT(*) FROM breakpoint"), num_children);
+    // the top input is connected to every child, which is stored once
+    EXPECT_EQ(count("SELECT COUNT(*) FROM connection"), num_children + 1);
+    // the array is flattened
+    EXPECT_EQ(count("SELECT COUNT(*) FROM variable WHERE name = 'self.array.1'"), num_children);
+    EXPECT_EQ(count("SELECT COUNT(*) FROM variable WHERE handle IS NULL"), 0);
+    EXPECT_EQ(count("SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name = "
+                    "'variable_handle'"),
+              1);
+
+    sqlite3_close(conn);
+    fs::remove(filename);
+}
+
+TEST(debug, symbol_file) {  // NOLINT
+    Context c;
+    auto &top = c.generator("top");
+    top.debug = true;
+    auto &in = top.port(PortDirection::In, "in", 8);
+    std::map<Generator *, std::map<std::string, Var *>> mapping;
+    constexpr uint32_t num_children = 16;
+    for (uint32_t i = 0; i < num_children; i++) {
+        auto &child = c.generator("child" + std::to_string(i));
+        child.debug = true;
+        auto &child_in = child.port(PortDirection::In, "in", 8);
+        auto &child_out = child.port(PortDirection::Out, "out", 8);
+        auto stmt = child_out.assign(child_in, AssignmentType::Blocking);
+        stmt->fn_name_ln.emplace_back("test.py", i);
+        stmt->add_scope_variable("i", std::to_string(i), false, false);
+        child.combinational()->add_stmt(stmt);
+        mapping[&child] = {{"self.in", &child_in}};
+        top.add_child_generator("inst" + std::to_string(i), child.shared_from_this());
+        top.add_stmt(child_in.assign(in));
+    }
+
+    inject_instance_ids(&top);
+    inject_debug_break_points(&top);
+    create_module_instantiation(&top);
+    auto const break_points = extract_debug_break_points(&top);
+    DebugDatabase db("top");
+    db.set_break_points(&top);
+    db.set_variable_mapping(mapping);
+    db.set_generator_connection(&top);
+    db.set_generator_hierarchy(&top);
+    db.set_stmt_context(&top);
+    auto const filename = fs::join(fs::temp_directory_path(), "kratos_debug_symbol.sym");
+    db.save_symbol_file(filename);
+
+    DebugSymbolFile symbols(filename);
+    EXPECT_EQ(symbols.metadata("top_name"), "top");
+    EXPECT_EQ(symbols.instances().size(), num_children + 1);
+    EXPECT_EQ(symbols.breakpoints().size(), num_children);
+    // the mapped input, the unmapped output and the scope variable of every child
+    EXPECT_EQ(symbols.variables().size(), num_children * 3);
+    // the top input drives every child, which is stored once
+    EXPECT_EQ(symbols.connections().size(), 1);
+    EXPECT_EQ(symbols.hierarchy().size(), num_children);
+    for (auto const &[stmt, id] : break_points) {
+        auto const *breakpoint = symbols.breakpoint(id);
+        ASSERT_NE(breakpoint, nullptr);
+        EXPECT_EQ(symbols.str(breakpoint->filename), "test.py");
+        EXPECT_EQ(breakpoint->line_num, stmt->fn_name_ln.front().second);
+        auto const contexts = symbols.contexts(*breakpoint);
+        ASSERT_EQ(contexts.size(), 1);
+        EXPECT_EQ(symbols.str(contexts[0].name), "i");
+        auto const *variable = symbols.variable(contexts[0].variable_id);
+        ASSERT_NE(variable, nullptr);
+        EXPECT_EQ(symbols.str(variable->value), std::to_string(breakpoint->line_num));
+        auto const instance_sets = symbols.instance_sets(*breakpoint);
+        ASSERT_EQ(instance_sets.size(), 1);
+        auto const *instance = symbols.instance(instance_sets[0].instance_id);
+        ASSERT_NE(instance, nullptr);
+        EXPECT_EQ(symbols.str(instance->handle_name), stmt->generator_parent()->handle_name());
+    }
+    EXPECT_EQ(symbols.breakpoint(0xFFFFFF), nullptr);
+
+    // not a symbol file
+    {
+        std::ofstream out(filename, std::ios::trunc);
+        out << "SQLite format 3";
+    }
+    EXPECT_THROW(DebugSymbolFile{filename}, UserException);
+    fs::remove(filename);
+
+    // a failed save leaves nothing behind
+    auto const bad_filename = fs::join(fs::join(fs::temp_directory_path(), "kratos_no_dir"),
+                                       "debug.sym");
+    EXPECT_THROW(db.save_symbol_file(bad_filename), UserException);
+    EXPECT_FALSE(fs::exists(bad_filename + ".tmp"));
+}
@@ -109,6 +109,43 @@ TEST(expr, assign) {  // NOLINT
     EXPECT_EQ(raw_stmt.left(), assign_stmt->left());
 }
 
+TEST(expr, assign_stmt_set) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("mod");
+    auto &a = mod.var("a", 1);
+    auto &b = mod.var("b", 1);
+    std::vector<std::shared_ptr<AssignStmt>> stmts;
+    for (uint32_t i = 0; i < 40; i++) stmts.emplace_back(a.assign(b));
+
+    AssignStmtSet set;
+    for (auto const &stmt : stmts) EXPECT_TRUE(set.emplace(stmt).second);
+    EXPECT_FALSE(set.emplace(stmts[0]).second);
+    EXPECT_EQ(set.size(), stmts.size());
+    // insertion order
+    EXPECT_TRUE(std::equal(set.begin(), set.end(), stmts.begin()));
+    auto copy = set;
+    for (uint32_t i = 0; i < stmts.size(); i += 2) EXPECT_EQ(set.erase(stmts[i]), 1);
+    EXPECT_EQ(set.erase(stmts[0]), 0);
+    EXPECT_EQ(set.size(), stmts.size() / 2);
+    for (uint32_t i = 0; i < stmts.size(); i++) {
+        EXPECT_EQ(set.count(stmts[i]), i % 2);
+        EXPECT_EQ(copy.count(stmts[i]), 1);
+    }
+    auto moved = std::move(set);
+    EXPECT_EQ(moved.size(), stmts.size() / 2);
+    moved.clear();
+    EXPECT_TRUE(moved.empty());
+
+    // small sets stay inline
+    AssignStmtSet small;
+    small.emplace(stmts[0]);
+    small.emplace(stmts[1]);
+    auto small_moved = std::move(small);
+    EXPECT_EQ(*small_moved.begin(), stmts[0]);
+    small_moved.erase(stmts[0]);
+    EXPECT_EQ(*small_moved.begin(), stmts[1]);
+}
+
 TEST(expr, const_val) {  // NOLINT
     Context c;
     auto mod = c.generator("mod");
@@ -168,4 +168,33 @@ TEST(fault, parse_icc_cov_file) {  // NOLINT
     for (auto const &iter : result) {
         EXPECT_TRUE(iter.first->type() == StatementType::Block);
     }
-}
\ No newline at end of file
+}
+TEST(fault, batch_coverage) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("mod");
+    auto &in = mod.port(PortDirection::In, "in", 8);
+    auto &out = mod.port(PortDirection::Out, "out", 8);
+    auto comb = mod.combinational();
+    auto if_ = std::make_shared<IfStmt>(in > constant(100, 8));
+    comb->add_stmt(if_);
+    if_->add_then_stmt(out.assign(constant(4, 8)));
+    auto inner = std::make_shared<IfStmt>(in.eq(constant(0, 8)));
+    inner->add_then_stmt(out.assign(constant(1, 8)));
+    inner->add_else_stmt(out.assign(in));
+    if_->add_else_stmt(inner);
+
+    // more states than a single batch holds
+    auto run = std::make_shared<SimulationRun>(&mod);
+    for (int64_t i = 1; i <= 100; i++) run->add_simulation_state({{"mod.in", i}});
+    FaultAnalyzer fault(&mod);
+    fault.add_simulation_run(run);
+    auto coverage = fault.compute_coverage(0);
+    EXPECT_EQ(coverage.size(), 2);
+    EXPECT_EQ(coverage.count(if_->else_body().get()), 1);
+    EXPECT_EQ(coverage.count(inner->else_body().get()), 1);
+
+    run->add_simulation_state({{"mod.in", 0}});
+    run->add_simulation_state({{"mod.in", 101}});
+    coverage = fault.compute_coverage(0);
+    EXPECT_EQ(coverage.size(), 4);
+}
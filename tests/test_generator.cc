@@ -5,10 +5,12 @@
 #include "../src/formal.hh"
 #include "../src/fsm.hh"
 #include "../src/generator.hh"
+#include "../src/hash.hh"
 #include "../src/interface.hh"
 #include "../src/pass.hh"
 #include "../src/port.hh"
 #include "../src/stmt.hh"
+#include "../src/syntax.hh"
 #include "../src/util.hh"
 #include "gtest/gtest.h"
 
@@ -28,6 +30,146 @@ TEST(generator, load) {  // NOLINT
         Generator::from_verilog(&c, "module1.sv", "module1", {}, {{"aa", PortType::Clock}}));
 }
 
+TEST(generator, scan_verilog) {  // NOLINT
+    auto const src = R"(
+`timescale 1ns/1ps
+`define WIDTH 4
+// module fake(input a);
+/* module fake(input a); */
+(* keep *) module mod1 #(parameter WIDTH = 4, parameter int DEPTH = WIDTH * 2)
+    (input logic clk, rst_n,
+     input signed [WIDTH - 1:0] in [DEPTH],
+     output logic [$clog2(DEPTH):0][1:0] out);
+    localparam L = 1;
+    function logic f(input logic a);
+        return a;
+    endfunction
+endmodule : mod1
+
+module mod2(a, b, c);
+    parameter W = 2;
+    input [W-1:0] a, b[3:0];
+    output reg c;
+    always @(*) c = a[0];
+endmodule
+
+module mod3(bus_if.master bus);
+endmodule
+)";
+    auto const modules = scan_verilog_modules(src);
+    EXPECT_EQ(modules.size(), 3);
+    auto const &mod1 = modules.at("mod1");
+    EXPECT_TRUE(mod1.error.empty());
+    EXPECT_EQ(mod1.params.size(), 2);
+    EXPECT_EQ(mod1.params[1].first, "DEPTH");
+    EXPECT_EQ(mod1.ports.size(), 4);
+    EXPECT_EQ(mod1.ports[1].name, "rst_n");
+    EXPECT_EQ(mod1.ports[1].direction, PortDirection::In);
+    EXPECT_TRUE(mod1.ports[2].is_signed);
+    EXPECT_EQ(mod1.ports[2].unpacked_dims.size(), 1);
+    EXPECT_EQ(mod1.ports[3].direction, PortDirection::Out);
+    EXPECT_EQ(mod1.ports[3].packed_dims.size(), 2);
+
+    auto const &mod2 = modules.at("mod2");
+    EXPECT_TRUE(mod2.error.empty());
+    EXPECT_EQ(mod2.ports[1].name, "b");
+    EXPECT_EQ(mod2.ports[1].packed_dims[0].first, "W - 1");
+    EXPECT_EQ(mod2.ports[2].direction, PortDirection::Out);
+    EXPECT_FALSE(modules.at("mod3").error.empty());
+
+    Context c;
+    auto &gen = c.generator("mod1");
+    auto ports = get_port_from_verilog(&gen, src, "mod1");
+    EXPECT_EQ(ports.at("in")->var_width(), 4);
+    EXPECT_EQ(ports.at("in")->size().front(), 8);
+    EXPECT_TRUE(ports.at("in")->is_signed());
+    EXPECT_EQ(ports.at("out")->width(), 4 * 2);
+    ports = get_port_from_verilog(&gen, src, "mod2");
+    EXPECT_EQ(ports.at("b")->size().front(), 4);
+    EXPECT_ANY_THROW(get_port_from_verilog(&gen, src, "mod3"));
+    EXPECT_ANY_THROW(get_port_from_verilog(&gen, src, "mod4"));
+
+    EXPECT_EQ(eval_verilog_expr("2 ** 3 - 'h2 + (1 << 2)", {}), 10);
+    EXPECT_EQ(eval_verilog_expr("$clog2(A + 1)", {{"A", 8}}), 4);
+    EXPECT_EQ(eval_verilog_expr("$clog2(A)", {{"A", (int64_t(1) << 62) + 1}}), 63);
+    EXPECT_EQ(eval_verilog_expr("$clog2(A)", {{"A", INT64_MAX}}), 63);
+    EXPECT_EQ(eval_verilog_expr("3 ** 4 + 1 ** 4000000000000", {}), 82);
+    EXPECT_EQ(eval_verilog_expr("1 << 64", {}), 0);
+    EXPECT_ANY_THROW(eval_verilog_expr("B", {}));
+}
+
+TEST(generator, library_index) {  // NOLINT
+    auto const dir = fs::temp_directory_path();
+    auto const src_file = fs::join(dir, "kratos_library_index.sv");
+    auto const index_file = fs::join(dir, "kratos_library_index.index");
+    fs::remove(index_file);
+    auto write_src = [&](const std::string &src) {
+        std::ofstream out(src_file, std::ios::trunc);
+        out << src;
+    };
+    write_src("module mod(input [3:0] a, output b);\nendmodule\n");
+
+    auto &index = VerilogLibraryIndex::global();
+    index.clear();
+    index.set_filename(index_file);
+    Context c;
+    auto mod = Generator::from_verilog(&c, src_file, "mod", {}, {});
+    mod = Generator::from_verilog(&c, src_file, "mod", {}, {});
+    EXPECT_EQ(mod.get_port("a")->width(), 4);
+    EXPECT_EQ(index.num_scans(), 1);
+    auto const hash = index.get(src_file)->hash;
+    // only touched
+    std::filesystem::last_write_time(
+        src_file, std::filesystem::last_write_time(src_file) + std::chrono::seconds(1));
+    EXPECT_EQ(index.get(src_file)->hash, hash);
+    EXPECT_EQ(index.num_hashes(), 2);
+    EXPECT_EQ(index.num_scans(), 1);
+
+    // a new run loads the index from disk
+    index.save();
+    index.clear();
+    index.set_filename(index_file);
+    EXPECT_EQ(index.size(), 1);
+    mod = Generator::from_verilog(&c, src_file, "mod", {}, {});
+    EXPECT_EQ(mod.get_port("a")->width(), 4);
+    EXPECT_EQ(mod.get_port("b")->port_direction(), PortDirection::Out);
+    EXPECT_EQ(index.num_hashes(), 0);
+    EXPECT_EQ(index.num_scans(), 0);
+
+    write_src("module mod(input [7:0] a, output b);\nendmodule\n");
+    mod = Generator::from_verilog(&c, src_file, "mod", {}, {});
+    EXPECT_EQ(mod.get_port("a")->width(), 8);
+    EXPECT_EQ(index.num_scans(), 1);
+
+    // corrupted sizes and directions only drop the entry
+    for (auto const &entry : {"999999999999 abc", "1 a 1 2 3 1\n3 mod 0  99999999999999 0\n",
+                              "1 a 1 2 3 1\n3 mod 0  0 1\n1 a 7 0 0 0 \n"}) {
+        {
+            std::ofstream out(index_file, std::ios::trunc);
+            out << "kratos-library-index 1\n" << entry;
+        }
+        index.clear();
+        EXPECT_NO_THROW(index.set_filename(index_file));
+        EXPECT_EQ(index.size(), 0);
+    }
+
+    // a failed save leaves no temporary file behind
+    auto const index_dir = fs::join(dir, "kratos_library_index_dir");
+    std::filesystem::create_directories(fs::join(index_dir, "sub"));
+    index.set_filename(index_dir);
+    index.get(src_file);
+    EXPECT_THROW(index.save(), UserException);
+    for (auto const &file : std::filesystem::directory_iterator(dir)) {
+        EXPECT_EQ(file.path().string().find("kratos_library_index_dir."), std::string::npos);
+    }
+    std::filesystem::remove_all(index_dir);
+
+    index.set_filename("");
+    index.clear();
+    fs::remove(index_file);
+    fs::remove(src_file);
+}
+
 TEST(generator, port) {  // NOLINT
     Context c;
     auto &mod = c.generator("mod");
@@ -49,6 +191,61 @@ TEST(generator, rename_var) {  // NOLINT
     EXPECT_EQ(stmt2->right()->to_string(), "c[0]");
 }
 
+TEST(generator, symbol_table) {  // NOLINT
+    Context c;
+    auto &symbols = c.symbols();
+    auto const a = symbols.intern("a");
+    EXPECT_EQ(symbols.intern("a"), a);
+    EXPECT_EQ(symbols.find("a"), a);
+    EXPECT_EQ(symbols.find("not_a_name"), SymbolTable::none);
+    EXPECT_EQ(symbols.str(a), "a");
+    // long strings and enough strings to rehash
+    auto const long_name = std::string(SymbolTable::chunk_size, 'x');
+    EXPECT_EQ(symbols.str(symbols.intern(long_name)), long_name);
+    for (uint32_t i = 0; i < 1000; i++) symbols.intern(std::to_string(i));
+    for (uint32_t i = 0; i < 1000; i++) {
+        EXPECT_EQ(symbols.str(symbols.find(std::to_string(i))), std::to_string(i));
+    }
+    EXPECT_EQ(symbols.find("a"), a);
+
+    SymbolMap<uint32_t> map;
+    for (Symbol i = 0; i < 1000; i++) EXPECT_TRUE(map.emplace(i, i));
+    EXPECT_FALSE(map.emplace(0, 1));
+    for (Symbol i = 0; i < 1000; i += 2) EXPECT_TRUE(map.erase(i));
+    EXPECT_FALSE(map.erase(0));
+    EXPECT_FALSE(map.erase(SymbolTable::none));
+    EXPECT_EQ(map.size(), 500);
+    for (Symbol i = 0; i < 1000; i++) {
+        auto const *value = map.find(i);
+        if (i % 2) {
+            ASSERT_NE(value, nullptr);
+            EXPECT_EQ(*value, i);
+        } else {
+            EXPECT_EQ(value, nullptr);
+        }
+    }
+    EXPECT_EQ(map.find(SymbolTable::none), nullptr);
+
+    // name lookups in generators
+    auto &mod = c.generator("mod");
+    auto &in = mod.port(PortDirection::In, "in", 1);
+    auto &b = mod.var("b", 1);
+    EXPECT_TRUE(mod.has_port("in"));
+    EXPECT_FALSE(mod.has_port("b"));
+    EXPECT_EQ(mod.get_port("in").get(), &in);
+    EXPECT_EQ(mod.get_var("b").get(), &b);
+    mod.rename_var("b", "c");
+    EXPECT_FALSE(mod.has_var("b"));
+    EXPECT_EQ(mod.get_var("c").get(), &b);
+    mod.remove_var("c");
+    EXPECT_FALSE(mod.has_var("c"));
+    mod.remove_port("in");
+    EXPECT_FALSE(mod.has_port("in"));
+    EXPECT_FALSE(mod.has_var("in"));
+    EXPECT_TRUE(c.generator_name_exists("mod"));
+    EXPECT_FALSE(c.generator_name_exists("b"));
+}
+
 TEST(generator, remove_stmt) {  // NOLINT
     Context c;
     auto &mod = c.generator("mod");
@@ -61,6 +258,32 @@ TEST(generator, remove_stmt) {  // NOLINT
     EXPECT_EQ(mod.get_stmt(0), nullptr);
 }
 
+TEST(generator, share_exprs) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("mod");
+    auto &a = mod.var("a", 4);
+    auto &b = mod.var("b", 4);
+    auto &in = mod.port(PortDirection::In, "in", 4);
+    auto &expr = a & b;
+    EXPECT_EQ(&expr, &(a & b));
+    EXPECT_NE(&expr, &(b & a));
+    EXPECT_NE(&expr, &(a | b));
+    EXPECT_EQ(&(a[{1, 0}] + b[{1, 0}]), &(a[{1, 0}] + b[{1, 0}]));
+    // ports are not shared
+    EXPECT_NE(&(in & a), &(in & a));
+    // expressions changed in place are not reused
+    auto &d = mod.var("d", 4);
+    expr.right = &d;
+    EXPECT_NE(&expr, &(a & b));
+    EXPECT_EQ(&(a & b), &(a & b));
+
+    mod.share_exprs = false;
+    EXPECT_NE(&(a ^ b), &(a ^ b));
+    mod.share_exprs = true;
+    mod.debug = true;
+    EXPECT_NE(&(a ^ b), &(a ^ b));
+}
+
 TEST(generator, param) {  // NOLINT
     Context c;
     auto &mod = c.generator("mod");
@@ -151,6 +374,159 @@ TEST(pass, verilog_code_gen) {  // NOLINT
     EXPECT_FALSE(module_str.empty());
 }
 
+TEST(pass, verilog_code_gen_stream) {  // NOLINT
+    // small chunks to exercise the chunk boundaries
+    StreamBuffer buffer(4);
+    std::ostream stream(&buffer);
+    std::string expected;
+    for (uint32_t i = 0; i < 100; i++) {
+        auto line = "line " + std::to_string(i) + "\n";
+        stream << line;
+        expected.append(line);
+    }
+    EXPECT_EQ(buffer.str(), expected);
+    EXPECT_EQ(buffer.size(), expected.size());
+    EXPECT_EQ(buffer.hash(), hash_64_fnv1a(expected.c_str(), expected.size()));
+
+    // streamed output is the same as the in-memory one
+    Context c;
+    auto &mod = c.generator("module1");
+    auto &in = mod.port(PortDirection::In, "in", 4);
+    auto &out = mod.port(PortDirection::Out, "out", 4);
+    mod.add_stmt(out.assign(in + constant(1, 4), AssignmentType::Blocking));
+    auto src = SystemVerilogCodeGen(&mod).str();
+    std::stringstream sink;
+    SystemVerilogCodeGen codegen(&mod);
+    codegen.write(sink);
+    EXPECT_EQ(sink.str(), src);
+    EXPECT_EQ(codegen.content_size(), src.size());
+    EXPECT_EQ(codegen.content_hash(), hash_64_fnv1a(src.c_str(), src.size()));
+}
+
+TEST(pass, pass_manager_instrumentation) {  // NOLINT
+    Context c;
+    auto &top = c.generator("top");
+    auto &child = c.generator("child");
+    auto &in = top.port(PortDirection::In, "in", 1);
+    auto &out = top.port(PortDirection::Out, "out", 1);
+    auto &child_in = child.port(PortDirection::In, "in", 1);
+    auto &child_out = child.port(PortDirection::Out, "out", 1);
+    child.add_stmt(child_out.assign(child_in));
+    top.add_child_generator("inst", child.shared_from_this());
+    top.add_stmt(child_in.assign(in));
+    top.add_stmt(out.assign(child_out));
+
+    auto stats = compute_ir_stats(&top);
+    EXPECT_EQ(stats.num_generators, 2);
+    EXPECT_EQ(stats.num_vars, 4);
+    EXPECT_EQ(stats.num_stmts, 3);
+
+    PassManager manager;
+    manager.register_builtin_passes();
+    manager.add_pass("fix_assignment_type");
+    manager.add_pass("remove_unused_vars");
+    manager.run_passes(&top);
+    // not instrumented by default
+    EXPECT_TRUE(manager.pass_stats().empty());
+
+    manager.set_instrumented(true);
+    manager.run_passes(&top);
+    auto const &pass_stats = manager.pass_stats();
+    EXPECT_EQ(pass_stats.size(), 2);
+    EXPECT_EQ(pass_stats[0].name, "fix_assignment_type");
+    EXPECT_EQ(pass_stats[1].before.num_vars, pass_stats[0].after.num_vars);
+    EXPECT_GE(pass_stats[1].start_time, pass_stats[0].start_time + pass_stats[0].wall_time);
+
+    auto filename = fs::join(fs::temp_directory_path(), "kratos_pass_trace.json");
+    manager.save_trace(filename);
+    std::ifstream stream(filename);
+    std::string content((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    EXPECT_NE(content.find("\"traceEvents\""), std::string::npos);
+    EXPECT_NE(content.find("\"name\": \"remove_unused_vars\""), std::string::npos);
+    fs::remove(filename);
+}
+
+TEST(pass, memory_report) {  // NOLINT
+    Context c;
+    auto &top = c.generator("top");
+    auto &in = top.port(PortDirection::In, "in", 4);
+    auto &out = top.port(PortDirection::Out, "out", 2);
+    for (auto i = 0; i < 2; i++) {
+        auto &child = c.generator("child");
+        auto &child_in = child.port(PortDirection::In, "in", 2);
+        auto &child_out = child.port(PortDirection::Out, "out", 2);
+        child.add_stmt(child_out.assign(child_in));
+        top.add_child_generator("inst" + std::to_string(i), child.shared_from_this());
+        top.add_stmt(child_in.assign(in[{i * 2 + 1, i * 2}]));
+    }
+    auto &a = top.var("a", 2);
+    auto stmt = out.assign(a + a);
+    stmt->comment = std::string(100, 'x');
+    top.add_stmt(stmt);
+
+    auto usage = compute_memory_usage(&top);
+    EXPECT_EQ(usage.num_generators, 1);
+    // the sink and source sets are reported separately
+    auto constexpr sets_size = 2 * sizeof(AssignStmtSet);
+    EXPECT_GE(usage.vars, 3 * (sizeof(Var) - sets_size));
+    EXPECT_GE(usage.exprs, sizeof(Expr) - sets_size);
+    EXPECT_GE(usage.slices, 2 * (sizeof(VarSlice) - sets_size));
+    EXPECT_EQ(usage.stmts, 3 * sizeof(AssignStmt));
+    EXPECT_GT(usage.debug_info, 100);
+    EXPECT_GE(usage.connections, 6 * sets_size);
+    EXPECT_EQ(usage.total(), usage.vars + usage.exprs + usage.slices + usage.stmts +
+                                 usage.debug_info + usage.connections);
+
+    auto report = c.memory_report();
+    EXPECT_EQ(report.size(), 2);
+    EXPECT_EQ(report.at("top").total(), usage.total());
+    auto const &child_usage = report.at("child");
+    EXPECT_EQ(child_usage.num_generators, 2);
+    // child ports are counted in the child only
+    EXPECT_EQ(child_usage.vars, 2 * compute_memory_usage(top.get_child_generators()[0].get()).vars);
+    EXPECT_EQ(child_usage.exprs, 0);
+}
+
+TEST(pass, verilog_code_gen_output_dir) {  // NOLINT
+    Context c;
+    auto &top = c.generator("manifest_top");
+    auto &in = top.port(PortDirection::In, "in", 1);
+    auto &out = top.port(PortDirection::Out, "out", 1);
+    for (uint32_t i = 0; i < 4; i++) {
+        auto &child = c.generator("manifest_child" + std::to_string(i));
+        auto &child_in = child.port(PortDirection::In, "in", 1);
+        auto &child_out = child.port(PortDirection::Out, "out", 1);
+        child.add_stmt(child_out.assign(child_in));
+        top.add_child_generator("inst" + std::to_string(i), child.shared_from_this());
+        top.add_stmt(child_in.assign(in));
+        if (i == 0) top.add_stmt(out.assign(child_out));
+    }
+    fix_assignment_type(&top);
+    create_module_instantiation(&top);
+
+    auto dir = fs::temp_directory_path();
+    auto manifest = fs::join(dir, "manifest_pkg.manifest");
+    fs::remove(manifest);
+    generate_verilog(&top, dir, "manifest_pkg", false);
+    EXPECT_TRUE(fs::exists(manifest));
+    auto top_path = fs::join(dir, "manifest_top.sv");
+    auto child_path = fs::join(dir, "manifest_child0.sv");
+    auto size = fs::file_size(child_path);
+    EXPECT_GT(size, 0);
+
+    // unchanged files are not written again
+    auto old_time = std::filesystem::file_time_type::clock::now() - std::chrono::hours(1);
+    std::filesystem::last_write_time(top_path, old_time);
+    // files changed on disk are restored
+    {
+        std::ofstream stream(child_path, std::ios::trunc);
+        stream << "changed";
+    }
+    generate_verilog(&top, dir, "manifest_pkg", false);
+    EXPECT_EQ(std::filesystem::last_write_time(top_path), old_time);
+    EXPECT_EQ(fs::file_size(child_path), size);
+}
+
 TEST(pass, generator_hash) {  // NOLINT
     Context c;
     auto &mod1 = c.generator("module1");
@@ -197,6 +573,108 @@ TEST(pass, generator_hash) {  // NOLINT
     EXPECT_EQ(mod4.name, mod2.name);
 }
 
+TEST(pass, generator_hash_incremental) {  // NOLINT
+    Context c;
+    auto &top = c.generator("top");
+    std::vector<Generator *> children;
+    for (uint32_t i = 0; i < 2; i++) {
+        auto &child = c.generator("child");
+        auto &in = child.port(PortDirection::In, "in", 1);
+        auto &out = child.port(PortDirection::Out, "out", 1);
+        child.add_stmt(out.assign(in, AssignmentType::Blocking));
+        top.add_child_generator("inst" + std::to_string(i), child.shared_from_this());
+        children.emplace_back(&child);
+    }
+    EXPECT_TRUE(top.is_dirty());
+
+    hash_generators(&top, HashStrategy::SequentialHash);
+    EXPECT_FALSE(children[0]->is_dirty());
+    EXPECT_FALSE(children[1]->is_dirty());
+    auto top_hash = c.get_hash(&top);
+    auto child0_hash = c.get_hash(children[0]);
+    auto child1_hash = c.get_hash(children[1]);
+    EXPECT_EQ(child0_hash, child1_hash);
+
+    // nothing changed
+    hash_generators(&top, HashStrategy::SequentialHash);
+    EXPECT_EQ(c.get_hash(&top), top_hash);
+
+    // only change the second child
+    auto &var = children[1]->var("a", 1);
+    EXPECT_TRUE(children[1]->is_dirty());
+    EXPECT_FALSE(children[0]->is_dirty());
+    auto comb = children[1]->combinational();
+    comb->add_stmt(var.assign(children[1]->get_port("in")));
+    hash_generators(&top, HashStrategy::ParallelHash);
+    EXPECT_FALSE(children[1]->is_dirty());
+    EXPECT_EQ(c.get_hash(children[0]), child0_hash);
+    EXPECT_NE(c.get_hash(children[1]), child1_hash);
+    EXPECT_NE(c.get_hash(&top), top_hash);
+
+    // statements added to an existing block mark the generator as well
+    child1_hash = c.get_hash(children[1]);
+    comb->add_stmt(var.assign(constant(0, 1)));
+    EXPECT_TRUE(children[1]->is_dirty());
+    hash_generators(&top, HashStrategy::SequentialHash);
+    EXPECT_NE(c.get_hash(children[1]), child1_hash);
+
+    // rewriting statements in place, e.g. through move_src_to
+    auto &b = children[1]->var("b", 1);
+    hash_generators(&top, HashStrategy::SequentialHash);
+    child1_hash = c.get_hash(children[1]);
+    Var::move_src_to(&var, &b, children[1], false);
+    EXPECT_TRUE(children[1]->is_dirty());
+    hash_generators(&top, HashStrategy::SequentialHash);
+    EXPECT_NE(c.get_hash(children[1]), child1_hash);
+
+    // emptying a block
+    child1_hash = c.get_hash(children[1]);
+    comb->clear();
+    EXPECT_TRUE(children[1]->is_dirty());
+    hash_generators(&top, HashStrategy::SequentialHash);
+    EXPECT_NE(c.get_hash(children[1]), child1_hash);
+}
+
+TEST(pass, generator_hash_structural) {  // NOLINT
+    Context c;
+    auto &top = c.generator("top");
+    auto make = [&](bool swap, uint32_t low) -> Generator * {
+        auto &mod = c.generator("mod");
+        auto &a = mod.port(PortDirection::In, "a", 4);
+        auto &b = mod.port(PortDirection::In, "b", 4);
+        auto &out = mod.port(PortDirection::Out, "out", 4);
+        auto &x = mod.var("x", 2);
+        auto &diff = swap ? b - a : a - b;
+        mod.add_stmt(out.assign(diff));
+        mod.add_stmt(x.assign(a[{low + 1, low}]));
+        top.add_child_generator("mod" + std::to_string(top.get_child_generator_size()),
+                                mod.shared_from_this());
+        return &mod;
+    };
+    auto *mod1 = make(false, 0);
+    auto *mod2 = make(false, 0);
+    auto *mod3 = make(true, 0);
+    auto *mod4 = make(false, 1);
+    hash_generators(&top, HashStrategy::SequentialHash);
+    EXPECT_EQ(c.get_hash(mod1), c.get_hash(mod2));
+    // operand order and slice bounds are part of the structure
+    EXPECT_NE(c.get_hash(mod1), c.get_hash(mod3));
+    EXPECT_NE(c.get_hash(mod1), c.get_hash(mod4));
+
+    // shared operands are only hashed once
+    auto &mod5 = c.generator("mod5");
+    auto &in = mod5.port(PortDirection::In, "in", 16);
+    auto &out = mod5.port(PortDirection::Out, "out", 16);
+    Var *t = &in;
+    for (uint32_t i = 0; i < 20; i++) t = &((*t) + (*t));
+    mod5.add_stmt(out.assign(*t));
+    hash_generators(&mod5, HashStrategy::SequentialHash);
+    auto hash = c.get_hash(&mod5);
+    mod5.mark_dirty();
+    hash_generators(&mod5, HashStrategy::SequentialHash);
+    EXPECT_EQ(c.get_hash(&mod5), hash);
+}
+
 TEST(pass, decouple1) {  // NOLINT
     Context c;
     auto &mod1 = c.generator("module1");
@@ -445,6 +923,46 @@ TEST(pass, decouple_generator_ports) {  // NOLINT
     EXPECT_EQ(src.size(), 3);
 }
 
+TEST(pass, fused_analysis_passes) {  // NOLINT
+    Context c;
+    auto &top = c.generator("top");
+    auto &child = c.generator("child");
+    auto &in = top.port(PortDirection::In, "in", 2);
+    auto &out = top.port(PortDirection::Out, "out", 1);
+    auto &child_in = child.port(PortDirection::In, "in", 2);
+    auto &child_out = child.port(PortDirection::Out, "out", 1);
+    auto comb = child.combinational();
+    auto if_stmt = std::make_shared<IfStmt>(child_in.eq(constant(0, 2)));
+    if_stmt->add_then_stmt(child_out.assign(constant(0, 1)));
+    if_stmt->add_else_stmt(child_out.assign(constant(1, 1)));
+    comb->add_stmt(if_stmt);
+    top.add_child_generator("inst", child.shared_from_this());
+    top.add_stmt(child_in.assign(in));
+    top.add_stmt(out.assign(child_out));
+
+    PassManager manager;
+    manager.register_builtin_passes();
+    manager.add_pass("fix_assignment_type");
+    manager.add_pass("check_mixed_assignment");
+    manager.add_pass("check_always_sensitivity");
+    manager.add_pass("check_inferred_latch");
+    manager.set_instrumented(true);
+    EXPECT_NO_THROW(manager.run_passes(&top));
+    auto const &stats = manager.pass_stats();
+    EXPECT_EQ(stats.size(), 2);
+    EXPECT_EQ(stats[1].name, "check_mixed_assignment+check_always_sensitivity+check_inferred_latch");
+
+    // introduce a latch in the child
+    auto &latch = child.var("latch", 1);
+    auto latch_if = std::make_shared<IfStmt>(child_in.eq(constant(1, 2)));
+    latch_if->add_then_stmt(latch.assign(constant(0, 1), AssignmentType::Blocking));
+    comb->add_stmt(latch_if);
+    EXPECT_THROW(manager.run_passes(&top), StmtException);
+    manager.set_fuse_analysis_passes(false);
+    EXPECT_THROW(manager.run_passes(&top), StmtException);
+    EXPECT_EQ(manager.pass_stats().size(), 3);
+}
+
 TEST(pass, module_hash) {  // NOLINT
     Context c;
     auto &mod1 = c.generator("module1");
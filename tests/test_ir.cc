@@ -1,7 +1,10 @@
 #include "../src/context.hh"
+#include "../src/except.hh"
 #include "../src/expr.hh"
 #include "../src/generator.hh"
+#include "../src/scheduler.hh"
 #include "../src/stmt.hh"
+#include "../src/util.hh"
 #include "gtest/gtest.h"
 
 using namespace kratos;
@@ -50,6 +53,48 @@ TEST(ir, visit_if) {  // NOLINT
     EXPECT_EQ(visitor.current_level(), 0);
 }
 
+TEST(ir, visit_node_marks) {  // NOLINT
+    class MarkedVarVisitor : public VarVisitor {
+    public:
+        MarkedVarVisitor() { use_node_marks(); }
+    };
+
+    Context c;
+    auto &mod = c.generator("test");
+    auto &var1 = mod.var("a", 2);
+    auto &var2 = mod.var("b", 2);
+
+    // var2 is reached from both branches
+    auto if_stmt = IfStmt(var1.eq(var2));
+    if_stmt.add_then_stmt(var1.assign(var2));
+    if_stmt.add_else_stmt(var2.assign(constant(2, 2)));
+
+    VarVisitor visitor;
+    visitor.visit_root(if_stmt.ast_node());
+    auto marked_visitor = std::make_unique<MarkedVarVisitor>();
+    marked_visitor->visit_root(if_stmt.ast_node());
+    EXPECT_EQ(marked_visitor->vars, visitor.vars);
+    EXPECT_EQ(marked_visitor->max_level, visitor.max_level);
+    EXPECT_EQ(marked_visitor->current_level(), 0);
+    // marks persist across visits
+    marked_visitor->visit_root(if_stmt.ast_node());
+    EXPECT_EQ(marked_visitor->vars.size(), visitor.vars.size());
+
+    // only one visitor owns the marks. the second one keeps a visited set and leaves the marks
+    // of the first one alone
+    MarkedVarVisitor marked_visitor2;
+    marked_visitor2.visit_root(if_stmt.ast_node());
+    EXPECT_EQ(marked_visitor2.vars, visitor.vars);
+    marked_visitor->visit_root(if_stmt.ast_node());
+    EXPECT_EQ(marked_visitor->vars.size(), visitor.vars.size());
+
+    // once the owner is gone, a new visitor starts with a new epoch
+    marked_visitor.reset();
+    MarkedVarVisitor marked_visitor3;
+    marked_visitor3.visit_root(if_stmt.ast_node());
+    EXPECT_EQ(marked_visitor3.vars, visitor.vars);
+}
+
 TEST(ir, attribute) {  // NOLINT
     class TestAttribute {
     public:
@@ -68,4 +113,108 @@ TEST(ir, attribute) {  // NOLINT
     var1.add_attribute(attr);
     EXPECT_EQ(var1.get_attributes().size(), 1);
     EXPECT_EQ(reinterpret_cast<TestAttribute*>(var1.get_attributes()[0]->get())->value(), 42);
-}
\ No newline at end of file
+}
+TEST(ir, schedule_generators) {  // NOLINT
+    Context c;
+    auto &top = c.generator("top");
+    // unbalanced hierarchy: a deep chain next to many shallow children
+    Generator *parent = &top;
+    for (uint32_t i = 0; i < 8; i++) {
+        auto &child = c.generator("chain" + std::to_string(i));
+        parent->add_child_generator("inst", child.shared_from_this());
+        parent = &child;
+    }
+    for (uint32_t i = 0; i < 16; i++) {
+        auto &child = c.generator("leaf" + std::to_string(i));
+        top.add_child_generator("leaf" + std::to_string(i), child.shared_from_this());
+    }
+
+    std::mutex mutex;
+    std::vector<Generator *> order;
+    schedule_generators(&top, [&](Generator *g) {
+        std::lock_guard guard(mutex);
+        order.emplace_back(g);
+    });
+    EXPECT_EQ(order.size(), 25);
+    EXPECT_EQ(order.back(), &top);
+    // every generator is visited after its children
+    for (uint32_t i = 0; i < order.size(); i++) {
+        auto *gen = order[i];
+        if (!gen->parent_generator()) continue;
+        auto pos = std::find(order.begin(), order.end(), gen->parent_generator());
+        EXPECT_GT(pos - order.begin(), i);
+    }
+
+    // errors are propagated and the parents are not visited
+    std::atomic<bool> visited_top = false;
+    EXPECT_THROW(schedule_generators(&top,
+                                     [&](Generator *g) {
+                                         if (g == parent) throw UserException("error");
+                                         if (g == &top) visited_top = true;
+                                     }),
+                 UserException);
+    EXPECT_FALSE(visited_top);
+}
+
+TEST(ir, thread_pool_resize) {  // NOLINT
+    // the pool is replaced while another thread is still using it
+    auto const num_cpus = get_num_cpus();
+    std::atomic<bool> started = false;
+    std::atomic<bool> release = false;
+    std::atomic<uint64_t> count = 0;
+    std::thread thread([&]() {
+        parallel_for(64, [&](uint64_t) {
+            started = true;
+            while (!release) std::this_thread::yield();
+            count++;
+        });
+    });
+    while (!started) std::this_thread::yield();
+    set_num_cpus(static_cast<int>(num_cpus + 1));
+    auto pool = ThreadPool::global();
+    EXPECT_EQ(pool->num_threads(), num_cpus + 1);
+    release = true;
+    thread.join();
+    EXPECT_EQ(count, 64);
+
+    set_num_cpus(static_cast<int>(num_cpus));
+    parallel_for(64, [&](uint64_t) { count++; });
+    EXPECT_EQ(count, 128);
+}
+
+TEST(ir, parallel_for_stmts) {  // NOLINT
+    Context c;
+    auto &top = c.generator("top");
+    auto &a = top.var("a", 4);
+    std::vector<Stmt *> stmts;
+    for (uint32_t i = 0; i < 1000; i++) {
+        auto &b = top.var("b" + std::to_string(i), 4);
+        auto comb = top.combinational();
+        comb->add_stmt(b.assign(a + constant(i % 16, 4)));
+        stmts.emplace_back(comb.get());
+    }
+    EXPECT_EQ(get_block_local_stmts(&top), stmts);
+
+    std::atomic<uint64_t> count = 0;
+    parallel_for_stmts(&top, [&](Stmt *) { count++; });
+    EXPECT_EQ(count, stmts.size());
+
+    // results are merged in statement order
+    auto result = parallel_collect_stmts<Stmt *>(&top, [](Stmt *stmt, std::vector<Stmt *> &buf) {
+        buf.emplace_back(stmt);
+    });
+    EXPECT_EQ(result, stmts);
+
+    // the error from the first failed statement is reported
+    for (uint32_t i = 0; i < 4; i++) {
+        try {
+            parallel_for_stmts(&top, [&](Stmt *stmt) {
+                auto index = std::find(stmts.begin(), stmts.end(), stmt) - stmts.begin();
+                if (index % 100 == 42) throw UserException(std::to_string(index));
+            });
+            FAIL();
+        } catch (const UserException &ex) {
+            EXPECT_STREQ(ex.what(), "42");
+        }
+    }
+}
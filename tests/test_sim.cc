@@ -314,6 +314,95 @@ TEST(eval, ternary) {    // NOLINT
     }
 }
 
+TEST(eval, bin_op_wide) {  // NOLINT
+    // multi-word kernels should agree with the single word version
+    size_t seed = 42;
+    std::mt19937 rnd;  // NOLINT
+    rnd.seed(seed);
+    auto constexpr width = 40;
+    auto constexpr mask = UINT64_MASK >> (64u - width);
+    auto constexpr num_test = 420u;
+    auto ops = {ExprOp::Add,      ExprOp::Minus,     ExprOp::Multiply, ExprOp::Divide,
+                ExprOp::Mod,      ExprOp::And,       ExprOp::Or,       ExprOp::Xor,
+                ExprOp::Eq,       ExprOp::Neq,       ExprOp::LessThan, ExprOp::GreaterEqThan,
+                ExprOp::ShiftLeft, ExprOp::LogicalShiftRight};
+    for (auto op : ops) {
+        for (uint32_t i = 0; i < num_test; i++) {
+            uint64_t v1 = rnd() & mask;
+            uint64_t v2 = rnd() & mask;
+            if (op == ExprOp::ShiftLeft || op == ExprOp::LogicalShiftRight) v2 %= width;
+            if (v2 == 0) v2 = 1;
+            auto gold = eval_bin_op(v1, v2, op, width, false);
+            auto result = eval_bin_op(std::vector<uint64_t>{v1}, std::vector<uint64_t>{v2}, op,
+                                      width, false);
+            EXPECT_EQ(gold, result[0]);
+        }
+    }
+}
+
+TEST(eval, wide_kernels) {  // NOLINT
+    auto constexpr width = 128;
+    std::vector<uint64_t> a = {UINT64_MASK, 1};
+    std::vector<uint64_t> b = {1, 0};
+    // carry across words
+    EXPECT_EQ(eval_bin_op(a, b, ExprOp::Add, width, false), std::vector<uint64_t>({0, 2}));
+    EXPECT_EQ(eval_bin_op(b, a, ExprOp::Minus, width, false),
+              std::vector<uint64_t>({2, UINT64_MASK - 1}));
+    // shifts across words
+    EXPECT_EQ(eval_bin_op(b, {64}, ExprOp::ShiftLeft, width, false),
+              std::vector<uint64_t>({0, 1}));
+    EXPECT_EQ(eval_bin_op(a, {4}, ExprOp::LogicalShiftRight, width, false),
+              std::vector<uint64_t>({0x1FFFFFFFFFFFFFFF, 0}));
+    EXPECT_EQ(eval_bin_op({0, 1ull << 63u}, {64}, ExprOp::SignedShiftRight, width, true),
+              std::vector<uint64_t>({1ull << 63u, UINT64_MASK}));
+    EXPECT_EQ(eval_bin_op(a, {200}, ExprOp::ShiftLeft, width, false),
+              std::vector<uint64_t>({0, 0}));
+    // (2^64 + 2^64 - 1) * 2^64 truncated to 128 bits
+    EXPECT_EQ(eval_bin_op(a, {0, 1}, ExprOp::Multiply, width, false),
+              std::vector<uint64_t>({0, UINT64_MASK}));
+    EXPECT_EQ(eval_bin_op({0, 3}, {2}, ExprOp::Divide, width, false),
+              std::vector<uint64_t>({1ull << 63u, 1}));
+    EXPECT_EQ(eval_bin_op({5, 3}, {0, 1}, ExprOp::Mod, width, false),
+              std::vector<uint64_t>({5, 0}));
+    // compares
+    EXPECT_EQ(eval_bin_op(a, b, ExprOp::GreaterThan, width, false)[0], 1);
+    EXPECT_EQ(eval_bin_op({0, 1ull << 63u}, b, ExprOp::GreaterThan, width, true)[0], 0);
+    // reductions and unary ops
+    EXPECT_EQ(eval_unary_op(a, ExprOp::UXor, width)[0], 1);
+    EXPECT_EQ(eval_unary_op({UINT64_MASK, UINT64_MASK}, ExprOp::UAnd, width)[0], 1);
+    EXPECT_EQ(eval_unary_op(b, ExprOp::UMinus, width),
+              std::vector<uint64_t>({UINT64_MASK, UINT64_MASK}));
+    EXPECT_EQ(eval_unary_op(b, ExprOp::UInvert, 72),
+              std::vector<uint64_t>({UINT64_MASK - 1, 0xFF}));
+}
+
+TEST(sim, value_wide) {  // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &a = mod.port(PortDirection::In, "a", 128);
+    auto &b = mod.port(PortDirection::In, "b", 128);
+    auto &c = mod.var("c", 64);
+    auto &sum = mod.var("sum", 128);
+    auto &concat = mod.var("concat", 192);
+    auto &lt = mod.var("lt", 1);
+    auto &high = mod.var("high", 64);
+    mod.add_stmt(sum.assign(a + b));
+    mod.add_stmt(concat.assign(c.concat(a)));
+    mod.add_stmt(lt.assign(a < b));
+    mod.add_stmt(high.assign(sum[{127, 64}]));
+
+    Simulator sim(&mod);
+    sim.set(&a, std::vector<uint64_t>{UINT64_MASK, 0});
+    sim.set(&b, 1);
+    sim.set(&c, 42);
+    EXPECT_EQ(*sim.get_array(&sum), std::vector<uint64_t>({0, 1}));
+    EXPECT_EQ(*sim.get(&high), 1);
+    EXPECT_EQ(*sim.get(&lt), 0);
+    EXPECT_EQ(*sim.get_array(&concat), std::vector<uint64_t>({UINT64_MASK, 0, 42}));
+    auto &expr = a.extend(256) << constant(100, 8);
+    EXPECT_EQ(*sim.eval_expr(&expr), std::vector<uint64_t>({0, UINT64_MASK << 36u, 0xFFFFFFFFF, 0}));
+}
+
 TEST(sim, ternary) {    // NOLINT
     Context ctx;
     auto &gen = ctx.generator("mod");
@@ -330,4 +419,344 @@ TEST(sim, ternary) {    // NOLINT
     sim.set(&a, 1);
     result = (*sim.eval_expr(&cond))[0];
     EXPECT_EQ(result, 42);
-}
\ No newline at end of file
+}
+TEST(sim, value_store) {  // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &a = mod.var("a", 60);
+    auto &b = mod.var("b", 16, 4);
+
+    SimValueStore store;
+    auto const &entry_a = store.entry(&a);
+    auto const &entry_b = store.entry(&b);
+    EXPECT_EQ(entry_b.offset, 60);
+    EXPECT_EQ(store.num_bits(), 60 + 16 * 4);
+    EXPECT_FALSE(store.valid(entry_a));
+    store.set_valid(entry_a);
+    EXPECT_TRUE(store.valid(entry_a));
+    EXPECT_FALSE(store.valid(entry_b));
+    // crosses the word boundary
+    store.write(entry_b.offset, 16, 0xABCD);
+    EXPECT_EQ(store.read(entry_b.offset, 16), 0xABCD);
+    store.write(entry_a.offset, 60, 42);
+    EXPECT_EQ(store.read(entry_a.offset, 60), 42);
+    EXPECT_EQ(store.read(entry_b.offset, 16), 0xABCD);
+}
+
+TEST(sim, save_load_state) {  // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &a = mod.var("a", 4, {2, 2});
+    auto &b = mod.var("b", 4);
+    mod.add_stmt(b.assign(a[1][0]));
+
+    Simulator sim(&mod);
+    auto empty = sim.save_state();
+    sim.set(&a, std::vector<uint64_t>{1, 2, 3, 4});
+    auto state = sim.save_state();
+    EXPECT_EQ(*sim.get(&b), 3);
+    auto res = sim.get_array(&a[1]);
+    EXPECT_TRUE(res != std::nullopt);
+    EXPECT_EQ(*res, std::vector<uint64_t>({3, 4}));
+
+    sim.load_state(empty);
+    EXPECT_EQ(sim.get(&b), std::nullopt);
+    sim.load_state(state);
+    EXPECT_EQ(*sim.get(&b), 3);
+}
+
+TEST(sim, compiled_scalar) {  // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &a = mod.var("a", 1);
+    auto &b = mod.var("b", 1);
+    auto &c = mod.var("c", 3);
+    mod.add_stmt(c[0].assign(constant(0, 1)));
+    mod.add_stmt(c[1].assign(b));
+    mod.add_stmt(a.assign(b));
+
+    CompiledSimulator sim(&mod);
+    sim.set(&b, 1);
+
+    auto res = sim.get(&c);
+    EXPECT_TRUE(res != std::nullopt);
+    EXPECT_EQ(*res, 2);
+    res = sim.get(&a);
+    EXPECT_EQ(*res, 1);
+}
+
+TEST(sim, compiled_unsupported) {  // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &a = mod.var("a", 128);
+    auto &b = mod.var("b", 128);
+    mod.add_stmt(a.assign(b));
+    // callers such as the fault analyzer fall back to the interpreter on this exception only
+    EXPECT_THROW(CompiledSimulator sim(&mod), UnsupportedSimulationException);
+}
+
+TEST(sim, compiled_combinational_order) {  // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &a = mod.var("a", 4, {2, 2});
+    auto &b = mod.var("b", 4, {2, 2});
+    auto &c = mod.var("c", 4);
+    auto &d = mod.var("d", 4);
+    // statements are in the reversed order, which is fixed by levelization
+    mod.add_stmt(d.assign(c + constant(1, 4)));
+    auto comb = mod.combinational();
+    comb->add_stmt(c.assign(a[1][1]));
+    mod.add_stmt(a.assign(b));
+
+    CompiledSimulator sim(&mod);
+    uint32_t constexpr value = 5;
+    sim.set(&(b[1][1]), std::vector<uint64_t>{value});
+
+    auto res = sim.get(&c);
+    EXPECT_TRUE(res != std::nullopt);
+    EXPECT_EQ(*res, value);
+    res = sim.get(&d);
+    EXPECT_EQ(*res, value + 1);
+    auto array = sim.get_array(&b[1]);
+    EXPECT_TRUE(array != std::nullopt);
+    EXPECT_EQ((*array)[1], value);
+}
+
+TEST(sim, compiled_array_access) {  // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &a = mod.var("a", 4, 4);
+    auto &b = mod.var("b", 2);
+    auto &c = mod.var("c", 4);
+    mod.add_stmt(c.assign(a[b.shared_from_this()]));
+
+    CompiledSimulator sim(&mod);
+    uint32_t constexpr value = 5;
+    sim.set(&b, 2ul);
+    sim.set(&a[b.shared_from_this()], value);
+
+    auto res = sim.get(&a[2]);
+    EXPECT_TRUE(res != std::nullopt);
+    EXPECT_EQ(*res, value);
+    res = sim.get(&c);
+    EXPECT_EQ(*res, value);
+    sim.set(&a[1], 3);
+    sim.set(&b, 1ul);
+    res = sim.get(&c);
+    EXPECT_EQ(*res, 3);
+}
+
+TEST(sim, compiled_sequential) {  // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &clk = mod.var("clk", 1);
+    auto &a = mod.var("a", 4);
+    auto &b = mod.var("b", 4);
+    auto &c = mod.var("c", 4);
+    auto seq = mod.sequential();
+    seq->add_condition({BlockEdgeType::Posedge, clk.shared_from_this()});
+    seq->add_stmt(c.assign(a));
+    seq->add_stmt(a.assign(b));
+
+    CompiledSimulator sim(&mod);
+    uint32_t constexpr value = 5;
+    sim.set(&clk, 0);
+    sim.set(&b, value);
+    sim.set(&clk, 1);
+    // non-blocking assignment
+    EXPECT_EQ(sim.get(&c), std::nullopt);
+    EXPECT_EQ(*sim.get(&a), value);
+
+    sim.set(&clk, 0);
+    EXPECT_EQ(sim.get(&c), std::nullopt);
+    sim.set(&clk, 1);
+    EXPECT_EQ(*sim.get(&c), value);
+}
+
+TEST(sim, compiled_if_case) {  // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &a = mod.var("a", 1);
+    auto &b = mod.var("b", 1);
+    auto &c = mod.var("c", 2);
+    auto &in = mod.port(PortDirection::In, "in", 2);
+    auto comb = mod.combinational();
+    auto if_ = std::make_shared<IfStmt>((in.eq(constant(1, 2))).shared_from_this());
+    if_->add_then_stmt(a.assign(b));
+    if_->add_else_stmt(a.assign(constant(0, 1)));
+    comb->add_stmt(if_);
+    auto case_ = std::make_shared<SwitchStmt>(in);
+    case_->add_switch_case(constant(1, 2).as<Const>(), c.assign(constant(2, 2)));
+    case_->add_switch_case(constant(2, 2).as<Const>(), c.assign(constant(3, 2)));
+    case_->add_switch_case(nullptr, c.assign(constant(0, 2)));
+    comb->add_stmt(case_);
+
+    CompiledSimulator sim(&mod);
+    EXPECT_EQ(sim.get(&a), std::nullopt);
+    sim.set(&in, 1);
+    sim.set(&b, 1);
+    EXPECT_EQ(*sim.get(&a), 1);
+    EXPECT_EQ(*sim.get(&c), 2);
+    sim.set(&in, 2);
+    EXPECT_EQ(*sim.get(&a), 0);
+    EXPECT_EQ(*sim.get(&c), 3);
+    sim.set(&in, 3);
+    EXPECT_EQ(*sim.get(&c), 0);
+}
+
+TEST(sim, compiled_expr) {  // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &a = mod.port(PortDirection::In, "a", 16);
+    auto &b = mod.port(PortDirection::In, "b", 16);
+    std::vector<Var *> exprs = {&(a + b),       &(a - b),           &(a * b),
+                                &(a & b),       &(a | b),           &(a ^ b),
+                                &(a << b),      &(a >> b),          &(a.eq(b)),
+                                &(a < b),       &(a.r_or()),        &(a.r_xor()),
+                                &(~a),          &(-a),              &(a.concat(b))};
+    std::vector<Var *> outputs;
+    for (uint64_t i = 0; i < exprs.size(); i++) {
+        auto &out = mod.var("out" + std::to_string(i), exprs[i]->width());
+        mod.add_stmt(out.assign(*exprs[i]));
+        outputs.emplace_back(&out);
+    }
+
+    Simulator interpreter(&mod);
+    CompiledSimulator sim(&mod);
+    std::mt19937 rnd;  // NOLINT
+    rnd.seed(42);
+    for (uint32_t i = 0; i < 42; i++) {
+        uint64_t v1 = rnd() & 0xFFFF;
+        uint64_t v2 = i % 4 == 0 ? (rnd() & 0xF) : (rnd() & 0xFFFF);
+        interpreter.set(&a, v1);
+        interpreter.set(&b, v2);
+        sim.set(&a, v1);
+        sim.set(&b, v2);
+        for (auto *out : outputs) {
+            EXPECT_EQ(*interpreter.get(out), *sim.get(out)) << out->to_string();
+        }
+    }
+}
+
+TEST(sim, batch_lanes) {  // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &clk = mod.port(PortDirection::In, "clk", 1);
+    auto &a = mod.port(PortDirection::In, "a", 8);
+    auto &b = mod.port(PortDirection::In, "b", 8);
+    auto &sum = mod.var("sum", 8);
+    auto &sel = mod.var("sel", 8);
+    auto &acc = mod.var("acc", 8);
+    mod.add_stmt(sum.assign(a + b));
+    auto comb = mod.combinational();
+    auto if_ = std::make_shared<IfStmt>(a > b);
+    if_->add_then_stmt(sel.assign(a * b));
+    if_->add_else_stmt(sel.assign(a / b));
+    comb->add_stmt(if_);
+    auto seq = mod.sequential();
+    seq->add_condition({BlockEdgeType::Posedge, clk.shared_from_this()});
+    seq->add_stmt(acc.assign(acc + sum));
+
+    uint32_t constexpr num_lanes = 16;
+    BatchSimulator batch(&mod, num_lanes);
+    EXPECT_EQ(batch.num_lanes(), num_lanes);
+    std::vector<std::unique_ptr<CompiledSimulator>> sims;
+    std::mt19937 rnd;  // NOLINT
+    rnd.seed(42);
+    for (uint32_t lane = 0; lane < num_lanes; lane++) {
+        auto &sim = sims.emplace_back(std::make_unique<CompiledSimulator>(&mod));
+        uint64_t v1 = rnd() & 0xFF;
+        uint64_t v2 = lane % 4 == 0 ? 0 : rnd() & 0xFF;
+        sim->set(&clk, 0);
+        sim->set(&acc, 0);
+        sim->set(&a, v1);
+        sim->set(&b, v2);
+        batch.set(&clk, lane, 0);
+        batch.set(&acc, lane, 0);
+        batch.set(&a, lane, v1);
+        batch.set(&b, lane, v2);
+    }
+    batch.eval();
+    for (auto *var : {&sum, &sel, &acc}) {
+        auto values = batch.get(var);
+        for (uint32_t lane = 0; lane < num_lanes; lane++) {
+            EXPECT_EQ(values[lane], sims[lane]->get(var)) << var->to_string();
+        }
+    }
+
+    // only the odd lanes see a clock edge
+    for (uint32_t lane = 1; lane < num_lanes; lane += 2) {
+        batch.set(&clk, lane, 1);
+        sims[lane]->set(&clk, 1);
+    }
+    batch.eval();
+    for (uint32_t lane = 0; lane < num_lanes; lane++) {
+        EXPECT_EQ(batch.get(&acc, lane), sims[lane]->get(&acc));
+    }
+
+    batch.reset();
+    EXPECT_EQ(batch.get(&a, 0), std::nullopt);
+    batch.set(&a, std::vector<uint64_t>(num_lanes, 0x1FF));
+    EXPECT_EQ(*batch.get(&a, num_lanes - 1), 0xFF);
+}
+
+TEST(sim, compiled_parallel) {  // NOLINT
+    Context context;
+    auto &top = context.generator("top");
+    auto &clk = top.port(PortDirection::In, "clk", 1);
+    auto &in = top.port(PortDirection::In, "in", 8);
+    std::vector<Var *> outs;
+    uint32_t constexpr num_children = 8;
+    for (uint32_t i = 0; i < num_children; i++) {
+        auto &child = context.generator("child");
+        auto &child_clk = child.port(PortDirection::In, "clk", 1);
+        auto &child_in = child.port(PortDirection::In, "in", 8);
+        auto &child_out = child.port(PortDirection::Out, "out", 8);
+        auto &sum = child.var("sum", 8);
+        auto &acc = child.var("acc", 8);
+        child.add_stmt(sum.assign(child_in * constant(i + 1, 8) + acc));
+        auto seq = child.sequential();
+        seq->add_condition({BlockEdgeType::Posedge, child_clk.shared_from_this()});
+        seq->add_stmt(acc.assign(sum ^ constant(i, 8)));
+        child.add_stmt(child_out.assign(acc));
+        top.add_child_generator("inst" + std::to_string(i), child.shared_from_this());
+        top.add_stmt(child_clk.assign(clk));
+        top.add_stmt(child_in.assign(in));
+        auto &out = top.var("out" + std::to_string(i), 8);
+        top.add_stmt(out.assign(child_out));
+        outs.emplace_back(&out);
+    }
+
+    CompiledSimulator serial(&top);
+    CompiledSimulator parallel(&top);
+    parallel.set_parallel(true);
+    EXPECT_TRUE(parallel.parallel());
+    EXPECT_FALSE(serial.parallel());
+    // the child partitions are independent from each other
+    EXPECT_GT(parallel.program().num_partitions(), 1);
+    EXPECT_TRUE(parallel.program().acyclic());
+
+    std::mt19937 rnd;  // NOLINT
+    rnd.seed(42);
+    for (auto *sim : {&serial, &parallel}) {
+        sim->set(&clk, 0);
+        for (auto *out : outs) sim->set(out, 0);
+    }
+    for (uint32_t i = 0; i < num_children; i++) {
+        auto *child = top.get_child_generator("inst" + std::to_string(i));
+        serial.set(child->get_var("acc").get(), 0);
+        parallel.set(child->get_var("acc").get(), 0);
+    }
+    for (uint32_t cycle = 0; cycle < 16; cycle++) {
+        auto value = rnd() & 0xFF;
+        for (auto *sim : {&serial, &parallel}) {
+            sim->set(&in, value);
+            sim->set(&clk, 1);
+            sim->set(&clk, 0);
+        }
+        for (auto *out : outs) {
+            EXPECT_NE(serial.get(out), std::nullopt);
+            EXPECT_EQ(serial.get(out), parallel.get(out)) << out->to_string();
+        }
+    }
+}
@@ -1,7 +1,9 @@
 from kratos import Simulator, Generator, posedge, always_ff, negedge
+import pytest
 
 
-def test_sim_reg():
+@pytest.mark.parametrize("compiled", [False, True])
+def test_sim_reg(compiled):
     class AsyncReg(Generator):
         def __init__(self, width, debug=False):
             super().__init__("Register", debug)
@@ -21,7 +23,7 @@ def test_sim_reg():
                 self.out = self.in_
 
     reg = AsyncReg(16)
-    sim = Simulator(reg)
+    sim = Simulator(reg, compiled=compiled)
     val = sim.get(reg.out)
     assert val is None
     # reset
@@ -40,7 +42,8 @@ def test_sim_reg():
         assert val == v
 
 
-def test_expr():
+@pytest.mark.parametrize("compiled", [False, True])
+def test_expr(compiled):
     mod = Generator("mod")
     a = mod.input("a", 16)
     b = mod.output("b", 16)
@@ -49,11 +52,11 @@ def test_expr():
         e = e + a
     mod.add_stmt(b.assign(e))
 
-    sim = Simulator(mod)
+    sim = Simulator(mod, compiled=compiled)
     assert sim.get(b) is None
     sim.set(a, 2)
     assert sim.get(b) == 12
 
 
 if __name__ == "__main__":
-    test_expr()
+    test_expr(True)